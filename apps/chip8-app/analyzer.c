@@ -0,0 +1,296 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "analyzer.h"
+#include "vm_i.h"
+
+_Static_assert(ANALYZER_MEMORY_SIZE == MEMORY_SIZE, "analyzer and vm disagree on memory size");
+
+#define JUMP_TABLE_MAX_ENTRIES 128
+#define BLOCKS_INITIAL_CAPACITY 64
+#define NO_ADDRESS 0xFFFF
+#define ENTRY_PATH_MAX_INSTRUCTIONS 256
+#define ENTRY_PATH_MAX_CALLS 4
+
+static uint32_t instruction_features(const Instruction instruction) {
+    switch(instruction) {
+#define FEATURES(                                                                         \
+    _, Name, handler, mask, match, mnemonic, operands, mode, opcode_class, features, ...) \
+    case Instruction##Name:                                                               \
+        return features;
+        VM_OPCODES(FEATURES, _)
+#undef FEATURES
+    default:
+        return 0;
+    }
+}
+
+static bool is_skip(const Instruction instruction) {
+    return opcode_get_info(instruction)->opcode_class == OpcodeClassSkip;
+}
+
+static bool ends_block(const Instruction instruction) {
+    const OpcodeClass opcode_class = opcode_get_info(instruction)->opcode_class;
+    return opcode_class == OpcodeClassFlow || opcode_class == OpcodeClassSkip ||
+           opcode_class == OpcodeClassInvalid;
+}
+
+typedef struct {
+    const byte* prog;
+    size_t size;
+} Image;
+
+static byte read_byte(const Image* image, const word addr) {
+    const size_t offset = addr - PROG_START;
+    return (addr >= PROG_START && offset < image->size) ? image->prog[offset] : 0x00;
+}
+
+static word read_opcode(const Image* image, const word addr) {
+    return ((word)(read_byte(image, addr)) << 8) | read_byte(image, addr + 1);
+}
+
+typedef struct {
+    word* items;
+    size_t count;
+} Worklist;
+
+static void visit(RomAnalysis* analysis, Worklist* worklist, const word addr, const bool leader) {
+    if(addr < PROG_START || addr + 1 >= MEMORY_SIZE) return;
+    if(leader) analysis->flags[addr] |= AnalyzerByteLeader;
+    if(analysis->flags[addr] & AnalyzerByteCode) return;
+    analysis->flags[addr] |= AnalyzerByteCode;
+    analysis->flags[addr + 1] |= AnalyzerByteOperand;
+    worklist->items[worklist->count++] = addr;
+}
+
+static void walk_reachable_code(RomAnalysis* analysis, const Image* image) {
+    // every address enters the worklist at most once
+    Worklist worklist = {.items = malloc((MEMORY_SIZE - PROG_START) * sizeof(word)), .count = 0};
+    visit(analysis, &worklist, PROG_START, true);
+
+    while(worklist.count > 0) {
+        const word addr = worklist.items[--worklist.count];
+        const word opcode = read_opcode(image, addr);
+        const Instruction instruction = opcode_decode(opcode);
+        const word nnn = opcode & 0x0FFF;
+
+        analysis->census[instruction]++;
+        analysis->features |= instruction_features(instruction);
+        if(instruction == InstructionDrw && (opcode & 0x000F) == 0) {
+            analysis->features |= RomFeatureLargeSprite;
+        }
+
+        switch(instruction) {
+        case InstructionJp:
+            visit(analysis, &worklist, nnn, true);
+            break;
+        case InstructionCall:
+            visit(analysis, &worklist, nnn, true);
+            visit(analysis, &worklist, addr + 2, true);
+            break;
+        case InstructionJpV0:
+            // the common idiom is a table of jumps indexed by V0
+            for(word entry = nnn; entry < nnn + 2 * JUMP_TABLE_MAX_ENTRIES; entry += 2) {
+                if(entry + 1 >= MEMORY_SIZE) break;
+                if(opcode_decode(read_opcode(image, entry)) != InstructionJp) break;
+                visit(analysis, &worklist, entry, true);
+            }
+            break;
+        case InstructionRet:
+        case InstructionExit:
+        case InstructionInvalid:
+            break;
+        default:
+            if(is_skip(instruction)) {
+                visit(analysis, &worklist, addr + 2, true);
+                visit(analysis, &worklist, addr + 4, true);
+            } else {
+                visit(analysis, &worklist, addr + 2, false);
+            }
+            break;
+        }
+    }
+
+    free(worklist.items);
+}
+
+/* Follows the code that runs unconditionally after start-up, i.e. before the
+ * first branch. ROMs that select a platform from a menu only use its
+ * instructions after a branch, single-platform ROMs usually switch modes here. */
+static uint32_t walk_entry_path(const Image* image) {
+    uint32_t features = 0;
+    word calls[ENTRY_PATH_MAX_CALLS];
+    byte num_calls = 0;
+    word addr = PROG_START;
+    for(size_t j = 0; j < ENTRY_PATH_MAX_INSTRUCTIONS; j++) {
+        const word opcode = read_opcode(image, addr);
+        const Instruction instruction = opcode_decode(opcode);
+        features |= instruction_features(instruction);
+        if(instruction == InstructionDrw && (opcode & 0x000F) == 0) {
+            features |= RomFeatureLargeSprite;
+        }
+
+        if(instruction == InstructionJp) {
+            addr = opcode & 0x0FFF;
+        } else if(instruction == InstructionCall && num_calls < ENTRY_PATH_MAX_CALLS) {
+            calls[num_calls++] = addr + 2;
+            addr = opcode & 0x0FFF;
+        } else if(instruction == InstructionRet && num_calls > 0) {
+            addr = calls[--num_calls];
+        } else if(ends_block(instruction) || instruction == InstructionLdVxK) {
+            return features;
+        } else {
+            addr += 2;
+        }
+    }
+    return features;
+}
+
+static void add_block(RomAnalysis* analysis, size_t* capacity, const BasicBlock* block) {
+    if(analysis->num_blocks == *capacity) {
+        *capacity *= 2;
+        analysis->blocks = realloc(analysis->blocks, *capacity * sizeof(BasicBlock));
+    }
+    analysis->blocks[analysis->num_blocks++] = *block;
+}
+
+static void add_smc_store(RomAnalysis* analysis, const word addr) {
+    analysis->smc_stores = realloc(
+        analysis->smc_stores, (analysis->num_smc_stores + 1) * sizeof(word));
+    analysis->smc_stores[analysis->num_smc_stores++] = addr;
+}
+
+static void mark_range(RomAnalysis* analysis, const word begin, const word len, const byte flag) {
+    for(word addr = begin; addr < begin + len && addr < MEMORY_SIZE; addr++) {
+        analysis->flags[addr] |= flag;
+    }
+}
+
+static bool hits_code(RomAnalysis* analysis, const word begin, const word len) {
+    for(word addr = begin; addr < begin + len && addr < MEMORY_SIZE; addr++) {
+        if(analysis->flags[addr] & (AnalyzerByteCode | AnalyzerByteOperand)) return true;
+    }
+    return false;
+}
+
+/* Walks one block linearly, tracking I while it is a known constant, to find
+ * sprite data and stores. */
+static word scan_block(RomAnalysis* analysis, const Image* image, const word start) {
+    word known_i = NO_ADDRESS;
+    word addr = start;
+    for(;;) {
+        const word opcode = read_opcode(image, addr);
+        const Instruction instruction = opcode_decode(opcode);
+        const byte x = (opcode & 0x0F00) >> 8;
+        const byte n = opcode & 0x000F;
+
+        switch(instruction) {
+        case InstructionLdI:
+            known_i = opcode & 0x0FFF;
+            break;
+        case InstructionAddI:
+        case InstructionLdF:
+        case InstructionLdHf:
+            known_i = NO_ADDRESS;
+            break;
+        case InstructionDrw:
+            if(known_i != NO_ADDRESS) {
+                mark_range(analysis, known_i, (n == 0) ? 32 : n, AnalyzerByteSprite);
+            }
+            break;
+        case InstructionLdB:
+        case InstructionStore:
+            if(known_i != NO_ADDRESS) {
+                const word len = (instruction == InstructionLdB) ? 3 : x + 1;
+                mark_range(analysis, known_i, len, AnalyzerByteWritten);
+                if(hits_code(analysis, known_i, len)) {
+                    analysis->features |= RomFeatureSelfModifying;
+                    add_smc_store(analysis, addr);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+
+        addr += 2;
+        if(ends_block(instruction) || addr + 1 >= MEMORY_SIZE ||
+           (analysis->flags[addr] & AnalyzerByteLeader) ||
+           !(analysis->flags[addr] & AnalyzerByteCode)) {
+            return addr;
+        }
+    }
+}
+
+static void build_blocks(RomAnalysis* analysis, const Image* image) {
+    size_t capacity = BLOCKS_INITIAL_CAPACITY;
+    analysis->blocks = malloc(capacity * sizeof(BasicBlock));
+
+    for(word start = PROG_START; start < MEMORY_SIZE; start++) {
+        if(!(analysis->flags[start] & AnalyzerByteLeader)) continue;
+
+        BasicBlock block = {.start = start, .num_successors = 0, .is_computed_jump = false};
+        block.end = scan_block(analysis, image, start);
+
+        const word last = block.end - 2;
+        const word opcode = read_opcode(image, last);
+        const Instruction instruction = opcode_decode(opcode);
+        switch(instruction) {
+        case InstructionJp:
+            block.successors[block.num_successors++] = opcode & 0x0FFF;
+            break;
+        case InstructionCall:
+            block.successors[block.num_successors++] = opcode & 0x0FFF;
+            block.successors[block.num_successors++] = block.end;
+            break;
+        case InstructionJpV0:
+            block.is_computed_jump = true;
+            break;
+        case InstructionRet:
+        case InstructionExit:
+        case InstructionInvalid:
+            break;
+        default:
+            block.successors[block.num_successors++] = block.end;
+            if(is_skip(instruction)) block.successors[block.num_successors++] = block.end + 2;
+            break;
+        }
+        add_block(analysis, &capacity, &block);
+    }
+}
+
+RomAnalysis* rom_analysis_alloc() {
+    RomAnalysis* analysis = malloc(sizeof(RomAnalysis));
+    analysis->blocks = NULL;
+    analysis->smc_stores = NULL;
+    return analysis;
+}
+
+void rom_analysis_free(RomAnalysis* analysis) {
+    free(analysis->blocks);
+    free(analysis->smc_stores);
+    free(analysis);
+}
+
+void rom_analyze(RomAnalysis* analysis, const byte* prog, const size_t size) {
+    const Image image = {.prog = prog, .size = size};
+
+    free(analysis->blocks);
+    free(analysis->smc_stores);
+    memset(analysis->flags, 0, sizeof(analysis->flags));
+    memset(analysis->census, 0, sizeof(analysis->census));
+    analysis->features = 0;
+    analysis->blocks = NULL;
+    analysis->num_blocks = 0;
+    analysis->smc_stores = NULL;
+    analysis->num_smc_stores = 0;
+
+    walk_reachable_code(analysis, &image);
+    analysis->entry_features = walk_entry_path(&image);
+    build_blocks(analysis, &image);
+}
+
+uint32_t rom_entry_features(const byte* prog, const size_t size) {
+    const Image image = {.prog = prog, .size = size};
+    return walk_entry_path(&image);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "opcodes.h"
+#include "vm.h"
+
+#define ANALYZER_MEMORY_SIZE 0x1000
+
+/* Static analysis of a ROM before it runs: reachable code starting at the
+ * program entry, basic blocks, sprite data, self-modifying stores and the
+ * extensions in use. */
+
+typedef enum {
+    AnalyzerByteCode = 1 << 0, // first byte of a reachable instruction
+    AnalyzerByteOperand = 1 << 1, // second byte of a reachable instruction
+    AnalyzerByteLeader = 1 << 2, // first byte of a basic block
+    AnalyzerByteSprite = 1 << 3, // drawn by a DRW with a statically known I
+    AnalyzerByteWritten = 1 << 4, // stored to with a statically known I
+} AnalyzerByteFlag;
+
+typedef enum {
+    RomFeatureScroll = 1 << 0,
+    RomFeatureHires = 1 << 1,
+    RomFeatureLargeSprite = 1 << 2,
+    RomFeatureLargeFont = 1 << 3,
+    RomFeatureFlags = 1 << 4, // Fx75 / Fx85
+    RomFeatureExit = 1 << 5,
+    RomFeatureComputedJump = 1 << 6,
+    RomFeatureSelfModifying = 1 << 7,
+    RomFeatureKeyWait = 1 << 8,
+} RomFeature;
+
+#define ROM_FEATURES_SUPERCHIP                                                             \
+    (RomFeatureScroll | RomFeatureHires | RomFeatureLargeSprite | RomFeatureLargeFont | \
+     RomFeatureFlags | RomFeatureExit)
+
+typedef struct {
+    word start, end; // [start, end)
+    word successors[2];
+    byte num_successors;
+    bool is_computed_jump;
+} BasicBlock;
+
+typedef struct {
+    byte flags[ANALYZER_MEMORY_SIZE]; // AnalyzerByteFlag per address
+    uint16_t census[InstructionMAX]; // reachable instructions per kind
+    uint32_t features; // RomFeature, anywhere in reachable code
+    uint32_t entry_features; // RomFeature, on the unconditional path from the entry
+    BasicBlock* blocks;
+    size_t num_blocks;
+    word* smc_stores; // addresses of stores that hit reachable code
+    size_t num_smc_stores;
+} RomAnalysis;
+
+RomAnalysis* rom_analysis_alloc();
+
+void rom_analysis_free(RomAnalysis* analysis);
+
+// analyses a program image as it would be loaded at the program start address
+void rom_analyze(RomAnalysis* analysis, const byte* prog, const size_t size);
+
+// the entry_features of rom_analyze alone, without allocating anything
+uint32_t rom_entry_features(const byte* prog, const size_t size);
@@ -1,14 +1,10 @@
 #include <furi.h>
 #include <furi_hal.h>
+#include <string.h>
 #include <toolbox/stream/stream.h>
 #include <toolbox/stream/file_stream.h>
 
-#include "button_config.h"
-#include "vm.h"
-
-typedef struct ButtonConfig {
-    bool input_to_key_map[InputKeyMAX][VM_NUM_KEYS];
-} ButtonConfig;
+#include "button_config_i.h"
 
 static void button_config_connect_input_to_key(
     ButtonConfig* button_config,
@@ -58,8 +54,8 @@ static bool button_config_match_key_id(FuriString* line, size_t* key_id) {
     return false;
 }
 
-ButtonConfig* button_config_alloc(const char* path) {
-    ButtonConfig* button_config = malloc(sizeof(ButtonConfig));
+void button_config_init(ButtonConfig* button_config, const char* path) {
+    memset(button_config, 0, sizeof(ButtonConfig));
 
     Storage* storage = furi_record_open(RECORD_STORAGE);
     Stream* stream = file_stream_alloc(storage);
@@ -107,10 +103,15 @@ ButtonConfig* button_config_alloc(const char* path) {
 
     stream_free(stream);
     furi_record_close(RECORD_STORAGE);
+}
+
+ButtonConfig* button_config_alloc(const char* path) {
+    ButtonConfig* button_config = malloc(sizeof(ButtonConfig));
+    button_config_init(button_config, path);
     return button_config;
 }
 
-void button_config_free(ButtonConfig* button_config, const char* path) {
+void button_config_deinit(ButtonConfig* button_config, const char* path) {
     Storage* storage = furi_record_open(RECORD_STORAGE);
     Stream* stream = file_stream_alloc(storage);
 
@@ -132,7 +133,10 @@ void button_config_free(ButtonConfig* button_config, const char* path) {
 
     stream_free(stream);
     furi_record_close(RECORD_STORAGE);
+}
 
+void button_config_free(ButtonConfig* button_config, const char* path) {
+    button_config_deinit(button_config, path);
     free(button_config);
 }
 
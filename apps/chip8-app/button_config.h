@@ -11,4 +11,9 @@ ButtonConfig* button_config_alloc(const char* path);
 
 void button_config_free(ButtonConfig* button_config, const char* path);
 
+// in-place variants for a config living inside a larger allocation
+void button_config_init(ButtonConfig* button_config, const char* path);
+
+void button_config_deinit(ButtonConfig* button_config, const char* path);
+
 uint16_t button_config_map_input_to_keys(ButtonConfig* button_config, InputEvent* input_event);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "button_config.h"
+#include "vm.h"
+
+struct ButtonConfig {
+    bool input_to_key_map[InputKeyMAX][VM_NUM_KEYS];
+};
@@ -6,24 +6,29 @@
 #include <storage/storage.h>
 #include <toolbox/stream/stream.h>
 #include <toolbox/stream/file_stream.h>
-#include <gui/modules/file_browser.h>
 
 #include "game.h"
-
-#include "chip8_icons.h"
+#include "library.h"
+#include "library_view.h"
 
 typedef struct Chip8App {
     ViewDispatcher* view_dispatcher;
     FuriString* path;
-    FileBrowser* browser;
+    Library* library;
+    LibraryView* library_view;
+    FuriThread* library_thread;
     Game* game;
 } Chip8;
 
 typedef enum {
-    FileBrowserViewId,
+    LibraryViewId,
     GameViewId,
 } ViewId;
 
+typedef enum {
+    Chip8EventFrameReady,
+} Chip8Event;
+
 bool view_dispatcher_navigation_event_callback(void* context) {
     UNUSED(context);
     // We did not handle the event, so return false.
@@ -31,31 +36,41 @@ bool view_dispatcher_navigation_event_callback(void* context) {
 }
 
 bool my_view_dispatcher_custom_event_callback(void* context, uint32_t event) {
-    UNUSED(context);
-    UNUSED(event);
-    bool handled = false;
-    // we set our callback context to be the view_dispatcher.
-    // ViewDispatcher* view_dispatcher = context;
-
-    // if(event == 42) {
-    //     if(current_view == MyViewId) {
-    //         current_view = MyOtherViewId;
-    //     } else {
-    //         current_view = MyViewId;
-    //     }
-
-    //     view_dispatcher_switch_to_view(view_dispatcher, current_view);
-    //     handled = true;
-    // }
-
-    // NOTE: The return value is not currently used by the ViewDispatcher.
-    return handled;
+    Chip8* chip8 = context;
+    switch(event) {
+    case Chip8EventFrameReady:
+        game_commit_frame(chip8->game);
+        return true;
+    default:
+        // NOTE: The return value is not currently used by the ViewDispatcher.
+        return false;
+    }
 }
 
-static void file_browser_callback(void* context) {
+/* Runs on the emulation thread, the redraw itself happens on the thread of the
+ * view dispatcher. */
+static void game_frame_callback(void* context) {
     Chip8* chip8 = context;
+    view_dispatcher_send_custom_event(chip8->view_dispatcher, Chip8EventFrameReady);
+}
+
+/* The picker starts out with the cached index, which this thread then brings up
+ * to date with the SD card. */
+static int32_t library_thread_callback(void* context) {
+    Chip8* chip8 = context;
+    library_update(chip8->library);
+    library_view_refresh(chip8->library_view, false);
+    return 0;
+}
+
+static void library_view_callback(void* context, const LibraryEntry* entry) {
+    Chip8* chip8 = context;
+    /* leave the ROMs not indexed yet for the next start rather than slowing down the game */
+    library_cancel_update(chip8->library);
+    library_get_path(chip8->library, entry, chip8->path);
     FURI_LOG_D("chip8", "selected file '%s'", furi_string_get_cstr(chip8->path));
-    game_start(chip8->game, chip8->path);
+    /* the picker stays up for another choice */
+    if(!game_start(chip8->game, chip8->path)) return;
     view_dispatcher_switch_to_view(chip8->view_dispatcher, GameViewId);
 }
 
@@ -67,17 +82,22 @@ int32_t chip8_app() {
     Chip8* chip8 = malloc(sizeof(Chip8));
     chip8->view_dispatcher = view_dispatcher_alloc();
     chip8->path = furi_string_alloc_set_str(GAME_DATA_PATH);
-    chip8->browser = file_browser_alloc(chip8->path);
+    chip8->library = library_alloc(GAME_DATA_PATH);
+    library_load(chip8->library);
+    chip8->library_view = library_view_alloc(chip8->library);
     chip8->game = game_alloc();
 
     void* context = chip8;
 
-    file_browser_set_callback(chip8->browser, file_browser_callback, context);
-    file_browser_configure(chip8->browser, "ch8", GAME_DATA_PATH, true, true, &I_chip8, true);
-    file_browser_start(chip8->browser, chip8->path);
-    View* browser_view = file_browser_get_view(chip8->browser);
-    view_dispatcher_add_view(chip8->view_dispatcher, FileBrowserViewId, browser_view);
+    library_view_set_callback(chip8->library_view, library_view_callback, context);
+    library_view_refresh(chip8->library_view, true);
+    View* library_view = library_view_get_view(chip8->library_view);
+    view_dispatcher_add_view(chip8->view_dispatcher, LibraryViewId, library_view);
+    chip8->library_thread =
+        furi_thread_alloc_ex("library thread", 3 * 1024U, library_thread_callback, context);
+    furi_thread_start(chip8->library_thread);
 
+    game_set_frame_callback(chip8->game, game_frame_callback, context);
     View* game_view = game_get_view(chip8->game);
     view_dispatcher_add_view(chip8->view_dispatcher, GameViewId, game_view);
 
@@ -92,11 +112,15 @@ int32_t chip8_app() {
     Gui* gui = furi_record_open(RECORD_GUI);
     view_dispatcher_attach_to_gui(chip8->view_dispatcher, gui, ViewDispatcherTypeFullscreen);
 
-    view_dispatcher_switch_to_view(chip8->view_dispatcher, FileBrowserViewId);
+    view_dispatcher_switch_to_view(chip8->view_dispatcher, LibraryViewId);
 
     view_dispatcher_run(chip8->view_dispatcher);
 
-    view_dispatcher_remove_view(chip8->view_dispatcher, FileBrowserViewId);
+    library_cancel_update(chip8->library);
+    furi_thread_join(chip8->library_thread);
+    furi_thread_free(chip8->library_thread);
+
+    view_dispatcher_remove_view(chip8->view_dispatcher, LibraryViewId);
     view_dispatcher_remove_view(chip8->view_dispatcher, GameViewId);
     furi_record_close(RECORD_GUI);
     view_dispatcher_free(chip8->view_dispatcher);
@@ -104,7 +128,8 @@ int32_t chip8_app() {
     game_free(chip8->game);
 
     furi_string_free(chip8->path);
-    file_browser_free(chip8->browser);
+    library_view_free(chip8->library_view);
+    library_free(chip8->library);
 
     return 0;
 }
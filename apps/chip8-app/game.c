@@ -9,89 +9,177 @@
 
 #include "game.h"
 
-#include "button_config.h"
-#include "vm.h"
+#include "analyzer.h"
+#include "button_config_i.h"
+#include "latency.h"
+#include "overlay.h"
+#include "renderer.h"
+#include "rom_file.h"
+#include "rom_settings.h"
+#include "trace.h"
+#include "vm_i.h"
 
 #define BEEP_VOLUME 0.5F
+// how often the emulation thread runs the VM while the program is busy
+#define EMULATION_PERIOD_MS 10
+// shortest time between two frame callbacks, at most 60 redraws a second
+#define FRAME_PERIOD_MS 17
+
+// upper bound for the single allocation made at app start, see GameArena
+#define GAME_ARENA_BUDGET (10 * 1024)
 
 typedef enum {
-    SoundThreadFlagExit = 0x10,
-} SoundThreadFlag;
+    EmulationThreadFlagExit = 0x10,
+    EmulationThreadFlagInput = 0x20,
+    EmulationThreadFlagFrame = 0x40,
+} EmulationThreadFlag;
 
 typedef struct Chip8GameData {
     VM* vm;
     ButtonConfig* button_config;
-    FuriThreadId sound_thread_id;
+    Renderer* renderer;
+    RomSettings rom_settings;
+    Overlay overlay;
+    FuriThreadId emulation_thread_id;
+
+    // frames posted through the frame callback
+    uint32_t framed_screen_changes; // vm_get_screen_changes at the last frame
+    uint32_t last_frame; // ms
+    byte frames_due; // more than one while the flicker filter settles
+    bool is_frame_pending; // posted, but not committed yet
+#if LATENCY_PROBES
+    LatencyProbes latency;
+#endif
 } GameData;
 
 typedef struct Chip8Game {
     View* view;
-    FuriThread* sound_thread;
+    FuriThread* emulation_thread;
+    GameFrameCallback frame_callback;
+    void* frame_context;
 } Game;
 
+/* Everything the game needs for its whole lifetime, sized at compile time from
+ * the features enabled in vm_config.h and allocated in one go. */
+typedef struct Chip8GameArena {
+    Game game;
+    VM vm;
+    ButtonConfig button_config;
+    Renderer renderer;
+} GameArena;
+
+_Static_assert(sizeof(GameArena) <= GAME_ARENA_BUDGET, "game arena exceeds its budget");
+
 static void game_data_update(GameData* data) {
-    FURI_LOG_D(
-        "chip8",
-        "update: cpu speed = %lu Hz / timer freq = %lu Hz",
-        vm_calc_cpu_speed(data->vm, furi_get_tick()),
-        vm_calc_timer_speed(data->vm, furi_get_tick()));
+    TRACE_HOT(
+        TraceEventUpdate, vm_get_instructions_per_sec(data->vm), vm_get_cpu_ticks(data->vm));
     if(!vm_update(data->vm, furi_get_tick())) {
         furi_crash("update error");
     }
+    latency_update(&data->latency, data->vm, furi_get_tick());
 }
 
 static void game_draw_callback(Canvas* canvas, void* model) {
     furi_check(model, "game_draw_callback");
     GameData* data = model;
+    const uint32_t draw_start = overlay_get_us();
 
-    game_data_update(data);
-
-    FURI_LOG_D("chip8", "draw");
+    TRACE_HOT(TraceEventDraw, vm_get_dropped_frames(data->vm), vm_get_timer_ticks(data->vm));
     canvas_clear(canvas);
 
-    const int screen_width = vm_get_screen_width(data->vm);
-    const int screen_height = vm_get_screen_height(data->vm);
+    /* One bitmap for the whole display, lowres screens come out scaled up 2x. */
+    renderer_render(data->renderer, data->vm, furi_get_tick());
+    canvas_draw_xbm(canvas, 0, 0, RENDERER_WIDTH, RENDERER_HEIGHT, data->renderer->frame);
 
-    const uint8_t x_orig = (canvas_width(canvas) - screen_width) / 2;
-    const uint8_t y_orig = (canvas_height(canvas) - screen_height) / 2;
+    overlay_draw(&data->overlay, canvas, data->vm, data->renderer);
+    perf_smooth(&data->overlay.draw_us, overlay_get_us() - draw_start);
+    latency_draw(&data->latency, furi_get_tick());
+}
 
-    for(uint8_t x_line = 0; x_line < screen_width; x_line++) {
-        for(uint8_t y_line = 0; y_line < screen_height; y_line++) {
-            const uint8_t x = x_orig + x_line;
-            const uint8_t y = y_orig + y_line;
-            if(vm_get_pixel(data->vm, x_line, y_line)) canvas_draw_dot(canvas, x, y);
+static void game_data_update_sound(GameData* data) {
+    if(furi_hal_speaker_is_mine() || furi_hal_speaker_acquire(1)) {
+        if(vm_is_sound_playing(data->vm)) {
+            furi_hal_speaker_start(880.F, BEEP_VOLUME);
+        } else {
+            furi_hal_speaker_stop();
         }
+    } else {
+        FURI_LOG_D("chip8", "could not acquire speaker");
+    }
+}
+
+/* How long the emulation thread may sleep. A running program is polled every
+ * EMULATION_PERIOD_MS, an idle one only when its timers run out. */
+static uint32_t game_data_get_timeout(GameData* data) {
+    const uint32_t next_event = vm_get_next_event(data->vm);
+    if(next_event == VM_NO_EVENT) return FuriWaitForever;
+    const uint32_t now = furi_get_tick();
+    const uint32_t until_event = next_event > now ? next_event - now : 0;
+    return until_event > EMULATION_PERIOD_MS ? until_event : EMULATION_PERIOD_MS;
+}
+
+/* Whether to post a frame now. One is due when the screen changed, for a few
+ * more frames after that while the flicker filter still blends in older ones,
+ * and all the time while the overlay is up. It waits for the previous frame to
+ * be committed and for FRAME_PERIOD_MS since it, shortening the timeout so the
+ * emulation thread wakes up in time. */
+static bool game_data_take_frame(GameData* data, uint32_t* timeout) {
+    const uint32_t screen_changes = vm_get_screen_changes(data->vm);
+    if(screen_changes != data->framed_screen_changes) {
+        data->framed_screen_changes = screen_changes;
+        const bool is_filtered = data->renderer->flicker_filter != FlickerFilterOff;
+        data->frames_due = is_filtered ? 1 + RENDERER_FLICKER_FRAMES : 1;
+    }
+    if(data->overlay.is_visible) {
+        if(data->frames_due == 0) data->frames_due = 1;
+        if(*timeout > FRAME_PERIOD_MS) *timeout = FRAME_PERIOD_MS;
     }
+    if(data->frames_due == 0 || data->is_frame_pending) return false;
+
+    const uint32_t now = furi_get_tick();
+    if(now - data->last_frame < FRAME_PERIOD_MS) {
+        const uint32_t until_frame = FRAME_PERIOD_MS - (now - data->last_frame);
+        if(*timeout > until_frame) *timeout = until_frame;
+        return false;
+    }
+    data->frames_due--;
+    data->is_frame_pending = true;
+    data->last_frame = now;
+    return true;
 }
 
-/* This sound functionality runs in a separate thread. */
-static int32_t sound_thread_callback(void* context) {
-    FURI_LOG_D("chip8", "starting sound");
+/* The VM and its sound run in a separate thread, which sleeps while the program
+ * waits for a key or a timer. Key presses wake it up early, and so does a commit
+ * while more frames are due. */
+static int32_t emulation_thread_callback(void* context) {
+    FURI_LOG_D("chip8", "starting emulation");
     Game* game = context;
     for(;;) {
-        if(furi_hal_speaker_is_mine() || furi_hal_speaker_acquire(1)) {
-            with_view_model(
-                game->view,
-                GameData * data,
-                {
-                    if(vm_is_sound_playing(data->vm)) {
-                        furi_hal_speaker_start(880.F, BEEP_VOLUME);
-                    } else {
-                        furi_hal_speaker_stop();
-                    }
-                },
-                false);
-        } else {
-            FURI_LOG_D("chip8", "could not acquire speaker");
-        }
-
-        /* Give the sound some time to play. At the same time wait for an exit signal. */
-        const int flags = furi_thread_flags_wait(SoundThreadFlagExit, FuriFlagWaitAny, 10);
-        FURI_LOG_D("chip8", "sound thread received flag %d", flags);
+        uint32_t timeout = EMULATION_PERIOD_MS;
+        bool is_frame_ready = false;
+        const uint32_t lock_start = overlay_get_us();
+        with_view_model(
+            game->view,
+            GameData * data,
+            {
+                perf_smooth(&data->overlay.lock_wait_us, overlay_get_us() - lock_start);
+                game_data_update(data);
+                game_data_update_sound(data);
+                timeout = game_data_get_timeout(data);
+                is_frame_ready = game_data_take_frame(data, &timeout);
+            },
+            false);
+        if(is_frame_ready && game->frame_callback) game->frame_callback(game->frame_context);
+
+        const uint32_t flags = furi_thread_flags_wait(
+            EmulationThreadFlagExit | EmulationThreadFlagInput | EmulationThreadFlagFrame,
+            FuriFlagWaitAny,
+            timeout);
+        TRACE_EVENT(TraceEventSleep, flags, timeout);
 
         /* If an exit signal was received, return from this thread. */
-        if(flags != FuriStatusErrorTimeout) {
-            FURI_LOG_D("chip8", "stopping sound");
+        if(!(flags & FuriFlagError) && (flags & EmulationThreadFlagExit)) {
+            FURI_LOG_D("chip8", "stopping emulation");
             break;
         }
     }
@@ -100,37 +188,77 @@ static int32_t sound_thread_callback(void* context) {
     return 0;
 }
 
+#if LATENCY_PROBES
+static void game_write_latency(void* context, const char* line) {
+    stream_write_cstring(context, line);
+}
+
+/* The latency histograms of the game that just ended, replacing those of the
+ * last one. */
+static void game_dump_latency(Game* game) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    Stream* stream = file_stream_alloc(storage);
+    if(file_stream_open(stream, GAME_LATENCY_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        with_view_model(
+            game->view,
+            GameData * data,
+            { latency_dump(&data->latency, game_write_latency, stream); },
+            false);
+        file_stream_close(stream);
+    } else {
+        FURI_LOG_E("chip8", "failed to save latency");
+    }
+    stream_free(stream);
+    furi_record_close(RECORD_STORAGE);
+}
+#endif
+
 static void game_end(Game* game) {
-    /* Signal the sound thread to cease operation and exit */
-    furi_thread_flags_set(furi_thread_get_id(game->sound_thread), SoundThreadFlagExit);
-    furi_thread_join(game->sound_thread);
+    /* Signal the emulation thread to cease operation and exit */
+    furi_thread_flags_set(furi_thread_get_id(game->emulation_thread), EmulationThreadFlagExit);
+    furi_thread_join(game->emulation_thread);
+#if LATENCY_PROBES
+    game_dump_latency(game);
+#endif
 }
 
 static bool game_input_callback(InputEvent* input_event, void* context) {
     furi_check(context, "game_input_callback");
     Game* game = context;
-
-    FURI_LOG_D(
-        "chip8",
-        "input %s %s",
-        input_get_key_name(input_event->key),
-        input_get_type_name(input_event->type));
+#if LATENCY_PROBES
+    const uint32_t input_time = furi_get_tick(); // before waiting for the model
+#endif
+    const bool is_press = input_event->type == InputTypePress;
 
     if(input_event->key == InputKeyBack) {
         game_end(game);
         return false;
     }
 
+    if(input_event->key == InputKeyOk && input_event->type == InputTypeLong) {
+        with_view_model(
+            game->view,
+            GameData * data,
+            { data->overlay.is_visible = !data->overlay.is_visible; },
+            true);
+        return true;
+    }
+
     with_view_model(
         game->view,
         GameData * data,
         {
+            if(is_press) latency_input(&data->latency, input_time);
             game_data_update(data);
             const word key_bitfield =
                 button_config_map_input_to_keys(data->button_config, input_event);
             vm_set_keys(data->vm, key_bitfield);
+            if(is_press) latency_keys_set(&data->latency, data->vm, furi_get_tick());
+            TRACE_EVENT(
+                TraceEventInput, input_event->key << 8 | input_event->type, key_bitfield);
         },
         false);
+    furi_thread_flags_set(furi_thread_get_id(game->emulation_thread), EmulationThreadFlagInput);
 
     return true;
 }
@@ -164,11 +292,23 @@ static void game_exit_callback(void* context) {
 }
 
 Game* game_alloc() {
-    Game* game = malloc(sizeof(Game));
+    trace_init(furi_get_tick);
+
+    GameArena* arena = malloc(sizeof(GameArena));
+    FURI_LOG_I(
+        "chip8",
+        "arena footprint: %u bytes (vm %u, button config %u, renderer %u)",
+        sizeof(GameArena),
+        sizeof(VM),
+        sizeof(ButtonConfig),
+        sizeof(Renderer));
+
+    Game* game = &arena->game;
+    game->frame_callback = NULL;
     void* context = game;
 
-    game->sound_thread =
-        furi_thread_alloc_ex("sound thread", 1024U, sound_thread_callback, context);
+    game->emulation_thread =
+        furi_thread_alloc_ex("emulation thread", 2048U, emulation_thread_callback, context);
 
     game->view = view_alloc();
 
@@ -177,9 +317,13 @@ Game* game_alloc() {
         game->view,
         GameData * data,
         {
-            data->vm = vm_alloc();
-            data->button_config = button_config_alloc(BUTTON_CONFIG_PATH);
-            data->sound_thread_id = furi_thread_get_id(game->sound_thread);
+            data->vm = &arena->vm;
+            data->button_config = &arena->button_config;
+            button_config_init(data->button_config, BUTTON_CONFIG_PATH);
+            data->renderer = &arena->renderer;
+            renderer_init(data->renderer);
+            overlay_init(&data->overlay);
+            data->emulation_thread_id = furi_thread_get_id(game->emulation_thread);
         },
         false);
 
@@ -193,17 +337,40 @@ Game* game_alloc() {
     return game;
 }
 
+#if TRACE_LEVEL > TRACE_LEVEL_OFF
+static void game_write_trace(void* context, const void* data, size_t size) {
+    stream_write(context, data, size);
+}
+
+/* Decode with chip8-test/trace_decode. */
+static void game_dump_trace() {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    Stream* stream = file_stream_alloc(storage);
+    if(file_stream_open(stream, GAME_TRACE_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        trace_dump(game_write_trace, stream);
+        file_stream_close(stream);
+    } else {
+        FURI_LOG_E("chip8", "failed to save trace");
+    }
+    stream_free(stream);
+    furi_record_close(RECORD_STORAGE);
+}
+#endif
+
 void game_free(Game* game) {
+#if TRACE_LEVEL > TRACE_LEVEL_OFF
+    game_dump_trace();
+#endif
     with_view_model(
         game->view,
         GameData * data,
         {
-            button_config_free(data->button_config, BUTTON_CONFIG_PATH);
-            vm_free(data->vm);
+            button_config_deinit(data->button_config, BUTTON_CONFIG_PATH);
         },
         false);
-    furi_thread_free(game->sound_thread);
+    furi_thread_free(game->emulation_thread);
     view_free(game->view);
+    /* the game is the first member of its arena */
     free(game);
 }
 
@@ -211,39 +378,87 @@ View* game_get_view(Game* game) {
     return game->view;
 }
 
-static void game_data_load(GameData* data, FuriString* path) {
-    FURI_LOG_D("chip8", "loading file '%s'", furi_string_get_cstr(path));
-
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    Stream* stream = file_stream_alloc(storage);
+void game_set_frame_callback(Game* game, GameFrameCallback callback, void* context) {
+    game->frame_callback = callback;
+    game->frame_context = context;
+}
 
-    FURI_LOG_D("chip8", "----------------------------------------");
-    FURI_LOG_D("chip8", "bytecode:");
+void game_commit_frame(Game* game) {
+    bool is_frame_due = false;
+    with_view_model(
+        game->view,
+        GameData * data,
+        {
+            data->is_frame_pending = false;
+            is_frame_due = data->frames_due > 0;
+        },
+        true);
+    // a frame posted just before the game ended may still arrive
+    if(is_frame_due && furi_thread_get_state(game->emulation_thread) == FuriThreadStateRunning) {
+        furi_thread_flags_set(
+            furi_thread_get_id(game->emulation_thread), EmulationThreadFlagFrame);
+    }
+}
 
-    uint8_t c[1];
-    furi_check(
-        file_stream_open(stream, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING));
+static void game_data_write_prog(void* context, const size_t offset, const byte value) {
+    GameData* data = context;
+    vm_write_prog_to_memory(data->vm, offset, value);
+}
 
-    for(size_t addr = 0; !stream_eof(stream); addr++) {
-        furi_check(stream_read(stream, c, 1));
-        vm_write_prog_to_memory(data->vm, addr, *c);
-        FURI_LOG_D("chip8", "%d: %u", addr, *c);
-    }
+// 0 if the ROM could not be read, see rom_file_read
+static size_t game_data_load(GameData* data, FuriString* path) {
+    FURI_LOG_D("chip8", "loading file '%s'", furi_string_get_cstr(path));
 
-    file_stream_close(stream);
-    stream_free(stream);
+    // a ROM that failed to load part way leaves no bytes behind for the next one
+    memset(data->vm->memory + PROG_START, 0, MEMORY_SIZE - PROG_START);
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    const size_t prog_size = rom_file_read(
+        storage,
+        furi_string_get_cstr(path),
+        MEMORY_SIZE - PROG_START,
+        game_data_write_prog,
+        data);
     furi_record_close(RECORD_STORAGE);
+    return prog_size;
+}
+
+/* Picks the quirks from the instructions the ROM runs at start-up, rather than
+ * switching only once the first SUPER-CHIP instruction executes. */
+static void game_data_analyze(GameData* data, const size_t prog_size) {
+    const uint32_t features = rom_entry_features(data->vm->memory + PROG_START, prog_size);
+    FURI_LOG_I("chip8", "entry features 0x%lx", features);
+    if(features & ROM_FEATURES_SUPERCHIP) vm_set_superchip(data->vm, true);
 }
 
-void game_start(Game* game, FuriString* path) {
+// false, with nothing started, if the ROM could not be read
+static bool game_data_start(GameData* data, FuriString* path) {
+    const size_t prog_size = game_data_load(data, path);
+    if(prog_size == 0) return false;
+    rom_settings_load(&data->rom_settings, furi_string_get_cstr(path));
+    vm_start(data->vm, furi_get_tick());
+    vm_set_frame_pacing(
+        data->vm,
+        data->rom_settings.instructions_per_sec,
+        data->rom_settings.max_catchup_frames,
+        data->rom_settings.is_auto_tuned);
+    vm_set_vip_timing(data->vm, data->rom_settings.is_vip_timing);
+    renderer_set_flicker_filter(
+        data->renderer, data->rom_settings.flicker_filter, data->rom_settings.flicker_frames);
+    game_data_analyze(data, prog_size);
+    data->framed_screen_changes = vm_get_screen_changes(data->vm);
+    data->frames_due = 1;
+    data->is_frame_pending = false;
+    data->last_frame = furi_get_tick() - FRAME_PERIOD_MS;
+    latency_reset(&data->latency);
+    TRACE_EVENT(TraceEventStart, data->rom_settings.instructions_per_sec, prog_size);
+    return true;
+}
+
+bool game_start(Game* game, FuriString* path) {
+    bool is_loaded = false;
     with_view_model(
-        game->view,
-        GameData * data,
-        {
-            game_data_load(data, path);
-            vm_start(data->vm, furi_get_tick());
-        },
-        false);
+        game->view, GameData * data, { is_loaded = game_data_start(data, path); }, false);
 
-    furi_thread_start(game->sound_thread);
+    if(is_loaded) furi_thread_start(game->emulation_thread);
+    return is_loaded;
 }
\ No newline at end of file
@@ -3,13 +3,28 @@
 #include <gui/view.h>
 
 #define GAME_DATA_PATH (EXT_PATH("chip8"))
+#define GAME_TRACE_PATH (EXT_PATH("chip8/chip8.trace"))
+#define GAME_LATENCY_PATH (EXT_PATH("chip8/chip8.latency"))
 
 typedef struct Chip8Game Game;
 
+// called from the emulation thread when a new frame is ready to be drawn
+typedef void (*GameFrameCallback)(void* context);
+
 Game* game_alloc();
 
 View* game_get_view(Game* game);
 
-void game_start(Game* game, FuriString* path);
+// false if the ROM could not be read, e.g. a damaged .c8z or a file that is gone
+bool game_start(Game* game, FuriString* path);
+
+/* The game does not redraw on its own. It calls the frame callback, at most
+ * 60 times a second and only when the screen changed, and the owner answers with
+ * game_commit_frame from its own thread, typically through a custom event of
+ * the view dispatcher. */
+void game_set_frame_callback(Game* game, GameFrameCallback callback, void* context);
+
+// redraws the game view, allowing the next frame callback
+void game_commit_frame(Game* game);
 
 void game_free(Game* game);
@@ -0,0 +1,124 @@
+#include "latency.h"
+
+#if LATENCY_PROBES
+
+#include <stdio.h>
+#include <string.h>
+
+#define LATENCY_STAGE_NAME(id, name, span) name,
+static const char* const LATENCY_STAGE_NAMES[] = {LATENCY_STAGES(LATENCY_STAGE_NAME)};
+#undef LATENCY_STAGE_NAME
+
+#define LATENCY_STAGE_SPAN(id, name, span) span,
+static const char* const LATENCY_STAGE_SPANS[] = {LATENCY_STAGES(LATENCY_STAGE_SPAN)};
+#undef LATENCY_STAGE_SPAN
+
+void latency_reset(LatencyProbes* probes) {
+    memset(probes, 0, sizeof(LatencyProbes));
+}
+
+static void add_sample(LatencyProbes* probes, const LatencyStage stage, const uint32_t ms) {
+    LatencyHistogram* histogram = &probes->stages[stage];
+    if(histogram->count == 0 || ms < histogram->min) histogram->min = ms;
+    if(ms > histogram->max) histogram->max = ms;
+    histogram->count++;
+    size_t bucket = ms / LATENCY_BUCKET_MS;
+    if(bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    if(histogram->buckets[bucket] < UINT16_MAX) histogram->buckets[bucket]++;
+}
+
+// ends the stage that began at stage_time, the next one begins now
+static void end_stage(LatencyProbes* probes, const LatencyStage stage, const uint32_t now) {
+    add_sample(probes, stage, now - probes->stage_time);
+    probes->stage_time = now;
+}
+
+void latency_input(LatencyProbes* probes, const uint32_t now) {
+    if(probes->state != LatencyProbeIdle) probes->abandoned++;
+    probes->state = LatencyProbeInput;
+    probes->input_time = now;
+    probes->stage_time = now;
+}
+
+void latency_keys_set(LatencyProbes* probes, VM* vm, const uint32_t now) {
+    if(probes->state != LatencyProbeInput) return;
+    end_stage(probes, LatencyStageQueue, now);
+    probes->key_observations = vm_get_key_observations(vm);
+    probes->state = LatencyProbeKeySet;
+}
+
+/* Both VM stages can end in the same update, a program that reads the key and
+ * draws right away has a program stage of 0 ms. */
+void latency_update(LatencyProbes* probes, VM* vm, const uint32_t now) {
+    if(probes->state == LatencyProbeKeySet &&
+       vm_get_key_observations(vm) != probes->key_observations) {
+        end_stage(probes, LatencyStagePacing, now);
+        probes->screen_changes = vm_get_screen_changes(vm);
+        probes->state = LatencyProbeKeyRead;
+    }
+    if(probes->state == LatencyProbeKeyRead &&
+       vm_get_screen_changes(vm) != probes->screen_changes) {
+        end_stage(probes, LatencyStageProgram, now);
+        probes->state = LatencyProbeScreenChanged;
+    }
+}
+
+void latency_draw(LatencyProbes* probes, const uint32_t now) {
+    if(probes->state != LatencyProbeScreenChanged) return;
+    end_stage(probes, LatencyStageRender, now);
+    add_sample(probes, LatencyStageTotal, now - probes->input_time);
+    probes->state = LatencyProbeIdle;
+}
+
+// the upper end of the bucket that holds the given share of the samples
+static uint32_t percentile(const LatencyHistogram* histogram, const uint32_t percent) {
+    const uint32_t rank = (histogram->count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for(size_t bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+        seen += histogram->buckets[bucket];
+        if(seen >= rank) {
+            const uint32_t upper = (bucket + 1) * LATENCY_BUCKET_MS - 1;
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void latency_dump(const LatencyProbes* probes, LatencyWriteCallback write, void* context) {
+    char line[128];
+    snprintf(
+        line,
+        sizeof(line),
+        "%-8s %6s %6s %6s %6s %6s  ms, %u ms buckets\n",
+        "stage",
+        "count",
+        "min",
+        "median",
+        "p99",
+        "max",
+        LATENCY_BUCKET_MS);
+    write(context, line);
+    for(size_t stage = 0; stage < LatencyStageMAX; stage++) {
+        const LatencyHistogram* histogram = &probes->stages[stage];
+        snprintf(
+            line,
+            sizeof(line),
+            "%-8s %6lu %6lu %6lu %6lu %6lu  %s\n",
+            LATENCY_STAGE_NAMES[stage],
+            (unsigned long)histogram->count,
+            (unsigned long)histogram->min,
+            (unsigned long)percentile(histogram, 50),
+            (unsigned long)percentile(histogram, 99),
+            (unsigned long)histogram->max,
+            LATENCY_STAGE_SPANS[stage]);
+        write(context, line);
+    }
+    snprintf(
+        line,
+        sizeof(line),
+        "%lu presses abandoned, unread or overtaken\n",
+        (unsigned long)probes->abandoned);
+    write(context, line);
+}
+
+#endif
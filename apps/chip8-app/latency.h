@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+/* Input-to-photon latency, measured one key press at a time. A press is followed
+ * from the input callback through vm_set_keys and the first instruction that
+ * reads the key to the screen change that follows and the draw that shows it.
+ * Each stage goes into a histogram of its own, reported when the game ends.
+ * Without LATENCY_PROBES the probes compile to nothing, arguments included.
+ *
+ * The VM stages are timed at the end of the update that ran them, which is when
+ * the rest of the app can see their effect. */
+
+#ifndef LATENCY_PROBES
+#ifdef FURI_DEBUG
+#define LATENCY_PROBES 1
+#else
+#define LATENCY_PROBES 0
+#endif
+#endif
+
+#define LATENCY_BUCKETS 64
+#define LATENCY_BUCKET_MS 2 // the last bucket collects everything slower
+
+// name and span of every stage, the total spans them all
+#define LATENCY_STAGES(X)                                                 \
+    X(LatencyStageQueue, "queue", "input callback until vm_set_keys")     \
+    X(LatencyStagePacing, "pacing", "until an instruction reads the key") \
+    X(LatencyStageProgram, "program", "until the screen changes")         \
+    X(LatencyStageRender, "render", "until the change is drawn")          \
+    X(LatencyStageTotal, "total", "input callback until drawn")
+
+#define LATENCY_STAGE_ENUM(id, name, span) id,
+typedef enum {
+    LATENCY_STAGES(LATENCY_STAGE_ENUM) LatencyStageMAX,
+} LatencyStage;
+#undef LATENCY_STAGE_ENUM
+
+typedef struct {
+    uint32_t count;
+    uint32_t min, max; // ms
+    uint16_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+typedef enum {
+    LatencyProbeIdle,
+    LatencyProbeInput, // in the input callback
+    LatencyProbeKeySet, // waiting for the program to read the key
+    LatencyProbeKeyRead, // waiting for a screen change
+    LatencyProbeScreenChanged, // waiting for a draw
+} LatencyProbeState;
+
+typedef struct {
+    LatencyHistogram stages[LatencyStageMAX];
+    uint32_t abandoned; // presses the program ignored, or that a newer one overtook
+
+    // the press in flight
+    LatencyProbeState state;
+    uint32_t input_time, stage_time; // ms
+    uint32_t key_observations, screen_changes; // of the VM when the stage began
+} LatencyProbes;
+
+typedef void (*LatencyWriteCallback)(void* context, const char* line);
+
+#if LATENCY_PROBES
+
+void latency_reset(LatencyProbes* probes);
+
+// a key press reached the input callback
+void latency_input(LatencyProbes* probes, const uint32_t now);
+// after vm_set_keys passed it on
+void latency_keys_set(LatencyProbes* probes, VM* vm, const uint32_t now);
+// after every vm_update
+void latency_update(LatencyProbes* probes, VM* vm, const uint32_t now);
+// in the draw callback
+void latency_draw(LatencyProbes* probes, const uint32_t now);
+
+// a line per stage with count, min, median, p99 and max, the bucket width apart
+void latency_dump(const LatencyProbes* probes, LatencyWriteCallback write, void* context);
+
+#else
+
+#define latency_reset(probes) ((void)0)
+#define latency_input(probes, now) ((void)0)
+#define latency_keys_set(probes, vm, now) ((void)0)
+#define latency_update(probes, vm, now) ((void)0)
+#define latency_draw(probes, now) ((void)0)
+#define latency_dump(probes, write, context) ((void)0)
+
+#endif
@@ -0,0 +1,494 @@
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <storage/storage.h>
+
+#include "analyzer.h"
+#include "library.h"
+#include "rom_file.h"
+#include "vm_i.h"
+
+#define LIBRARY_MAGIC "C8LB"
+#define LIBRARY_VERSION 1
+#define LIBRARY_RECORD_SIZE (sizeof(LibraryEntry) + LIBRARY_THUMBNAIL_SIZE)
+#define LIBRARY_MAX_DEPTH 2 // subdirectories below the library directory
+#define LIBRARY_MAX_ROM_SIZE (MEMORY_SIZE - PROG_START)
+#define LIBRARY_NOT_CACHED SIZE_MAX
+
+struct Chip8Library {
+    FuriString* base_path;
+    FuriString* index_path;
+    FuriMutex* mutex; // guards the entries and the index file
+    LibraryEntry* entries;
+    size_t num_entries;
+    volatile bool is_cancelled;
+};
+
+/* A growing array of entries, filled while scanning the directory. */
+typedef struct {
+    LibraryEntry* entries;
+    size_t* cached; // index of an unchanged entry of the library, or LIBRARY_NOT_CACHED
+    size_t num_entries;
+    size_t capacity;
+} LibraryList;
+
+/* What indexing a new or modified ROM needs, allocated on first use. */
+typedef struct {
+    Library* library;
+    Storage* storage;
+    File* cached_index; // the previous index, for thumbnails of renamed ROMs
+    FuriString* path;
+    byte* rom;
+    VM* vm;
+} LibraryIndexer;
+
+Library* library_alloc(const char* base_path) {
+    Library* library = malloc(sizeof(Library));
+    library->base_path = furi_string_alloc_set_str(base_path);
+    library->index_path = furi_string_alloc_printf("%s/%s", base_path, LIBRARY_INDEX_NAME);
+    library->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    library->entries = NULL;
+    library->num_entries = 0;
+    library->is_cancelled = false;
+    return library;
+}
+
+void library_free(Library* library) {
+    free(library->entries);
+    furi_mutex_free(library->mutex);
+    furi_string_free(library->index_path);
+    furi_string_free(library->base_path);
+    free(library);
+}
+
+static void
+    library_set_entries(Library* library, LibraryEntry* entries, const size_t num_entries) {
+    furi_check(furi_mutex_acquire(library->mutex, FuriWaitForever) == FuriStatusOk);
+    free(library->entries);
+    library->entries = entries;
+    library->num_entries = num_entries;
+    furi_mutex_release(library->mutex);
+}
+
+static uint32_t library_get_record_offset(const size_t index) {
+    return sizeof(LibraryHeader) + index * LIBRARY_RECORD_SIZE;
+}
+
+/* The number of entries comes from the SD card, it is only believed if the file
+ * holds that many records, which also bounds what library_load allocates. */
+static bool library_read_header(File* file, LibraryHeader* header) {
+    return storage_file_read(file, header, sizeof(LibraryHeader)) == sizeof(LibraryHeader) &&
+           memcmp(header->magic, LIBRARY_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == LIBRARY_VERSION && header->record_size == LIBRARY_RECORD_SIZE &&
+           header->num_entries <=
+               (storage_file_size(file) - sizeof(LibraryHeader)) / LIBRARY_RECORD_SIZE;
+}
+
+bool library_load(Library* library) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+
+    LibraryEntry* entries = NULL;
+    LibraryHeader header;
+    bool is_loaded = false;
+    if(storage_file_open(
+           file, furi_string_get_cstr(library->index_path), FSAM_READ, FSOM_OPEN_EXISTING) &&
+       library_read_header(file, &header)) {
+        entries = malloc(header.num_entries * sizeof(LibraryEntry) + 1);
+        is_loaded = true;
+        for(size_t j = 0; j < header.num_entries && is_loaded; j++) {
+            is_loaded = storage_file_seek(file, library_get_record_offset(j), true) &&
+                        storage_file_read(file, &entries[j], sizeof(LibraryEntry)) ==
+                            sizeof(LibraryEntry);
+            entries[j].name[LIBRARY_NAME_SIZE - 1] = '\0';
+        }
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+
+    if(!is_loaded) {
+        FURI_LOG_W("chip8", "no valid library index");
+        free(entries);
+        return false;
+    }
+    FURI_LOG_I("chip8", "library index: %lu roms", header.num_entries);
+    library_set_entries(library, entries, header.num_entries);
+    return true;
+}
+
+static void library_list_add(LibraryList* list, const LibraryEntry* entry) {
+    if(list->num_entries == list->capacity) {
+        list->capacity = list->capacity ? 2 * list->capacity : 16;
+        list->entries = realloc(list->entries, list->capacity * sizeof(LibraryEntry));
+        list->cached = realloc(list->cached, list->capacity * sizeof(size_t));
+    }
+    list->entries[list->num_entries] = *entry;
+    list->cached[list->num_entries] = LIBRARY_NOT_CACHED;
+    list->num_entries++;
+}
+
+static void library_list_free(LibraryList* list) {
+    free(list->entries);
+    free(list->cached);
+}
+
+static int library_compare_entries(const void* a, const void* b) {
+    return strcmp(((const LibraryEntry*)a)->name, ((const LibraryEntry*)b)->name);
+}
+
+/* Adds the ROMs below base_path/relative, relative is empty for the library
+ * directory itself. Subdirectories are listed first and descended into once the
+ * directory is closed again. */
+static void library_scan_dir(
+    Library* library,
+    Storage* storage,
+    const char* relative,
+    const size_t depth,
+    LibraryList* list) {
+    FuriString* path = furi_string_alloc_set(library->base_path);
+    if(relative[0] != '\0') furi_string_cat_printf(path, "/%s", relative);
+    const size_t path_size = furi_string_size(path);
+
+    LibraryList subdirs = {0};
+    File* dir = storage_file_alloc(storage);
+    if(storage_dir_open(dir, furi_string_get_cstr(path))) {
+        FileInfo info;
+        char name[256];
+        LibraryEntry entry;
+        while(storage_dir_read(dir, &info, name, sizeof(name))) {
+            if(name[0] == '.') continue;
+            const bool is_dir = file_info_is_dir(&info);
+            if(!is_dir && !rom_file_is_rom(name)) continue;
+            if(is_dir && depth >= LIBRARY_MAX_DEPTH) continue;
+
+            const int size =
+                relative[0] != '\0' ?
+                    snprintf(entry.name, sizeof(entry.name), "%s/%s", relative, name) :
+                    snprintf(entry.name, sizeof(entry.name), "%s", name);
+            if(size < 0 || (size_t)size >= sizeof(entry.name)) {
+                FURI_LOG_W("chip8", "library: path too long, skipping '%s'", name);
+                continue;
+            }
+            if(is_dir) {
+                library_list_add(&subdirs, &entry);
+                continue;
+            }
+            if(info.size > LIBRARY_MAX_ROM_SIZE) {
+                FURI_LOG_W("chip8", "library: rom too large, skipping '%s'", entry.name);
+                continue;
+            }
+
+            furi_string_left(path, path_size);
+            furi_string_cat_printf(path, "/%s", name);
+            entry.size = info.size;
+            entry.timestamp = 0;
+            storage_common_timestamp(storage, furi_string_get_cstr(path), &entry.timestamp);
+            entry.hash = 0;
+            entry.features = 0;
+            library_list_add(list, &entry);
+        }
+    }
+    storage_dir_close(dir);
+    storage_file_free(dir);
+    furi_string_free(path);
+
+    for(size_t j = 0; j < subdirs.num_entries; j++) {
+        library_scan_dir(library, storage, subdirs.entries[j].name, depth + 1, list);
+    }
+    library_list_free(&subdirs);
+}
+
+/* Matches the scanned ROMs with the unchanged entries of the index, both are
+ * sorted by name. Returns true if the index needs to be written again. Only
+ * library_update replaces the entries, so it reads them without the lock. */
+static bool library_match_cached(Library* library, LibraryList* list) {
+    bool is_changed = list->num_entries != library->num_entries;
+    for(size_t j = 0; j < list->num_entries; j++) {
+        LibraryEntry* entry = &list->entries[j];
+        const LibraryEntry* cached = bsearch(
+            entry,
+            library->entries,
+            library->num_entries,
+            sizeof(LibraryEntry),
+            library_compare_entries);
+        if(cached && cached->size == entry->size && cached->timestamp == entry->timestamp) {
+            *entry = *cached;
+            list->cached[j] = cached - library->entries;
+        } else {
+            is_changed = true;
+        }
+    }
+    return is_changed;
+}
+
+static uint32_t library_hash(const byte* data, const size_t size) {
+    uint32_t hash = 2166136261UL;
+    for(size_t j = 0; j < size; j++) {
+        hash ^= data[j];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static bool library_read_cached_thumbnail(
+    LibraryIndexer* indexer,
+    const size_t index,
+    byte* thumbnail) {
+    return indexer->cached_index &&
+           storage_file_seek(
+               indexer->cached_index,
+               library_get_record_offset(index) + sizeof(LibraryEntry),
+               true) &&
+           storage_file_read(indexer->cached_index, thumbnail, LIBRARY_THUMBNAIL_SIZE) ==
+               LIBRARY_THUMBNAIL_SIZE;
+}
+
+/* Scales the screen down to the thumbnail size, a thumbnail pixel is lit if any
+ * of the screen pixels it covers is. */
+static void library_render_thumbnail(VM* vm, byte* thumbnail) {
+    const int width = vm_get_screen_width(vm);
+    const int height = vm_get_screen_height(vm);
+    const int scale = width / LIBRARY_THUMBNAIL_WIDTH;
+    byte row[MAX_SCREEN_WIDTH / 8];
+
+    memset(thumbnail, 0, LIBRARY_THUMBNAIL_SIZE);
+    for(int y = 0; y < height; y++) {
+        vm_get_screen_row(vm, y, row);
+        byte* thumbnail_row = thumbnail + y / scale * (LIBRARY_THUMBNAIL_WIDTH / 8);
+        for(int x = 0; x < width; x++) {
+            if(row[x / 8] & (0x80 >> (x % 8))) {
+                thumbnail_row[x / scale / 8] |= 1 << (x / scale % 8);
+            }
+        }
+    }
+}
+
+/* Runs the ROM for LIBRARY_PREVIEW_MS without input, with the quirks the game
+ * would pick and the content hash as seed so that thumbnails are reproducible.
+ * Returns false if library_cancel_update stopped it: the game that is starting
+ * needs the memory of the preview VM and should not wait for it. */
+static bool library_run_preview(
+    LibraryIndexer* indexer,
+    const LibraryEntry* entry,
+    const size_t prog_size,
+    byte* thumbnail) {
+    if(!indexer->vm) indexer->vm = vm_alloc();
+    VM* vm = indexer->vm;
+
+    for(size_t addr = 0; addr < LIBRARY_MAX_ROM_SIZE; addr++) {
+        vm_write_prog_to_memory(vm, addr, addr < prog_size ? indexer->rom[addr] : 0x00);
+    }
+    vm_start(vm, 0);
+    vm_set_seed(vm, entry->hash);
+    if(rom_entry_features(indexer->rom, prog_size) & ROM_FEATURES_SUPERCHIP) {
+        vm_set_superchip(vm, true);
+    }
+
+    for(uint32_t timestamp = MS_PER_TIMER_TICK; timestamp <= LIBRARY_PREVIEW_MS;
+        timestamp += MS_PER_TIMER_TICK) {
+        if(indexer->library->is_cancelled) return false;
+        if(!vm_update(vm, timestamp) || vm_is_game_over(vm)) break;
+    }
+    library_render_thumbnail(vm, thumbnail);
+    return true;
+}
+
+static void library_write_rom(void* context, const size_t offset, const byte value) {
+    byte* rom = context;
+    rom[offset] = value;
+}
+
+/* Fills in hash, features and thumbnail of a new or modified ROM. A ROM with the
+ * content of an entry in the index, renamed or merely touched, reuses its
+ * thumbnail instead of running again. */
+static bool library_index_rom(LibraryIndexer* indexer, LibraryEntry* entry, byte* thumbnail) {
+    Library* library = indexer->library;
+    if(!indexer->rom) indexer->rom = malloc(LIBRARY_MAX_ROM_SIZE);
+
+    furi_string_printf(
+        indexer->path, "%s/%s", furi_string_get_cstr(library->base_path), entry->name);
+    const size_t prog_size = rom_file_read(
+        indexer->storage,
+        furi_string_get_cstr(indexer->path),
+        LIBRARY_MAX_ROM_SIZE,
+        library_write_rom,
+        indexer->rom);
+    if(prog_size == 0) return false;
+
+    entry->hash = library_hash(indexer->rom, prog_size);
+    for(size_t j = 0; j < library->num_entries; j++) {
+        const LibraryEntry* cached = &library->entries[j];
+        if(cached->hash == entry->hash && cached->size == entry->size &&
+           library_read_cached_thumbnail(indexer, j, thumbnail)) {
+            entry->features = cached->features;
+            return true;
+        }
+    }
+
+    FURI_LOG_D("chip8", "library: indexing '%s'", entry->name);
+    // the picker shows the features anywhere in the ROM, the preview needs no analysis
+    RomAnalysis* analysis = rom_analysis_alloc();
+    rom_analyze(analysis, indexer->rom, prog_size);
+    entry->features = analysis->features;
+    rom_analysis_free(analysis);
+    return library_run_preview(indexer, entry, prog_size, thumbnail);
+}
+
+// frees the VM and ROM of the previews, which may be allocated again later
+static void library_indexer_release(LibraryIndexer* indexer) {
+    if(indexer->vm) vm_free(indexer->vm);
+    indexer->vm = NULL;
+    free(indexer->rom);
+    indexer->rom = NULL;
+}
+
+/* Writes the records of the scanned ROMs to a new index, removing the ROMs that
+ * could not be indexed from the list. Once the update is cancelled the VM and ROM
+ * of the previews go at once, the records that are left only copy thumbnails. */
+static bool library_write_index(
+    LibraryIndexer* indexer,
+    LibraryList* list,
+    const char* index_path) {
+    File* file = storage_file_alloc(indexer->storage);
+    if(!storage_file_open(file, index_path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        storage_file_free(file);
+        return false;
+    }
+
+    LibraryHeader header;
+    memcpy(header.magic, LIBRARY_MAGIC, sizeof(header.magic));
+    header.version = LIBRARY_VERSION;
+    header.record_size = LIBRARY_RECORD_SIZE;
+    header.num_entries = 0;
+    bool is_written = storage_file_write(file, &header, sizeof(header)) == sizeof(header);
+
+    byte thumbnail[LIBRARY_THUMBNAIL_SIZE];
+    for(size_t j = 0; j < list->num_entries && is_written; j++) {
+        LibraryEntry* entry = &list->entries[j];
+        bool is_indexed;
+        if(indexer->library->is_cancelled) library_indexer_release(indexer);
+        if(list->cached[j] != LIBRARY_NOT_CACHED) {
+            is_indexed = library_read_cached_thumbnail(indexer, list->cached[j], thumbnail);
+        } else {
+            is_indexed = !indexer->library->is_cancelled &&
+                         library_index_rom(indexer, entry, thumbnail);
+        }
+        if(!is_indexed) continue;
+
+        list->entries[header.num_entries++] = *entry;
+        is_written = storage_file_write(file, entry, sizeof(LibraryEntry)) ==
+                         sizeof(LibraryEntry) &&
+                     storage_file_write(file, thumbnail, sizeof(thumbnail)) == sizeof(thumbnail);
+    }
+    list->num_entries = header.num_entries;
+
+    is_written = is_written && storage_file_seek(file, 0, true) &&
+                 storage_file_write(file, &header, sizeof(header)) == sizeof(header);
+    storage_file_close(file);
+    storage_file_free(file);
+    return is_written;
+}
+
+bool library_update(Library* library) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+
+    LibraryList list = {0};
+    library_scan_dir(library, storage, "", 0, &list);
+    qsort(list.entries, list.num_entries, sizeof(LibraryEntry), library_compare_entries);
+    const bool is_changed = library_match_cached(library, &list);
+
+    bool is_written = false;
+    if(is_changed) {
+        LibraryIndexer indexer = {
+            .library = library,
+            .storage = storage,
+            .cached_index = storage_file_alloc(storage),
+            .path = furi_string_alloc(),
+        };
+        const char* index_path = furi_string_get_cstr(library->index_path);
+        if(!storage_file_open(indexer.cached_index, index_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+            storage_file_free(indexer.cached_index);
+            indexer.cached_index = NULL;
+        }
+
+        FuriString* new_index_path = furi_string_alloc_printf("%s.tmp", index_path);
+        is_written = library_write_index(&indexer, &list, furi_string_get_cstr(new_index_path));
+
+        if(indexer.cached_index) {
+            storage_file_close(indexer.cached_index);
+            storage_file_free(indexer.cached_index);
+        }
+        library_indexer_release(&indexer);
+        furi_string_free(indexer.path);
+
+        if(is_written) {
+            /* readers of the index take the lock, so they never see it half replaced */
+            furi_check(furi_mutex_acquire(library->mutex, FuriWaitForever) == FuriStatusOk);
+            storage_common_remove(storage, index_path);
+            is_written = storage_common_rename(
+                             storage, furi_string_get_cstr(new_index_path), index_path) ==
+                         FSE_OK;
+            if(is_written) {
+                free(library->entries);
+                library->entries = list.entries;
+                library->num_entries = list.num_entries;
+                list.entries = NULL;
+            }
+            furi_mutex_release(library->mutex);
+        }
+        if(!is_written) FURI_LOG_E("chip8", "failed to save library index");
+        furi_string_free(new_index_path);
+    }
+    furi_record_close(RECORD_STORAGE);
+
+    FURI_LOG_I(
+        "chip8",
+        "library: %u roms, index %s",
+        list.num_entries,
+        is_changed ? "updated" : "current");
+    library_list_free(&list);
+    return is_written;
+}
+
+void library_cancel_update(Library* library) {
+    library->is_cancelled = true;
+}
+
+size_t library_get_size(Library* library) {
+    furi_check(furi_mutex_acquire(library->mutex, FuriWaitForever) == FuriStatusOk);
+    const size_t size = library->num_entries;
+    furi_mutex_release(library->mutex);
+    return size;
+}
+
+bool library_get_entry(Library* library, const size_t index, LibraryEntry* entry) {
+    furi_check(furi_mutex_acquire(library->mutex, FuriWaitForever) == FuriStatusOk);
+    const bool is_valid = index < library->num_entries;
+    if(is_valid) *entry = library->entries[index];
+    furi_mutex_release(library->mutex);
+    return is_valid;
+}
+
+bool library_read_thumbnail(Library* library, const size_t index, byte* thumbnail) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+
+    furi_check(furi_mutex_acquire(library->mutex, FuriWaitForever) == FuriStatusOk);
+    const bool is_read =
+        index < library->num_entries &&
+        storage_file_open(
+            file, furi_string_get_cstr(library->index_path), FSAM_READ, FSOM_OPEN_EXISTING) &&
+        storage_file_seek(file, library_get_record_offset(index) + sizeof(LibraryEntry), true) &&
+        storage_file_read(file, thumbnail, LIBRARY_THUMBNAIL_SIZE) == LIBRARY_THUMBNAIL_SIZE;
+    storage_file_close(file);
+    furi_mutex_release(library->mutex);
+
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return is_read;
+}
+
+void library_get_path(Library* library, const LibraryEntry* entry, FuriString* path) {
+    furi_string_printf(path, "%s/%s", furi_string_get_cstr(library->base_path), entry->name);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <furi.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+#define LIBRARY_INDEX_NAME "library.idx"
+// including the terminating zero, ROMs with longer paths are left out
+#define LIBRARY_NAME_SIZE 48
+
+// a 1-bit preview of the screen in XBM order, hires screens are scaled down 2x
+#define LIBRARY_THUMBNAIL_WIDTH 64
+#define LIBRARY_THUMBNAIL_HEIGHT 32
+#define LIBRARY_THUMBNAIL_SIZE (LIBRARY_THUMBNAIL_WIDTH / 8 * LIBRARY_THUMBNAIL_HEIGHT)
+// emulated time the VM gets before its screen becomes the thumbnail
+#define LIBRARY_PREVIEW_MS 5000
+
+/* The ROMs below a directory, cached in an index file in that directory so that
+ * the picker does not have to open every ROM. The index is a LibraryHeader
+ * followed by one LibraryEntry and its thumbnail per ROM, sorted by name. */
+
+typedef struct {
+    char magic[4]; // "C8LB"
+    uint16_t version;
+    uint16_t record_size; // entry plus thumbnail
+    uint32_t num_entries;
+} LibraryHeader;
+
+typedef struct {
+    char name[LIBRARY_NAME_SIZE]; // relative to the library directory
+    uint32_t size; // of the file, a packed ROM holds more
+    uint32_t timestamp; // modification time, together with the size detects changes
+    uint32_t hash; // FNV-1a of the content, finds renamed and touched ROMs
+    uint32_t features; // RomFeature from the analyzer
+} LibraryEntry;
+
+typedef struct Chip8Library Library;
+
+Library* library_alloc(const char* base_path);
+
+void library_free(Library* library);
+
+// reads the cached index, which may be out of date, returns false if there is none
+bool library_load(Library* library);
+
+// Brings the index up to date with the directory: unchanged ROMs keep their
+// record, new and modified ones are hashed, analysed and run headlessly for a
+// thumbnail. Returns true if the entries changed. Safe to run in a thread of its
+// own while the other functions are used.
+bool library_update(Library* library);
+
+// makes a running library_update stop, in the middle of a preview if need be,
+// the ROMs indexed so far are kept
+void library_cancel_update(Library* library);
+
+size_t library_get_size(Library* library);
+
+// copies an entry, false if the index is out of range
+bool library_get_entry(Library* library, const size_t index, LibraryEntry* entry);
+
+bool library_read_thumbnail(Library* library, const size_t index, byte* thumbnail);
+
+void library_get_path(Library* library, const LibraryEntry* entry, FuriString* path);
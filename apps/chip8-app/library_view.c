@@ -0,0 +1,189 @@
+#include <furi.h>
+#include <gui/elements.h>
+#include <stdio.h>
+
+#include "analyzer.h"
+#include "library_view.h"
+
+#define LIBRARY_VIEW_THUMBNAIL_X 64
+#define LIBRARY_VIEW_LIST_Y 33
+#define LIBRARY_VIEW_ROW_HEIGHT 10
+#define LIBRARY_VIEW_ROWS 3
+
+struct Chip8LibraryView {
+    View* view;
+    LibraryViewCallback callback;
+    void* context;
+};
+
+typedef struct {
+    Library* library;
+    size_t selected;
+    bool is_updating;
+    bool has_thumbnail;
+    byte thumbnail[LIBRARY_THUMBNAIL_SIZE];
+} LibraryViewModel;
+
+static void library_view_select(LibraryViewModel* model, const size_t selected) {
+    model->selected = selected;
+    model->has_thumbnail = library_read_thumbnail(model->library, selected, model->thumbnail);
+}
+
+static void library_view_draw_details(
+    Canvas* canvas,
+    LibraryViewModel* model,
+    const LibraryEntry* entry,
+    const size_t size) {
+    char line[24];
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(
+        canvas, 0, 8, (entry->features & ROM_FEATURES_SUPERCHIP) ? "SUPER-CHIP" : "CHIP-8");
+    snprintf(line, sizeof(line), "%lu bytes", entry->size);
+    canvas_draw_str(canvas, 0, 18, line);
+    if(model->is_updating) {
+        canvas_draw_str(canvas, 0, 28, "indexing...");
+    } else {
+        snprintf(line, sizeof(line), "%u/%u", model->selected + 1, size);
+        canvas_draw_str(canvas, 0, 28, line);
+    }
+
+    if(model->has_thumbnail) {
+        canvas_draw_xbm(
+            canvas,
+            LIBRARY_VIEW_THUMBNAIL_X,
+            0,
+            LIBRARY_THUMBNAIL_WIDTH,
+            LIBRARY_THUMBNAIL_HEIGHT,
+            model->thumbnail);
+    }
+    canvas_draw_line(
+        canvas,
+        LIBRARY_VIEW_THUMBNAIL_X - 2,
+        0,
+        LIBRARY_VIEW_THUMBNAIL_X - 2,
+        LIBRARY_THUMBNAIL_HEIGHT - 1);
+}
+
+static void library_view_draw_callback(Canvas* canvas, void* _model) {
+    LibraryViewModel* model = _model;
+    canvas_clear(canvas);
+
+    const size_t size = library_get_size(model->library);
+    LibraryEntry entry;
+    if(!library_get_entry(model->library, model->selected, &entry)) {
+        canvas_set_font(canvas, FontSecondary);
+        elements_multiline_text_aligned(
+            canvas,
+            64,
+            32,
+            AlignCenter,
+            AlignCenter,
+            model->is_updating ? "Indexing ROMs..." : "No ROMs found");
+        return;
+    }
+    library_view_draw_details(canvas, model, &entry, size);
+
+    size_t first = model->selected > 0 ? model->selected - 1 : 0;
+    if(size > LIBRARY_VIEW_ROWS && first > size - LIBRARY_VIEW_ROWS) {
+        first = size - LIBRARY_VIEW_ROWS;
+    }
+    FuriString* name = furi_string_alloc();
+    for(size_t row = 0; row < LIBRARY_VIEW_ROWS; row++) {
+        if(!library_get_entry(model->library, first + row, &entry)) break;
+        const size_t y = LIBRARY_VIEW_LIST_Y + row * LIBRARY_VIEW_ROW_HEIGHT;
+        canvas_set_color(canvas, ColorBlack);
+        if(first + row == model->selected) {
+            canvas_draw_box(canvas, 0, y, canvas_width(canvas), LIBRARY_VIEW_ROW_HEIGHT);
+            canvas_set_color(canvas, ColorWhite);
+        }
+        furi_string_set_str(name, entry.name);
+        elements_string_fit_width(canvas, name, canvas_width(canvas) - 4);
+        canvas_draw_str(canvas, 2, y + LIBRARY_VIEW_ROW_HEIGHT - 2, furi_string_get_cstr(name));
+    }
+    furi_string_free(name);
+}
+
+static bool library_view_input_callback(InputEvent* input_event, void* context) {
+    LibraryView* library_view = context;
+    if(input_event->type != InputTypeShort && input_event->type != InputTypeRepeat) {
+        return false;
+    }
+
+    bool is_consumed = false;
+    LibraryEntry entry;
+    bool is_picked = false;
+    with_view_model(
+        library_view->view,
+        LibraryViewModel * model,
+        {
+            const size_t size = library_get_size(model->library);
+            if(input_event->key == InputKeyUp && size > 0) {
+                library_view_select(model, (model->selected + size - 1) % size);
+                is_consumed = true;
+            } else if(input_event->key == InputKeyDown && size > 0) {
+                library_view_select(model, (model->selected + 1) % size);
+                is_consumed = true;
+            } else if(input_event->key == InputKeyOk && input_event->type == InputTypeShort) {
+                is_picked = library_get_entry(model->library, model->selected, &entry);
+                is_consumed = true;
+            }
+        },
+        is_consumed);
+
+    if(is_picked && library_view->callback) {
+        library_view->callback(library_view->context, &entry);
+    }
+    return is_consumed;
+}
+
+LibraryView* library_view_alloc(Library* library) {
+    LibraryView* library_view = malloc(sizeof(LibraryView));
+    library_view->view = view_alloc();
+    library_view->callback = NULL;
+    library_view->context = NULL;
+
+    view_allocate_model(library_view->view, ViewModelTypeLocking, sizeof(LibraryViewModel));
+    with_view_model(
+        library_view->view,
+        LibraryViewModel * model,
+        {
+            model->library = library;
+            model->is_updating = false;
+            library_view_select(model, 0);
+        },
+        false);
+
+    view_set_context(library_view->view, library_view);
+    view_set_draw_callback(library_view->view, library_view_draw_callback);
+    view_set_input_callback(library_view->view, library_view_input_callback);
+    return library_view;
+}
+
+void library_view_free(LibraryView* library_view) {
+    view_free(library_view->view);
+    free(library_view);
+}
+
+View* library_view_get_view(LibraryView* library_view) {
+    return library_view->view;
+}
+
+void library_view_set_callback(
+    LibraryView* library_view,
+    LibraryViewCallback callback,
+    void* context) {
+    library_view->callback = callback;
+    library_view->context = context;
+}
+
+void library_view_refresh(LibraryView* library_view, const bool is_updating) {
+    with_view_model(
+        library_view->view,
+        LibraryViewModel * model,
+        {
+            const size_t size = library_get_size(model->library);
+            model->is_updating = is_updating;
+            library_view_select(model, model->selected < size ? model->selected : 0);
+        },
+        true);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <gui/view.h>
+
+#include "library.h"
+
+/* The ROM picker: the ROMs of a library with the thumbnail, mode and size of the
+ * selected one. */
+typedef struct Chip8LibraryView LibraryView;
+
+typedef void (*LibraryViewCallback)(void* context, const LibraryEntry* entry);
+
+LibraryView* library_view_alloc(Library* library);
+
+void library_view_free(LibraryView* library_view);
+
+View* library_view_get_view(LibraryView* library_view);
+
+// called with the entry the user picked
+void library_view_set_callback(
+    LibraryView* library_view,
+    LibraryViewCallback callback,
+    void* context);
+
+// shows the current entries of the library, e.g. after library_update
+void library_view_refresh(LibraryView* library_view, const bool is_updating);
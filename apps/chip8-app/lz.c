@@ -0,0 +1,92 @@
+#include "lz.h"
+
+#include <string.h>
+
+bool lz_read_header(const byte* header, uint32_t* size) {
+    if(memcmp(header, LZ_MAGIC, 3) != 0 || header[3] != LZ_VERSION) return false;
+    *size = header[4] | header[5] << 8 | header[6] << 16 | (uint32_t)header[7] << 24;
+    return true;
+}
+
+void lz_write_header(byte* header, const uint32_t size) {
+    memcpy(header, LZ_MAGIC, 3);
+    header[3] = LZ_VERSION;
+    for(size_t j = 0; j < 4; j++) header[4 + j] = size >> (8 * j);
+}
+
+void lz_decoder_init(LzDecoder* decoder, const uint32_t size) {
+    decoder->offset = 0;
+    decoder->size = size;
+    decoder->bits = 0;
+    decoder->num_bits = 0;
+    decoder->distance = 0;
+    decoder->state = LzStateTag;
+}
+
+static void
+    lz_output(LzDecoder* decoder, const byte value, LzWriteCallback write, void* context) {
+    decoder->window[decoder->offset % LZ_WINDOW_SIZE] = value;
+    write(context, decoder->offset, value);
+    decoder->offset++;
+}
+
+// takes the next count bits, which must be there
+static uint16_t lz_take(LzDecoder* decoder, const uint8_t count) {
+    decoder->num_bits -= count;
+    return (decoder->bits >> decoder->num_bits) & ((1 << count) - 1);
+}
+
+bool lz_decode(
+    LzDecoder* decoder,
+    const byte* data,
+    const size_t size,
+    LzWriteCallback write,
+    void* context) {
+    for(size_t j = 0; j < size && !lz_is_done(decoder); j++) {
+        decoder->bits = decoder->bits << 8 | data[j];
+        decoder->num_bits += 8;
+
+        bool is_decoding = true;
+        while(is_decoding && !lz_is_done(decoder)) {
+            switch(decoder->state) {
+            case LzStateTag:
+                is_decoding = decoder->num_bits >= 1;
+                if(is_decoding) {
+                    decoder->state = lz_take(decoder, 1) ? LzStateLiteral : LzStateDistance;
+                }
+                break;
+            case LzStateLiteral:
+                is_decoding = decoder->num_bits >= 8;
+                if(is_decoding) {
+                    lz_output(decoder, lz_take(decoder, 8), write, context);
+                    decoder->state = LzStateTag;
+                }
+                break;
+            case LzStateDistance:
+                is_decoding = decoder->num_bits >= LZ_WINDOW_BITS;
+                if(is_decoding) {
+                    decoder->distance = lz_take(decoder, LZ_WINDOW_BITS) + 1;
+                    if(decoder->distance > decoder->offset) return false;
+                    decoder->state = LzStateLength;
+                }
+                break;
+            case LzStateLength:
+                is_decoding = decoder->num_bits >= LZ_LENGTH_BITS;
+                if(is_decoding) {
+                    const size_t length = lz_take(decoder, LZ_LENGTH_BITS) + LZ_MIN_MATCH;
+                    for(size_t k = 0; k < length && !lz_is_done(decoder); k++) {
+                        const uint32_t from = decoder->offset - decoder->distance;
+                        lz_output(decoder, decoder->window[from % LZ_WINDOW_SIZE], write, context);
+                    }
+                    decoder->state = LzStateTag;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool lz_is_done(const LzDecoder* decoder) {
+    return decoder->offset >= decoder->size;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+/* A streaming LZSS decoder in the style of heatshrink. The compressed stream is
+ * an LZ_HEADER_SIZE header, "C8Z", the version and the unpacked size as 32 bits
+ * little-endian, followed by a bit stream, most significant bit first:
+ *
+ *     1 LITERAL                  a byte, 8 bits
+ *     0 DISTANCE - 1  LENGTH - LZ_MIN_MATCH
+ *                                a copy of LENGTH bytes from DISTANCE bytes back,
+ *                                LZ_WINDOW_BITS and LZ_LENGTH_BITS wide
+ *
+ * The decoder keeps the last LZ_WINDOW_SIZE bytes it wrote and nothing else, so
+ * it takes the compressed data in chunks of any size and hands every byte on as
+ * soon as it is decoded. */
+
+#define LZ_MAGIC "C8Z"
+#define LZ_VERSION 1
+#define LZ_HEADER_SIZE 8
+#define LZ_WINDOW_BITS 8
+#define LZ_LENGTH_BITS 4
+#define LZ_WINDOW_SIZE (1 << LZ_WINDOW_BITS)
+#define LZ_MIN_MATCH 2 // a shorter copy takes more bits than its literals
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + (1 << LZ_LENGTH_BITS) - 1)
+
+typedef enum {
+    LzStateTag,
+    LzStateLiteral,
+    LzStateDistance,
+    LzStateLength,
+} LzState;
+
+typedef struct {
+    byte window[LZ_WINDOW_SIZE]; // the byte at offset j is at j % LZ_WINDOW_SIZE
+    uint32_t offset; // of the next byte
+    uint32_t size; // unpacked, from the header
+    uint32_t bits; // read but not decoded yet, the lowest num_bits of them
+    uint8_t num_bits;
+    uint16_t distance; // of the copy being decoded
+    LzState state;
+} LzDecoder;
+
+// called with every decoded byte and its offset in the unpacked data
+typedef void (*LzWriteCallback)(void* context, const size_t offset, const byte value);
+
+// false if the header is not one of a stream this decoder reads
+bool lz_read_header(const byte* header, uint32_t* size);
+
+void lz_write_header(byte* header, const uint32_t size);
+
+void lz_decoder_init(LzDecoder* decoder, const uint32_t size);
+
+// decodes the next chunk of the bit stream, false if it copies from before the
+// start; once the unpacked size is reached the rest is ignored
+bool lz_decode(
+    LzDecoder* decoder,
+    const byte* data,
+    const size_t size,
+    LzWriteCallback write,
+    void* context);
+
+bool lz_is_done(const LzDecoder* decoder);
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "opcodes.h"
+
+static const OpcodeInfo OPCODES[InstructionMAX] = {
+#define OPCODE_INFO(                                                                         \
+    _, Name, handler, mask, match, mnemonic, operands, mode, opcode_class, features, cycles) \
+    [Instruction##Name] = {mask, match, mnemonic, operands, mode, opcode_class, cycles},
+    VM_OPCODES(OPCODE_INFO, _)
+#undef OPCODE_INFO
+        [InstructionInvalid] =
+            {0x0000, 0x0000, "DW", "opcode", OpcodeModeChip8, OpcodeClassInvalid, 0},
+};
+
+static const char* CLASS_NAMES[OpcodeClassMAX] = {
+    [OpcodeClassFlow] = "flow",
+    [OpcodeClassSkip] = "skip",
+    [OpcodeClassAlu] = "alu",
+    [OpcodeClassMemory] = "memory",
+    [OpcodeClassDisplay] = "display",
+    [OpcodeClassInput] = "input",
+    [OpcodeClassTimer] = "timer",
+    [OpcodeClassInvalid] = "invalid",
+};
+
+/* The rows of a high nibble are OPCODE_GROUPS[nibble] up to OPCODE_GROUPS[nibble + 1],
+ * counted at compile time from the table. */
+#define OPCODE_IS_BELOW(nibble, Name, handler, mask, match, ...) +((match) >> 12 < (nibble))
+#define OPCODE_GROUP(nibble) (0 VM_OPCODES(OPCODE_IS_BELOW, nibble))
+
+static const byte OPCODE_GROUPS[0x11] = {
+    OPCODE_GROUP(0x0),
+    OPCODE_GROUP(0x1),
+    OPCODE_GROUP(0x2),
+    OPCODE_GROUP(0x3),
+    OPCODE_GROUP(0x4),
+    OPCODE_GROUP(0x5),
+    OPCODE_GROUP(0x6),
+    OPCODE_GROUP(0x7),
+    OPCODE_GROUP(0x8),
+    OPCODE_GROUP(0x9),
+    OPCODE_GROUP(0xA),
+    OPCODE_GROUP(0xB),
+    OPCODE_GROUP(0xC),
+    OPCODE_GROUP(0xD),
+    OPCODE_GROUP(0xE),
+    OPCODE_GROUP(0xF),
+    OPCODE_GROUP(0x10),
+};
+
+Instruction opcode_decode(const word opcode) {
+    const byte group = opcode >> 12;
+    for(byte j = OPCODE_GROUPS[group]; j < OPCODE_GROUPS[group + 1]; j++) {
+        if((opcode & OPCODES[j].mask) == OPCODES[j].match) return j;
+    }
+    return InstructionInvalid;
+}
+
+const OpcodeInfo* opcode_get_info(const Instruction instruction) {
+    return &OPCODES[instruction < InstructionMAX ? instruction : InstructionInvalid];
+}
+
+const char* opcode_get_class_name(const OpcodeClass opcode_class) {
+    return CLASS_NAMES[opcode_class < OpcodeClassMAX ? opcode_class : OpcodeClassInvalid];
+}
+
+static bool is_field(const char* operands, const char* field) {
+    return strncmp(operands, field, strlen(field)) == 0;
+}
+
+int opcode_disassemble(const word opcode, char* text, const size_t size) {
+    const OpcodeInfo* info = opcode_get_info(opcode_decode(opcode));
+    int length = snprintf(text, size, "%s%s", info->mnemonic, info->operands[0] ? " " : "");
+    for(const char* operands = info->operands; *operands != '\0' && (size_t)length < size;) {
+        char* end = text + length;
+        const size_t left = size - length;
+        if(is_field(operands, "Vx")) {
+            length += snprintf(end, left, "V%X", opcode_x(opcode));
+            operands += 2;
+        } else if(is_field(operands, "Vy")) {
+            length += snprintf(end, left, "V%X", opcode_y(opcode));
+            operands += 2;
+        } else if(is_field(operands, "byte")) {
+            length += snprintf(end, left, "#%02X", opcode_kk(opcode));
+            operands += 4;
+        } else if(is_field(operands, "addr")) {
+            length += snprintf(end, left, "%03X", opcode_nnn(opcode));
+            operands += 4;
+        } else if(is_field(operands, "nibble")) {
+            length += snprintf(end, left, "%X", opcode_n(opcode));
+            operands += 6;
+        } else if(is_field(operands, "opcode")) {
+            length += snprintf(end, left, "#%04X", opcode);
+            operands += 6;
+        } else {
+            length += snprintf(end, left, "%c", *operands++);
+        }
+    }
+    return (size_t)length < size ? length : (int)size - 1;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+/* The instruction set in one table. The interpreter, the analyzer and the
+ * disassembler are all expanded from it, so a new instruction or a corrected
+ * encoding only has to be entered here.
+ *
+ *     X(context, Name, handler, mask, match, mnemonic, operands, mode, class, features, cycles)
+ *
+ * An opcode is the instruction Name if (opcode & mask) == match. The handler is
+ * a `bool handler(VM* vm, const word opcode)` in vm.c, operands is the operand
+ * template of the disassembly (Vx, Vy, byte, addr and nibble are replaced by the
+ * fields of the opcode) and features are the RomFeature bits the analyzer
+ * reports for the instruction. cycles is what the instruction costs on the COSMAC
+ * VIP in machine cycles, on top of the fetch and decode every instruction pays,
+ * see vm_set_vip_timing. context is passed through to X.
+ *
+ * The rows are grouped by the high nibble of match, in ascending order, which
+ * opcode_decode relies on. */
+// clang-format off
+#define VM_OPCODES(X, context) \
+    X(context, Cls,         execute_cls,          0xFFFF, 0x00E0, "CLS",  "",               OpcodeModeChip8,     OpcodeClassDisplay, 0,                      3078) \
+    X(context, Ret,         execute_ret,          0xFFFF, 0x00EE, "RET",  "",               OpcodeModeChip8,     OpcodeClassFlow,    0,                        10) \
+    X(context, ScrollDown,  execute_scroll_down,  0xFFF0, 0x00C0, "SCD",  "nibble",         OpcodeModeSuperChip, OpcodeClassDisplay, RomFeatureScroll,         24) \
+    X(context, ScrollUp,    execute_scroll_up,    0xFFF0, 0x00D0, "SCU",  "nibble",         OpcodeModeXoChip,    OpcodeClassDisplay, RomFeatureScroll,         24) \
+    X(context, ScrollRight, execute_scroll_right, 0xFFFF, 0x00FB, "SCR",  "",               OpcodeModeSuperChip, OpcodeClassDisplay, RomFeatureScroll,         24) \
+    X(context, ScrollLeft,  execute_scroll_left,  0xFFFF, 0x00FC, "SCL",  "",               OpcodeModeSuperChip, OpcodeClassDisplay, RomFeatureScroll,         24) \
+    X(context, Exit,        execute_exit,         0xFFFF, 0x00FD, "EXIT", "",               OpcodeModeSuperChip, OpcodeClassFlow,    RomFeatureExit,           10) \
+    X(context, Lores,       execute_lores,        0xFFFF, 0x00FE, "LOW",  "",               OpcodeModeSuperChip, OpcodeClassDisplay, RomFeatureHires,          24) \
+    X(context, Hires,       execute_hires,        0xFFFF, 0x00FF, "HIGH", "",               OpcodeModeSuperChip, OpcodeClassDisplay, RomFeatureHires,          24) \
+    X(context, Jp,          execute_jp,           0xF000, 0x1000, "JP",   "addr",           OpcodeModeChip8,     OpcodeClassFlow,    0,                        12) \
+    X(context, Call,        execute_call,         0xF000, 0x2000, "CALL", "addr",           OpcodeModeChip8,     OpcodeClassFlow,    0,                        26) \
+    X(context, SeByte,      execute_se_byte,      0xF000, 0x3000, "SE",   "Vx, byte",       OpcodeModeChip8,     OpcodeClassSkip,    0,                        10) \
+    X(context, SneByte,     execute_sne_byte,     0xF000, 0x4000, "SNE",  "Vx, byte",       OpcodeModeChip8,     OpcodeClassSkip,    0,                        10) \
+    X(context, SeReg,       execute_se_reg,       0xF000, 0x5000, "SE",   "Vx, Vy",         OpcodeModeChip8,     OpcodeClassSkip,    0,                        14) \
+    X(context, LdByte,      execute_ld_byte,      0xF000, 0x6000, "LD",   "Vx, byte",       OpcodeModeChip8,     OpcodeClassAlu,     0,                         6) \
+    X(context, AddByte,     execute_add_byte,     0xF000, 0x7000, "ADD",  "Vx, byte",       OpcodeModeChip8,     OpcodeClassAlu,     0,                        10) \
+    X(context, LdReg,       execute_ld_reg,       0xF00F, 0x8000, "LD",   "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, Or,          execute_or,           0xF00F, 0x8001, "OR",   "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, And,         execute_and,          0xF00F, 0x8002, "AND",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, Xor,         execute_xor,          0xF00F, 0x8003, "XOR",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, AddReg,      execute_add_reg,      0xF00F, 0x8004, "ADD",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, Sub,         execute_sub,          0xF00F, 0x8005, "SUB",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, Shr,         execute_shr,          0xF00F, 0x8006, "SHR",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, Subn,        execute_subn,         0xF00F, 0x8007, "SUBN", "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, Shl,         execute_shl,          0xF00F, 0x800E, "SHL",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassAlu,     0,                        44) \
+    X(context, SneReg,      execute_sne_reg,      0xF000, 0x9000, "SNE",  "Vx, Vy",         OpcodeModeChip8,     OpcodeClassSkip,    0,                        14) \
+    X(context, LdI,         execute_ld_i,         0xF000, 0xA000, "LD",   "I, addr",        OpcodeModeChip8,     OpcodeClassMemory,  0,                        12) \
+    X(context, JpV0,        execute_jp_v0,        0xF000, 0xB000, "JP",   "V0, addr",       OpcodeModeChip8,     OpcodeClassFlow,    RomFeatureComputedJump,   22) \
+    X(context, Rnd,         execute_rnd,          0xF000, 0xC000, "RND",  "Vx, byte",       OpcodeModeChip8,     OpcodeClassAlu,     0,                        36) \
+    X(context, Drw,         execute_drw,          0xF000, 0xD000, "DRW",  "Vx, Vy, nibble", OpcodeModeChip8,     OpcodeClassDisplay, 0,                        26) \
+    X(context, Skp,         execute_skp,          0xF0FF, 0xE09E, "SKP",  "Vx",             OpcodeModeChip8,     OpcodeClassSkip,    0,                        14) \
+    X(context, Sknp,        execute_sknp,         0xF0FF, 0xE0A1, "SKNP", "Vx",             OpcodeModeChip8,     OpcodeClassSkip,    0,                        14) \
+    X(context, LdVxDt,      execute_ld_vx_dt,     0xF0FF, 0xF007, "LD",   "Vx, DT",         OpcodeModeChip8,     OpcodeClassTimer,   0,                        10) \
+    X(context, LdVxK,       execute_ld_vx_k,      0xF0FF, 0xF00A, "LD",   "Vx, K",          OpcodeModeChip8,     OpcodeClassInput,   RomFeatureKeyWait,        18) \
+    X(context, LdDtVx,      execute_ld_dt_vx,     0xF0FF, 0xF015, "LD",   "DT, Vx",         OpcodeModeChip8,     OpcodeClassTimer,   0,                        10) \
+    X(context, LdStVx,      execute_ld_st_vx,     0xF0FF, 0xF018, "LD",   "ST, Vx",         OpcodeModeChip8,     OpcodeClassTimer,   0,                        10) \
+    X(context, AddI,        execute_add_i,        0xF0FF, 0xF01E, "ADD",  "I, Vx",          OpcodeModeChip8,     OpcodeClassMemory,  0,                        16) \
+    X(context, LdF,         execute_ld_f,         0xF0FF, 0xF029, "LD",   "F, Vx",          OpcodeModeChip8,     OpcodeClassMemory,  0,                        16) \
+    X(context, LdHf,        execute_ld_hf,        0xF0FF, 0xF030, "LD",   "HF, Vx",         OpcodeModeSuperChip, OpcodeClassMemory,  RomFeatureLargeFont,      16) \
+    X(context, LdB,         execute_ld_b,         0xF0FF, 0xF033, "LD",   "B, Vx",          OpcodeModeChip8,     OpcodeClassMemory,  0,                        84) \
+    X(context, Store,       execute_store,        0xF0FF, 0xF055, "LD",   "[I], Vx",        OpcodeModeChip8,     OpcodeClassMemory,  0,                        14) \
+    X(context, Load,        execute_load,         0xF0FF, 0xF065, "LD",   "Vx, [I]",        OpcodeModeChip8,     OpcodeClassMemory,  0,                        14) \
+    X(context, SaveFlags,   execute_save_flags,   0xF0FF, 0xF075, "LD",   "R, Vx",          OpcodeModeSuperChip, OpcodeClassMemory,  RomFeatureFlags,          14) \
+    X(context, LoadFlags,   execute_load_flags,   0xF0FF, 0xF085, "LD",   "Vx, R",          OpcodeModeSuperChip, OpcodeClassMemory,  RomFeatureFlags,          14)
+// clang-format on
+
+#define OPCODE_MAX_DISASSEMBLY 24
+
+typedef enum {
+#define OPCODE_ENUM(_, Name, ...) Instruction##Name,
+    VM_OPCODES(OPCODE_ENUM, _)
+#undef OPCODE_ENUM
+        InstructionInvalid,
+    InstructionMAX,
+} Instruction;
+
+typedef enum {
+    OpcodeModeChip8,
+    OpcodeModeSuperChip,
+    OpcodeModeXoChip, // the few XO-CHIP instructions the SUPER-CHIP screen can do
+} OpcodeMode;
+
+typedef enum {
+    OpcodeClassFlow, // jumps, calls, returns
+    OpcodeClassSkip, // conditional skips of the next instruction
+    OpcodeClassAlu,
+    OpcodeClassMemory, // I and the memory it points to
+    OpcodeClassDisplay,
+    OpcodeClassInput,
+    OpcodeClassTimer,
+    OpcodeClassInvalid,
+    OpcodeClassMAX,
+} OpcodeClass;
+
+typedef struct {
+    word mask, match;
+    const char* mnemonic;
+    const char* operands;
+    OpcodeMode mode;
+    OpcodeClass opcode_class;
+    uint16_t cycles;
+} OpcodeInfo;
+
+Instruction opcode_decode(const word opcode);
+
+const OpcodeInfo* opcode_get_info(const Instruction instruction);
+const char* opcode_get_class_name(const OpcodeClass opcode_class);
+
+// e.g. "DRW V1, V2, 5", returns the length of the text
+int opcode_disassemble(const word opcode, char* text, const size_t size);
+
+static inline byte opcode_x(const word opcode) {
+    return (opcode >> 8) & 0x0F;
+}
+
+static inline byte opcode_y(const word opcode) {
+    return (opcode >> 4) & 0x0F;
+}
+
+static inline byte opcode_n(const word opcode) {
+    return opcode & 0x0F;
+}
+
+static inline byte opcode_kk(const word opcode) {
+    return opcode & 0xFF;
+}
+
+static inline word opcode_nnn(const word opcode) {
+    return opcode & 0x0FFF;
+}
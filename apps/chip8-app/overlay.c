@@ -0,0 +1,83 @@
+#include <furi.h>
+#include <furi_hal.h>
+#include <stdio.h>
+
+#include "overlay.h"
+
+#define TEXT_HEIGHT 8
+#define TEXT_LINES 3
+#define BAR_WIDTH 3
+#define BAR_HEIGHT 16
+
+void overlay_init(Overlay* overlay) {
+    overlay->is_visible = false;
+    overlay->draw_us = 0;
+    overlay->lock_wait_us = 0;
+}
+
+uint32_t overlay_get_us() {
+    return DWT->CYCCNT / furi_hal_cortex_instructions_per_microsecond();
+}
+
+static void overlay_draw_text(Overlay* overlay, Canvas* canvas, VM* vm, Renderer* renderer) {
+    char lines[TEXT_LINES][32];
+    snprintf(
+        lines[0],
+        sizeof(lines[0]),
+        "%lu ips %lu/%lu fps",
+        vm_get_recent_cpu_speed(vm),
+        vm_get_recent_frame_speed(vm),
+        renderer_get_recent_frame_speed(renderer));
+    snprintf(
+        lines[1],
+        sizeof(lines[1]),
+        "draw %luus lock %luus",
+        overlay->draw_us,
+        overlay->lock_wait_us);
+    snprintf(
+        lines[2],
+        sizeof(lines[2]),
+        "%u/s %lu dropped",
+        vm_get_instructions_per_sec(vm),
+        vm_get_dropped_frames(vm));
+
+    canvas_set_color(canvas, ColorWhite);
+    canvas_draw_box(canvas, 0, 0, canvas_width(canvas), TEXT_LINES * TEXT_HEIGHT + 1);
+    canvas_set_color(canvas, ColorBlack);
+    canvas_set_font(canvas, FontSecondary);
+    for(size_t j = 0; j < TEXT_LINES; j++) {
+        canvas_draw_str(canvas, 1, (j + 1) * TEXT_HEIGHT, lines[j]);
+    }
+}
+
+/* Frame times in PERF_HISTOGRAM_BUCKET_MS steps, fastest on the left. */
+static void overlay_draw_histogram(Canvas* canvas, Renderer* renderer) {
+    const PerfHistogram* histogram = &renderer->frame_times;
+    uint16_t max_count = 1;
+    for(size_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+        if(histogram->buckets[b] > max_count) max_count = histogram->buckets[b];
+    }
+
+    const size_t width = PERF_HISTOGRAM_BUCKETS * BAR_WIDTH + 2;
+    const size_t x_orig = canvas_width(canvas) - width;
+    const size_t y_orig = canvas_height(canvas) - BAR_HEIGHT - 2;
+    canvas_set_color(canvas, ColorWhite);
+    canvas_draw_box(canvas, x_orig, y_orig, width, BAR_HEIGHT + 2);
+    canvas_set_color(canvas, ColorBlack);
+    canvas_draw_frame(canvas, x_orig, y_orig, width, BAR_HEIGHT + 2);
+    for(size_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+        const size_t height = histogram->buckets[b] * BAR_HEIGHT / max_count;
+        canvas_draw_box(
+            canvas,
+            x_orig + 1 + b * BAR_WIDTH,
+            y_orig + 1 + BAR_HEIGHT - height,
+            BAR_WIDTH - 1,
+            height);
+    }
+}
+
+void overlay_draw(Overlay* overlay, Canvas* canvas, VM* vm, Renderer* renderer) {
+    if(!overlay->is_visible) return;
+    overlay_draw_text(overlay, canvas, vm, renderer);
+    overlay_draw_histogram(canvas, renderer);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <gui/canvas.h>
+
+#include "renderer.h"
+#include "vm.h"
+
+/* Performance overlay on top of the game, toggled with a long press on OK. */
+typedef struct {
+    bool is_visible;
+    uint32_t draw_us; // draw callback, smoothed
+    uint32_t lock_wait_us; // waiting for the view model lock, smoothed
+} Overlay;
+
+void overlay_init(Overlay* overlay);
+
+// microseconds from the cycle counter, for measuring short spans
+uint32_t overlay_get_us();
+
+void overlay_draw(Overlay* overlay, Canvas* canvas, VM* vm, Renderer* renderer);
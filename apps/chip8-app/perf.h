@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/* Rolling-window counters for the performance overlay. Small enough to keep
+ * inline, they run on every update and draw. */
+
+#define PERF_WINDOW_SAMPLES 8
+#define PERF_SAMPLE_MS 125 // the window spans about a second
+
+#define PERF_HISTOGRAM_BUCKETS 8
+#define PERF_HISTOGRAM_BUCKET_MS 8 // the last bucket collects everything slower
+#define PERF_HISTOGRAM_FRAMES 64
+
+// samples of an ever increasing count, to tell its recent rate
+typedef struct {
+    uint32_t timestamps[PERF_WINDOW_SAMPLES];
+    uint32_t counts[PERF_WINDOW_SAMPLES];
+    uint8_t newest, size;
+} PerfWindow;
+
+// frame times of the last PERF_HISTOGRAM_FRAMES frames
+typedef struct {
+    uint8_t recent[PERF_HISTOGRAM_FRAMES]; // bucket of each frame, a ring
+    uint8_t next, size;
+    uint16_t buckets[PERF_HISTOGRAM_BUCKETS];
+} PerfHistogram;
+
+static inline void perf_window_reset(PerfWindow* window) {
+    memset(window, 0, sizeof(PerfWindow));
+}
+
+// keeps a sample at most every PERF_SAMPLE_MS, the oldest one drops out
+static inline void
+    perf_window_sample(PerfWindow* window, const uint32_t timestamp, const uint32_t count) {
+    if(window->size > 0 && timestamp - window->timestamps[window->newest] < PERF_SAMPLE_MS) {
+        return;
+    }
+    window->newest = (window->newest + 1) % PERF_WINDOW_SAMPLES;
+    window->timestamps[window->newest] = timestamp;
+    window->counts[window->newest] = count;
+    if(window->size < PERF_WINDOW_SAMPLES) window->size++;
+}
+
+// per second, between the oldest and the newest sample
+static inline uint32_t perf_window_rate(const PerfWindow* window) {
+    if(window->size < 2) return 0;
+    const uint8_t oldest =
+        (window->newest + PERF_WINDOW_SAMPLES + 1 - window->size) % PERF_WINDOW_SAMPLES;
+    const uint32_t elapsed = window->timestamps[window->newest] - window->timestamps[oldest];
+    const uint32_t count = window->counts[window->newest] - window->counts[oldest];
+    return elapsed > 0 ? (uint64_t)count * 1000 / elapsed : 0;
+}
+
+static inline void perf_histogram_reset(PerfHistogram* histogram) {
+    memset(histogram, 0, sizeof(PerfHistogram));
+}
+
+static inline void perf_histogram_add(PerfHistogram* histogram, const uint32_t frame_ms) {
+    const uint32_t bucket = frame_ms / PERF_HISTOGRAM_BUCKET_MS;
+    if(histogram->size == PERF_HISTOGRAM_FRAMES) {
+        histogram->buckets[histogram->recent[histogram->next]]--;
+    } else {
+        histogram->size++;
+    }
+    histogram->recent[histogram->next] =
+        bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1;
+    histogram->buckets[histogram->recent[histogram->next]]++;
+    histogram->next = (histogram->next + 1) % PERF_HISTOGRAM_FRAMES;
+}
+
+// exponential moving average over roughly the last 8 values
+static inline void perf_smooth(uint32_t* average, const uint32_t value) {
+    *average = *average + ((int32_t)(value - *average) >> 3);
+}
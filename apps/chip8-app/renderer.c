@@ -0,0 +1,117 @@
+#include <string.h>
+
+#include "renderer.h"
+
+#define ROW_BYTES (RENDERER_WIDTH / 8)
+
+void renderer_init(Renderer* renderer) {
+    for(size_t b = 0; b < 256; b++) {
+        byte reversed = 0x00;
+        uint16_t doubled = 0x0000;
+        for(size_t pixel = 0; pixel < 8; pixel++) {
+            if(b & (0x80 >> pixel)) {
+                reversed |= 1 << pixel;
+                doubled |= 3 << (2 * pixel);
+            }
+        }
+        renderer->reversed[b] = reversed;
+        renderer->doubled[b] = doubled;
+    }
+    memset(renderer->frame, 0x00, sizeof(renderer->frame));
+    renderer_set_flicker_filter(renderer, FlickerFilterOff, 1);
+    renderer->frames_rendered = 0;
+    renderer->last_render = 0;
+    perf_window_reset(&renderer->render_window);
+    perf_histogram_reset(&renderer->frame_times);
+}
+
+void renderer_set_flicker_filter(
+    Renderer* renderer,
+    const FlickerFilter filter,
+    const byte frames) {
+    renderer->flicker_filter = filter;
+    renderer->flicker_frames = frames < RENDERER_FLICKER_FRAMES ? frames : RENDERER_FLICKER_FRAMES;
+    if(renderer->flicker_frames == 0) renderer->flicker_frames = 1;
+    renderer->newest_frame = 0;
+    memset(renderer->history, 0x00, sizeof(renderer->history));
+}
+
+/* Moves the screen into the history, starting a new entry once per 60 Hz frame,
+ * and replaces it with the combination of the history. */
+static void filter_flicker(Renderer* renderer, VM* vm, uint32_t* screen) {
+    const uint64_t frame = vm_get_timer_ticks(vm);
+    if(frame != renderer->newest_frame) {
+        memmove(
+            renderer->history[1],
+            renderer->history[0],
+            sizeof(renderer->history) - sizeof(renderer->history[0]));
+        renderer->newest_frame = frame;
+    }
+    memcpy(renderer->history[0], screen, sizeof(renderer->history[0]));
+
+    const uint32_t* a = renderer->history[0];
+    const uint32_t* b = renderer->history[1];
+    const uint32_t* c = renderer->history[2];
+    for(size_t j = 0; j < RENDERER_LOWRES_WORDS; j++) {
+        if(renderer->flicker_filter == FlickerFilterMajority) {
+            screen[j] = (a[j] & b[j]) | (a[j] & c[j]) | (b[j] & c[j]);
+        } else {
+            uint32_t lit = 0;
+            for(size_t k = 0; k < renderer->flicker_frames; k++) {
+                lit |= renderer->history[k][j];
+            }
+            screen[j] = lit;
+        }
+    }
+}
+
+static void render_lowres(Renderer* renderer, VM* vm) {
+    union {
+        uint32_t words[RENDERER_LOWRES_WORDS];
+        byte rows[RENDERER_HEIGHT / 2][ROW_BYTES / 2];
+    } screen;
+    for(int y = 0; y < RENDERER_HEIGHT / 2; y++) {
+        vm_get_screen_row(vm, y, screen.rows[y]);
+    }
+    if(renderer->flicker_filter != FlickerFilterOff) filter_flicker(renderer, vm, screen.words);
+
+    for(int y = 0; y < RENDERER_HEIGHT / 2; y++) {
+        const byte* row = screen.rows[y];
+        byte* out = renderer->frame + 2 * y * ROW_BYTES;
+        for(size_t k = 0; k < ROW_BYTES / 2; k++) {
+            const uint16_t doubled = renderer->doubled[row[k]];
+            out[2 * k] = doubled;
+            out[2 * k + 1] = doubled >> 8;
+        }
+        memcpy(out + ROW_BYTES, out, ROW_BYTES);
+    }
+}
+
+static void render_hires(Renderer* renderer, VM* vm) {
+    byte row[ROW_BYTES];
+    for(int y = 0; y < RENDERER_HEIGHT; y++) {
+        vm_get_screen_row(vm, y, row);
+        byte* out = renderer->frame + y * ROW_BYTES;
+        for(size_t k = 0; k < sizeof(row); k++) {
+            out[k] = renderer->reversed[row[k]];
+        }
+    }
+}
+
+void renderer_render(Renderer* renderer, VM* vm, const uint32_t timestamp) {
+    if(vm_get_screen_width(vm) == RENDERER_WIDTH) {
+        render_hires(renderer, vm);
+    } else {
+        render_lowres(renderer, vm);
+    }
+
+    if(renderer->frames_rendered > 0) {
+        perf_histogram_add(&renderer->frame_times, timestamp - renderer->last_render);
+    }
+    renderer->last_render = timestamp;
+    perf_window_sample(&renderer->render_window, timestamp, ++renderer->frames_rendered);
+}
+
+uint32_t renderer_get_recent_frame_speed(Renderer* renderer) {
+    return perf_window_rate(&renderer->render_window);
+}
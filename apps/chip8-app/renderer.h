@@ -0,0 +1,51 @@
+#pragma once
+
+#include "perf.h"
+#include "vm.h"
+
+// the Flipper display, lowres screens are scaled up 2x to fill it
+#define RENDERER_WIDTH 128
+#define RENDERER_HEIGHT 64
+#define RENDERER_FRAME_SIZE (RENDERER_WIDTH / 8 * RENDERER_HEIGHT)
+
+// history of the flicker filter, lowres frames only to keep it small
+#define RENDERER_FLICKER_FRAMES 3
+#define RENDERER_LOWRES_WORDS (RENDERER_FRAME_SIZE / 4 / sizeof(uint32_t))
+
+/* Programs erase and redraw their sprites with XOR every frame, which the slow
+ * LCD shows as flicker. The filter combines the last few 60 Hz frames. */
+typedef enum {
+    FlickerFilterOff,
+    FlickerFilterOr, // a pixel lit in any of the frames
+    FlickerFilterMajority, // a pixel lit in at least two of three frames
+} FlickerFilter;
+
+typedef struct {
+    byte reversed[256]; // bit order flipped, for hires rows
+    uint16_t doubled[256]; // bit order flipped and every pixel doubled, for lowres rows
+    byte frame[RENDERER_FRAME_SIZE]; // XBM, the leftmost pixel of a byte is bit 0
+
+    FlickerFilter flicker_filter;
+    byte flicker_frames; // combined by FlickerFilterOr, the majority always takes three
+    uint64_t newest_frame; // timer tick of history[0]
+    uint32_t history[RENDERER_FLICKER_FRAMES][RENDERER_LOWRES_WORDS]; // newest first
+
+    // frames actually shown, for the performance overlay
+    uint32_t frames_rendered;
+    uint32_t last_render; // ms
+    PerfWindow render_window;
+    PerfHistogram frame_times;
+} Renderer;
+
+void renderer_init(Renderer* renderer);
+
+void renderer_set_flicker_filter(
+    Renderer* renderer,
+    const FlickerFilter filter,
+    const byte frames);
+
+// renders the screen of the VM into renderer->frame, ready for canvas_draw_xbm
+void renderer_render(Renderer* renderer, VM* vm, const uint32_t timestamp);
+
+// rendered frames per second over about the last second
+uint32_t renderer_get_recent_frame_speed(Renderer* renderer);
@@ -0,0 +1,78 @@
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rom_file.h"
+
+#define ROM_FILE_CHUNK_SIZE 64
+
+static bool rom_file_has_extension(const char* name, const char* extension) {
+    const size_t name_size = strlen(name);
+    const size_t extension_size = strlen(extension);
+    return name_size >= extension_size &&
+           strcmp(name + name_size - extension_size, extension) == 0;
+}
+
+bool rom_file_is_rom(const char* name) {
+    return rom_file_has_extension(name, ROM_FILE_EXTENSION) ||
+           rom_file_has_extension(name, ROM_FILE_PACKED_EXTENSION);
+}
+
+static size_t rom_file_read_raw(
+    File* file,
+    byte* chunk,
+    const size_t max_size,
+    LzWriteCallback write,
+    void* context) {
+    size_t size = 0;
+    for(;;) {
+        const size_t chunk_size = storage_file_read(file, chunk, ROM_FILE_CHUNK_SIZE);
+        if(chunk_size == 0) return size;
+        if(size + chunk_size > max_size) return 0;
+        for(size_t j = 0; j < chunk_size; j++) write(context, size + j, chunk[j]);
+        size += chunk_size;
+    }
+}
+
+// the decoder lives on the heap, the app's stack is small
+static size_t rom_file_read_packed(
+    File* file,
+    byte* chunk,
+    const size_t max_size,
+    LzWriteCallback write,
+    void* context) {
+    uint32_t size;
+    if(storage_file_read(file, chunk, LZ_HEADER_SIZE) != LZ_HEADER_SIZE ||
+       !lz_read_header(chunk, &size) || size == 0 || size > max_size) {
+        return 0;
+    }
+    LzDecoder* decoder = malloc(sizeof(LzDecoder));
+    lz_decoder_init(decoder, size);
+    bool is_valid = true;
+    while(is_valid && !lz_is_done(decoder)) {
+        const size_t chunk_size = storage_file_read(file, chunk, ROM_FILE_CHUNK_SIZE);
+        is_valid = chunk_size > 0 && lz_decode(decoder, chunk, chunk_size, write, context);
+    }
+    free(decoder);
+    return is_valid ? size : 0;
+}
+
+size_t rom_file_read(
+    Storage* storage,
+    const char* path,
+    const size_t max_size,
+    LzWriteCallback write,
+    void* context) {
+    byte chunk[ROM_FILE_CHUNK_SIZE];
+    size_t size = 0;
+    File* file = storage_file_alloc(storage);
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        size = rom_file_has_extension(path, ROM_FILE_PACKED_EXTENSION) ?
+                   rom_file_read_packed(file, chunk, max_size, write, context) :
+                   rom_file_read_raw(file, chunk, max_size, write, context);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    if(size == 0) FURI_LOG_W("chip8", "could not read rom '%s'", path);
+    return size;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <storage/storage.h>
+
+#include "lz.h"
+
+#define ROM_FILE_EXTENSION ".ch8"
+// packed with the LZSS of lz.h, make pack in chip8-test writes them
+#define ROM_FILE_PACKED_EXTENSION ".c8z"
+
+// whether the name ends in one of the extensions above
+bool rom_file_is_rom(const char* name);
+
+/* Reads a ROM in chunks and hands on every byte, unpacking a packed ROM on the
+ * fly. Returns the size of the program, or 0 if the file could not be read, is
+ * damaged or holds more than max_size bytes. */
+size_t rom_file_read(
+    Storage* storage,
+    const char* path,
+    const size_t max_size,
+    LzWriteCallback write,
+    void* context);
@@ -0,0 +1,106 @@
+#include <furi.h>
+#include <stdlib.h>
+#include <storage/storage.h>
+#include <toolbox/stream/stream.h>
+#include <toolbox/stream/file_stream.h>
+
+#include "rom_settings.h"
+#include "vm.h"
+
+// values that do not fit the setting are ignored, so the default stays
+static bool rom_settings_is_in_range(
+    FuriString* key,
+    const long value,
+    const long min,
+    const long max) {
+    if(value >= min && value <= max) return true;
+    FURI_LOG_W(
+        "chip8",
+        "rom setting '%s' = %ld is not in %ld..%ld, ignored",
+        furi_string_get_cstr(key),
+        value,
+        min,
+        max);
+    return false;
+}
+
+static void rom_settings_apply(RomSettings* settings, FuriString* key, const long value) {
+    if(furi_string_equal_str(key, "instructions_per_second")) {
+        if(rom_settings_is_in_range(key, value, 0, UINT16_MAX)) {
+            settings->instructions_per_sec = value;
+        }
+    } else if(furi_string_equal_str(key, "max_catchup_frames")) {
+        if(rom_settings_is_in_range(key, value, 1, UINT8_MAX)) {
+            settings->max_catchup_frames = value;
+        }
+    } else if(furi_string_equal_str(key, "auto_tune")) {
+        settings->is_auto_tuned = value != 0;
+    } else if(furi_string_equal_str(key, "vip_timing")) {
+        settings->is_vip_timing = value != 0;
+    } else if(furi_string_equal_str(key, "flicker_filter")) {
+        if(rom_settings_is_in_range(key, value, FlickerFilterOff, FlickerFilterMajority)) {
+            settings->flicker_filter = (FlickerFilter)value;
+        }
+    } else if(furi_string_equal_str(key, "flicker_frames")) {
+        if(rom_settings_is_in_range(key, value, 1, RENDERER_FLICKER_FRAMES)) {
+            settings->flicker_frames = value;
+        }
+    } else {
+        FURI_LOG_W("chip8", "unknown rom setting '%s'", furi_string_get_cstr(key));
+    }
+}
+
+static void rom_settings_parse_line(RomSettings* settings, FuriString* line) {
+    const size_t comment = furi_string_search_char(line, '#', 0);
+    if(comment != FURI_STRING_FAILURE) furi_string_left(line, comment);
+
+    const size_t separator = furi_string_search_char(line, '=', 0);
+    if(separator == FURI_STRING_FAILURE) return;
+
+    FuriString* key = furi_string_alloc_set(line);
+    furi_string_left(key, separator);
+    furi_string_trim(key);
+    furi_string_right(line, separator + 1);
+    furi_string_trim(line);
+
+    rom_settings_apply(settings, key, strtol(furi_string_get_cstr(line), NULL, 0));
+    furi_string_free(key);
+}
+
+void rom_settings_load(RomSettings* settings, const char* rom_path) {
+    settings->instructions_per_sec = VM_DEFAULT_INSTRUCTIONS_PER_SEC;
+    settings->max_catchup_frames = VM_DEFAULT_MAX_CATCHUP_FRAMES;
+    settings->is_auto_tuned = true;
+    settings->is_vip_timing = false;
+    settings->flicker_filter = FlickerFilterOff;
+    settings->flicker_frames = 2;
+
+    FuriString* path = furi_string_alloc_printf("%s%s", rom_path, ROM_SETTINGS_EXTENSION);
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    Stream* stream = file_stream_alloc(storage);
+
+    if(file_stream_open(stream, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_D("chip8", "reading rom settings \"%s\":", furi_string_get_cstr(path));
+        FuriString* line = furi_string_alloc();
+        while(stream_read_line(stream, line)) {
+            rom_settings_parse_line(settings, line);
+        }
+        furi_string_free(line);
+        file_stream_close(stream);
+    }
+
+    stream_free(stream);
+    furi_record_close(RECORD_STORAGE);
+    furi_string_free(path);
+
+    FURI_LOG_I(
+        "chip8",
+        "rom settings: %u instructions per second, %u catch-up frames, auto-tune %s, "
+        "vip timing %s, flicker filter %u over %u frames",
+        settings->instructions_per_sec,
+        settings->max_catchup_frames,
+        settings->is_auto_tuned ? "on" : "off",
+        settings->is_vip_timing ? "on" : "off",
+        settings->flicker_filter,
+        settings->flicker_frames);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "renderer.h"
+
+// per-ROM settings live next to the ROM, e.g. "pong.ch8.cfg" for "pong.ch8"
+#define ROM_SETTINGS_EXTENSION ".cfg"
+
+/* Lines of `key = value`, # starts a comment:
+ *
+ *     instructions_per_second = 900
+ *     max_catchup_frames = 4
+ *     auto_tune = 1
+ *     vip_timing = 1       # COSMAC VIP speed, replaces instructions_per_second
+ *     flicker_filter = 1   # 0 off, 1 or, 2 majority, see FlickerFilter
+ *     flicker_frames = 2
+ *
+ * A value out of the range of its setting is ignored with a warning.
+ */
+typedef struct {
+    uint16_t instructions_per_sec; // 0 runs the VM with millisecond scheduling
+    uint8_t max_catchup_frames;
+    bool is_auto_tuned;
+    bool is_vip_timing; // see vm_set_vip_timing
+    FlickerFilter flicker_filter;
+    uint8_t flicker_frames;
+} RomSettings;
+
+// fills in the defaults, then whatever the settings file of the ROM overrides
+void rom_settings_load(RomSettings* settings, const char* rom_path);
@@ -0,0 +1,52 @@
+#include "trace.h"
+
+#if TRACE_LEVEL > TRACE_LEVEL_OFF
+
+#include <stdatomic.h>
+#include <string.h>
+
+_Static_assert(
+    (TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0,
+    "TRACE_CAPACITY must be a power of two");
+
+static TraceRecord trace_buffer[TRACE_CAPACITY];
+static atomic_uint trace_next;
+static uint32_t (*trace_clock)(void);
+
+void trace_init(uint32_t (*clock)(void)) {
+    trace_clock = clock;
+    atomic_store(&trace_next, 0);
+}
+
+void trace_record(const TraceEvent event, const uint16_t a, const uint32_t b) {
+    if(trace_clock == NULL) return;
+    // claiming a slot is the only shared step, writers never wait for each other
+    const uint32_t sequence = atomic_fetch_add_explicit(&trace_next, 1, memory_order_relaxed);
+    TraceRecord* record = &trace_buffer[sequence & (TRACE_CAPACITY - 1)];
+    record->timestamp = trace_clock();
+    record->event = event;
+    record->a = a;
+    record->b = b;
+    atomic_thread_fence(memory_order_release);
+    record->sequence = sequence;
+}
+
+void trace_dump(TraceWriteCallback write, void* context) {
+    atomic_thread_fence(memory_order_acquire);
+    const uint32_t next = atomic_load(&trace_next);
+    const uint32_t count = next < TRACE_CAPACITY ? next : TRACE_CAPACITY;
+
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.num_records = count;
+    header.num_overwritten = next - count;
+    write(context, &header, sizeof(header));
+
+    for(uint32_t sequence = next - count; sequence != next; sequence++) {
+        write(context, &trace_buffer[sequence & (TRACE_CAPACITY - 1)], sizeof(TraceRecord));
+    }
+}
+
+#endif
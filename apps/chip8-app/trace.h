@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Trace points for the hot paths. Each one stores a fixed-size binary record in
+ * an in-memory ring buffer, which is written to storage on exit and decoded on
+ * the host (chip8-test/trace_decode.c). Trace points above TRACE_LEVEL compile
+ * to nothing, arguments included. */
+
+#define TRACE_LEVEL_OFF 0
+#define TRACE_LEVEL_EVENTS 1 // game start, input, sleeps of the emulation thread
+#define TRACE_LEVEL_HOT 2 // every update and draw
+
+#ifndef TRACE_LEVEL
+#ifdef FURI_DEBUG
+#define TRACE_LEVEL TRACE_LEVEL_HOT
+#else
+#define TRACE_LEVEL TRACE_LEVEL_OFF
+#endif
+#endif
+
+// records kept, a power of two
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 256
+#endif
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+
+// name and meaning of the two arguments of every trace point
+#define TRACE_EVENTS(X)                                                  \
+    X(TraceEventStart, "start", "instructions per sec", "rom bytes")     \
+    X(TraceEventUpdate, "update", "instructions per sec", "cpu ticks")   \
+    X(TraceEventDraw, "draw", "dropped frames", "timer ticks")           \
+    X(TraceEventInput, "input", "key << 8 | type", "keys")               \
+    X(TraceEventSleep, "sleep", "flags", "timeout ms")
+
+#define TRACE_EVENT_ENUM(id, name, a, b) id,
+typedef enum {
+    TRACE_EVENTS(TRACE_EVENT_ENUM) TraceEventMAX,
+} TraceEvent;
+#undef TRACE_EVENT_ENUM
+
+typedef struct {
+    uint32_t sequence; // position in the stream of all records, gaps mean overwritten ones
+    uint32_t timestamp; // ms
+    uint16_t event;
+    uint16_t a;
+    uint32_t b;
+} TraceRecord;
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t num_records; // followed by this many records, oldest first
+    uint32_t num_overwritten;
+} TraceHeader;
+
+typedef void (*TraceWriteCallback)(void* context, const void* data, size_t size);
+
+#if TRACE_LEVEL > TRACE_LEVEL_OFF
+
+void trace_init(uint32_t (*clock)(void));
+
+// safe to call from any thread, never blocks
+void trace_record(const TraceEvent event, const uint16_t a, const uint32_t b);
+
+// writes a TraceHeader and the records, call once the traced threads are done
+void trace_dump(TraceWriteCallback write, void* context);
+
+#else
+
+#define trace_init(clock) ((void)0)
+#define trace_dump(write, context) ((void)0)
+
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_EVENTS
+#define TRACE_EVENT(event, a, b) trace_record((event), (a), (b))
+#else
+#define TRACE_EVENT(event, a, b) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_HOT
+#define TRACE_HOT(event, a, b) trace_record((event), (a), (b))
+#else
+#define TRACE_HOT(event, a, b) ((void)0)
+#endif
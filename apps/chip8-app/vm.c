@@ -3,27 +3,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "vm.h"
-
-#define PROG_START 0x0200
-#define MEMORY_SIZE 0x1000
-#define STACK_SIZE 0xFF
-#define TIMER_TICKS_PER_SEC 60
-#define MS_PER_CPU_TICK (1000 / VM_CPU_TICKS_PER_SEC)
-#define MS_PER_TIMER_TICK (1000 / TIMER_TICKS_PER_SEC)
-#define MAX_SCREEN_WIDTH 128
-#define MAX_SCREEN_HEIGHT 64
-
-typedef enum {
-    ModeChip8,
-    ModeSuperChip8,
-} Mode;
-
-typedef enum {
-    ScreenResolutionLow,
-    ScreenResolutionHigh,
-} ScreenResolution;
+#include "vm_clone.h"
+#include "vm_i.h"
 
 // clang-format off
 byte SMALL_HEX_DIGITS[80] = {
@@ -65,37 +48,10 @@ byte LARGE_HEX_DIGITS[160] = {
 };
 // clang-format on
 
-typedef struct VirtualMachine {
-    byte memory[MEMORY_SIZE];
-    word pc, i;
-
-    byte v[0x10];
-
-    word stack[STACK_SIZE];
-    byte sp;
-
-    byte delay_timer, sound_timer;
-    uint32_t timestamp_init;
-    uint64_t cpu_ticks, timer_ticks;
-
-    bool is_game_over;
-
-    bool is_key_pressed[0x10];
-
-    bool is_waiting_for_key;
-    byte waiting_for_key_index;
-
-    Mode mode;
-
-    ScreenResolution screen_resolution;
-    int scroll_horizontal, scroll_vertical;
-    bool screen[MAX_SCREEN_WIDTH][MAX_SCREEN_HEIGHT];
-} VM;
-
 int vm_get_screen_width(VM* vm) {
     switch(vm->screen_resolution) {
     case ScreenResolutionHigh:
-        return 128;
+        return MAX_SCREEN_WIDTH;
     case ScreenResolutionLow:
         return 64;
     }
@@ -121,33 +77,108 @@ void vf_reset(VM* vm) {
 int vm_get_screen_height(VM* vm) {
     switch(vm->screen_resolution) {
     case ScreenResolutionHigh:
-        return 64;
+        return MAX_SCREEN_HEIGHT;
     case ScreenResolutionLow:
         return 32;
     }
     return -1;
 }
 
-static bool fetch_is_key_pressed(VM* vm, const byte key_id) {
+bool vm_fetch_is_key_pressed(VM* vm, const byte key_id) {
     const bool ret = vm->is_key_pressed[key_id];
     vm->is_key_pressed[key_id] = false;
+    if(ret) vm->key_observations++;
     return ret;
 }
 
-static void clear_display(VM* vm) {
-    for(int j = 0; j < vm_get_screen_width(vm); j++) {
-        for(int k = 0; k < vm_get_screen_height(vm); k++) {
-            vm->screen[j][k] = false;
+void vm_clear_display(VM* vm) {
+    memset(vm->screen, 0, sizeof(vm->screen));
+    vm->screen_changes++;
+#if VM_FEATURE_CLONE
+    vm->clone_dirty_screen = UINT32_MAX;
+#endif
+}
+
+#if VM_SPRITE_CACHE_ENTRIES > 0
+static void sprite_cache_reset(VM* vm) {
+    for(size_t j = 0; j < VM_SPRITE_CACHE_ENTRIES; j++) vm->sprite_cache[j].last_used = 0;
+    vm->sprite_cache_clock = 0;
+    vm->sprite_cache_start = 0;
+    vm->sprite_cache_end = 0;
+}
+#endif
+
+#if VM_PROFILE_CALLS
+static void profile_reset(VM* vm) {
+    memset(&vm->profile_nodes[PROFILE_ROOT], 0, sizeof(ProfileNode));
+    vm->profile_nodes[PROFILE_ROOT].addr = PROG_START;
+    vm->profile_size = 1;
+    vm->profile_node = PROFILE_ROOT;
+    vm->profile_overflow_depth = 0;
+    vm->profile_ticks = 0;
+}
+
+void vm_profile_flush(VM* vm) {
+    vm->profile_nodes[vm->profile_node].ticks += vm->cpu_ticks - vm->profile_ticks;
+    vm->profile_ticks = vm->cpu_ticks;
+}
+
+static void profile_call(VM* vm, const word addr) {
+    vm_profile_flush(vm);
+    ProfileNode* caller = &vm->profile_nodes[vm->profile_node];
+    uint16_t child = caller->first_child;
+    while(child != PROFILE_ROOT && vm->profile_nodes[child].addr != addr) {
+        child = vm->profile_nodes[child].next_sibling;
+    }
+    if(child == PROFILE_ROOT) {
+        if(vm->profile_size == PROFILE_NODES) {
+            vm->profile_overflow_depth++;
+            return;
         }
+        child = vm->profile_size++;
+        ProfileNode* node = &vm->profile_nodes[child];
+        memset(node, 0, sizeof(ProfileNode));
+        node->addr = addr;
+        node->parent = vm->profile_node;
+        node->next_sibling = caller->first_child;
+        caller->first_child = child;
     }
+    vm->profile_nodes[child].calls++;
+    vm->profile_node = child;
 }
 
+static void profile_return(VM* vm) {
+    vm_profile_flush(vm);
+    if(vm->profile_overflow_depth > 0) {
+        vm->profile_overflow_depth--;
+    } else if(vm->profile_node != PROFILE_ROOT) {
+        vm->profile_node = vm->profile_nodes[vm->profile_node].parent;
+    }
+}
+#endif
+
 VM* vm_alloc() {
     VM* vm = malloc(sizeof(VM));
+#if VM_SPRITE_CACHE_ENTRIES > 0
+    sprite_cache_reset(vm);
+#endif
+#if VM_FEATURE_CLONE
+    vm->clone_pool = NULL;
+    memset(vm->clone_groups, 0, sizeof(vm->clone_groups));
+    vm->clone_dirty_memory = UINT64_MAX;
+    vm->clone_dirty_screen = UINT32_MAX;
+#endif
     return vm;
 }
 
+size_t vm_get_size() {
+    return sizeof(VM);
+}
+
 void vm_free(VM* vm) {
+#if VM_FEATURE_CLONE
+    vm_clone_detach(vm);
+#endif
     free(vm);
 }
 
@@ -163,276 +194,616 @@ void vm_start(VM* vm, const uint32_t timestamp_world) {
     vm->cpu_ticks = 0;
     vm->timer_ticks = 0;
     vm->is_game_over = false;
+    vm->dropped_frames = 0;
+    vm_set_frame_pacing(vm, 0, 1, false);
+    vm_set_vip_timing(vm, false);
+    perf_window_reset(&vm->cpu_window);
+    perf_window_reset(&vm->frame_window);
 
     vm->is_waiting_for_key = false;
 
     vm->mode = ModeChip8;
+    vm_set_seed(vm, timestamp_world);
     vm->screen_resolution = ScreenResolutionLow;
     vm->scroll_horizontal = 0;
     vm->scroll_vertical = 0;
 
     for(size_t j = 0; j < 0x10; j++) vm->is_key_pressed[j] = false;
+    vm->key_observations = 0;
     for(size_t j = 0; j < 80; j++) vm->memory[j] = SMALL_HEX_DIGITS[j];
+#if VM_FEATURE_SCHIP
     for(size_t j = 0; j < 160; j++) vm->memory[80 + j] = LARGE_HEX_DIGITS[j];
+#endif
+#if VM_SPRITE_CACHE_ENTRIES > 0
+    sprite_cache_reset(vm);
+#endif
+    vm->executed_pages = 0;
+    vm->written_pages = 0;
+#if VM_FEATURE_CLONE
+    vm->clone_dirty_memory = UINT64_MAX;
+    vm->clone_dirty_screen = UINT32_MAX;
+#endif
+#if VM_MEMORY_HEATMAP
+    memset(&vm->heatmap, 0, sizeof(vm->heatmap));
+#endif
+#if VM_PROFILE_CALLS
+    profile_reset(vm);
+#endif
+
+    vm_clear_display(vm);
+}
+
+void vm_set_superchip(VM* vm, const bool is_superchip) {
+    vm->mode = is_superchip ? ModeSuperChip8 : ModeChip8;
+}
+
+void vm_set_seed(VM* vm, const uint32_t seed) {
+    // xorshift32 must never be seeded with zero
+    vm->rng_state = (seed != 0) ? seed : 0x2545F491;
+}
 
-    clear_display(vm);
+byte vm_random_byte(VM* vm) {
+    uint32_t state = vm->rng_state;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    vm->rng_state = state;
+    return state >> 24;
 }
 
 static word join(const byte lo, const byte hi) {
     return ((word)(hi) << 8) | (word)(lo);
 }
 
+static uint64_t page_bit(const size_t addr) {
+    return (uint64_t)1 << (addr % MEMORY_SIZE / VM_MEMORY_PAGE_SIZE);
+}
+
+#if VM_MEMORY_HEATMAP
+static void heatmap_count(uint32_t* counters, const word addr, const size_t size) {
+    for(size_t j = 0; j < size; j++) counters[(addr + j) % MEMORY_SIZE]++;
+}
+#endif
+
 static word fetch(VM* vm) {
+    vm->executed_pages |= page_bit(vm->pc) | page_bit(vm->pc + 1);
+#if VM_MEMORY_HEATMAP
+    heatmap_count(vm->heatmap.executes, vm->pc, 2);
+#endif
     const byte hi = vm->memory[vm->pc++];
     const byte lo = vm->memory[vm->pc++];
     return join(lo, hi);
 }
 
-bool xor_pixel(VM* vm, const size_t x, const size_t y, const bool next) {
-    const bool prev = vm->screen[x][y];
-    vm->screen[x][y] = prev ^ next;
-    return prev && next;
-}
-
-static bool execute(VM* vm, word opcode) {
-    const word nnn = opcode & 0x0FFF;
-    const byte kk = opcode & 0xFF;
-    const byte n = opcode & 0x0F;
-    const byte x = (opcode & 0x0F00) >> 8;
-    const byte y = (opcode & 0x00F0) >> 4;
-
-    switch(opcode & 0xF000) {
-    case 0x0000: // SYS addr
-        switch(opcode) {
-        case 0x00E0: // CLS
-            clear_display(vm);
-            return true;
-        case 0x00EE: // RET
-            vm->pc = vm->stack[--vm->sp];
-            return true;
-        case 0x00FB: // SCROLL_RIGHT
-            vm->scroll_horizontal += 4;
-            vm->mode = ModeSuperChip8;
-            return true;
-        case 0x00FC: // SCROLL_LEFT
-            vm->scroll_horizontal -= 4;
-            vm->mode = ModeSuperChip8;
-            return true;
-        case 0x00FE: //LORES
-            vm->screen_resolution = ScreenResolutionLow;
-            vm->mode = ModeSuperChip8;
-            return true;
-        case 0x00FF: //HIRES
-            vm->screen_resolution = ScreenResolutionHigh;
-            vm->mode = ModeSuperChip8;
-            return true;
-        default:
-            if((opcode & 0x00C0) == 0x00C0) { // SCROLL_DOWN_N
-                vm->mode = ModeSuperChip8;
-                vm->scroll_vertical += n;
-                return true;
-            }
-            return false;
-        }
-        break;
-    case 0x1000: // JP addr
-        vm->pc = nnn;
-        return true;
-    case 0x2000: // CALL addr
-        if(vm->sp == STACK_SIZE) {
-            return false;
-        }
-        vm->stack[vm->sp++] = vm->pc;
-        vm->pc = nnn;
-        return true;
-    case 0x3000: // SE Vx, byte
-        if((vm->v[x]) == kk) vm->pc += 2;
-        return true;
-    case 0x4000: // SNE Vx, byte
-        if(vm->v[x] != kk) vm->pc += 2;
-        return true;
-    case 0x5000: // SE Vx, Vy
-        if(vm->v[x] == vm->v[y]) vm->pc += 2;
-        return true;
-    case 0x6000: // LD Vx, byte
-        vm->v[x] = kk;
-        return true;
-    case 0x7000: // ADD Vx, byte
-        vm->v[x] += kk;
-        return true;
-    case 0x8000:
-        switch(opcode & 0x000F) {
-        case 0x0000: // LD Vx, Vy
-            vm->v[x] = vm->v[y];
-            return true;
-        case 0x0001: // OR Vx, Vy
-            vm->v[x] |= vm->v[y];
-            vf_reset(vm);
-            return true;
-        case 0x0002: // AND Vx, Vy
-            vm->v[x] &= vm->v[y];
-            vf_reset(vm);
-            return true;
-        case 0x0003: // XOR Vx, Vy
-            vm->v[x] ^= vm->v[y];
-            vf_reset(vm);
-            return true;
-        case 0x0004: // ADD Vx, Vy
-        {
-            const bool carry = vm->v[x] > (0xFF - vm->v[y]);
-            vm->v[x] += vm->v[y];
-            vm->v[0xF] = carry ? 0x01 : 0x00;
-        }
-            return true;
-        case 0x0005: // SUB Vx, Vy
-        {
-            const bool borrow = (vm->v[y] > vm->v[x]);
-            vm->v[x] -= vm->v[y];
-            vm->v[0xF] = borrow ? 0x00 : 0x01;
-        }
-            return true;
-        case 0x0006: // SHR Vx {, Vy}
-        {
-            vm->v[x] = vm->v[y]; // quirk
-            const bool carry = vm->v[x] & 0x01;
-            vm->v[x] >>= 1;
-            vm->v[0xF] = carry ? 0x01 : 0x00;
-            return true;
-        }
-        case 0x0007: // SUBN Vx, Vy
-        {
-            const bool borrow = vm->v[x] > vm->v[y];
-            vm->v[x] = vm->v[y] - vm->v[x];
-            vm->v[0xF] = borrow ? 0x00 : 0x01;
-            return true;
+static ScreenWord pixel_mask(const size_t x) {
+    return (ScreenWord)(1) << (SCREEN_WORD_BITS - 1 - x % SCREEN_WORD_BITS);
+}
+
+static bool read_pixel(VM* vm, const size_t x, const size_t y) {
+    return (vm->screen[y][x / SCREEN_WORD_BITS] & pixel_mask(x)) != 0;
+}
+
+/* Reads the sprite at I into rows, shifted right by shift. Addresses past the end
+ * of memory wrap around. */
+static void shift_sprite(VM* vm, const byte n, const byte shift, uint64_t* rows) {
+    const word addr = vm->i;
+    if(n == 0) {
+        for(byte row = 0; row < MAX_SPRITE_HEIGHT; row++) {
+            const word bits = join(
+                vm->memory[(addr + 2 * row + 1) % MEMORY_SIZE],
+                vm->memory[(addr + 2 * row) % MEMORY_SIZE]);
+            rows[row] = (uint64_t)bits << (48 - shift);
         }
-        case 0x000E: // SHL Vx {, Vy}
-            vm->v[x] = vm->v[y]; // quirk
-            const bool carry = (vm->v[x] >> 7) & 0x01;
-            vm->v[x] <<= 1;
-            vm->v[0xF] = carry ? 0x01 : 0x00;
-            return true;
+    } else {
+        for(byte row = 0; row < n; row++) {
+            rows[row] = (uint64_t)vm->memory[(addr + row) % MEMORY_SIZE] << (56 - shift);
         }
-        break;
-    case 0x9000: // SNE Vx, Vy
-        if(vm->v[x] != vm->v[y]) vm->pc += 2;
-        return true;
-    case 0xA000: // LD I, addr
-        vm->i = nnn;
-        return true;
-    case 0xB000: // JP V0, addr
-        vm->pc = nnn + vm->v[0x0];
-        // vm->pc = nnn + vm->v[x]; // quirk
-        return true;
-    case 0xC000: // RND Vx, byte
-        vm->v[x] = (rand() % 0x100) & kk;
-        return true;
-    case 0xD000: // DRW Vx, Vy, nibble
-        vm->v[0xF] = 0x00;
-        const bool large_sprite = (n == 0);
-        const byte sprite_height = large_sprite ? 16 : n;
-        const byte bytes_per_row = large_sprite ? 2 : 1;
-        const byte y_orig = vm->v[y] % vm_get_screen_height(vm);
-        // const byte y_orig = vm->v[y]; // clipping quirk
-        const byte x_orig = vm->v[x] % vm_get_screen_width(vm);
-        // const byte x_orig = vm->v[x]; // clipping quirk
-        word addr = vm->i;
-        for(byte row = 0; row < sprite_height; row++) {
-            const byte y_screen = (y_orig + row);
-            if(y_screen < vm_get_screen_height(vm)) {
-                for(byte row_byte = 0; row_byte < bytes_per_row; row_byte++) {
-                    const byte b = vm->memory[addr];
-                    for(byte col = 0; col < 8; col++) {
-                        const byte x_screen = (x_orig + col + 8 * row_byte);
-                        if(x_screen < vm_get_screen_width(vm)) {
-                            const bool next = (b & (1 << (7 - col))) > 0;
-                            vm->v[0xF] = xor_pixel(vm, x_screen, y_screen, next) ? 0x01 :
-                                                                                   vm->v[0xF];
-                        }
-                    }
-                    addr++;
-                }
-            }
+    }
+}
+
+#if VM_SPRITE_CACHE_ENTRIES > 0 || VM_MEMORY_HEATMAP
+static size_t sprite_size(const byte n) {
+    return n == 0 ? 2 * MAX_SPRITE_HEIGHT : n;
+}
+#endif
+
+#if VM_SPRITE_CACHE_ENTRIES > 0
+/* The shifted rows of the sprite at I, from the cache if they are there, else
+ * shifted into the least recently used entry. Sprites that wrap around the end
+ * of memory are not cached, they are shifted into buffer. */
+static const uint64_t* sprite_cache_get(VM* vm, const byte n, const byte shift, uint64_t* buffer) {
+    if(vm->i + sprite_size(n) > MEMORY_SIZE) {
+        shift_sprite(vm, n, shift, buffer);
+        return buffer;
+    }
+    if(++vm->sprite_cache_clock == 0) {
+        sprite_cache_reset(vm);
+        vm->sprite_cache_clock = 1;
+    }
+    SpriteCacheEntry* victim = &vm->sprite_cache[0];
+    for(size_t j = 0; j < VM_SPRITE_CACHE_ENTRIES; j++) {
+        SpriteCacheEntry* entry = &vm->sprite_cache[j];
+        if(entry->last_used != 0 && entry->addr == vm->i && entry->n == n &&
+           entry->shift == shift) {
+            entry->last_used = vm->sprite_cache_clock;
+            return entry->rows;
         }
+        if(entry->last_used < victim->last_used) victim = entry;
+    }
 
-        return true;
-    case 0xE000:
-        switch(opcode & 0x00FF) {
-        case 0x009E: // SKP Vx
-            if(fetch_is_key_pressed(vm, vm->v[x])) {
-                vm->pc += 2;
-            }
-            return true;
-        case 0x00A1: // SKNP Vx
-            if(!fetch_is_key_pressed(vm, vm->v[x])) {
-                vm->pc += 2;
-            }
-            return true;
+    shift_sprite(vm, n, shift, victim->rows);
+    victim->addr = vm->i;
+    victim->n = n;
+    victim->shift = shift;
+    victim->last_used = vm->sprite_cache_clock;
+    const word end = vm->i + sprite_size(n);
+    if(vm->sprite_cache_start == vm->sprite_cache_end) {
+        vm->sprite_cache_start = vm->i;
+        vm->sprite_cache_end = end;
+    } else {
+        if(vm->i < vm->sprite_cache_start) vm->sprite_cache_start = vm->i;
+        if(end > vm->sprite_cache_end) vm->sprite_cache_end = end;
+    }
+    return victim->rows;
+}
+#endif
+
+#if VM_SPRITE_CACHE_ENTRIES > 0
+// drops the entries that cover any of the size bytes from addr on
+static void sprite_cache_invalidate(VM* vm, const word addr, const size_t size) {
+    if(addr >= vm->sprite_cache_end || addr + size <= vm->sprite_cache_start) return;
+    word start = 0, end = 0;
+    for(size_t j = 0; j < VM_SPRITE_CACHE_ENTRIES; j++) {
+        SpriteCacheEntry* entry = &vm->sprite_cache[j];
+        if(entry->last_used == 0) continue;
+        const word entry_end = entry->addr + sprite_size(entry->n);
+        if(addr < entry_end && addr + size > entry->addr) {
+            entry->last_used = 0;
+        } else if(start == end) {
+            start = entry->addr;
+            end = entry_end;
+        } else {
+            if(entry->addr < start) start = entry->addr;
+            if(entry_end > end) end = entry_end;
         }
-        break;
-    case 0xF000:
-        switch(opcode & 0x00FF) {
-        case 0x0007: // LD Vx, DT
-            vm->v[x] = vm->delay_timer;
-            return true;
-        case 0x000A: // LD Vx, K
-            vm->is_waiting_for_key = true;
-            vm->waiting_for_key_index = x;
-            return true;
-        case 0x0015: // LD DT, Vx
-            vm->delay_timer = vm->v[x];
-            return true;
-        case 0x0018: // LD ST, Vx
-            vm->sound_timer = vm->v[x];
-            return true;
-        case 0x001E: // ADD I, Vx
-            vm->i += vm->v[x];
-            return true;
-        case 0x0029: // LD SMALLHEX, Vx
-            vm->i = 5 * vm->v[x];
-            return true;
-        case 0x0030: // LD BIGHEX, Vx
-            vm->i = 80 + 10 * vm->v[x];
-            return true;
-        case 0x0033: // LD B, Vx
-            const byte vx = vm->v[x];
-            vm->memory[vm->i] = vx / 100;
-            vm->memory[vm->i + 1] = (vx % 100) / 10;
-            vm->memory[vm->i + 2] = (vx % 10);
-            return true;
-        case 0x0055: // LD [I], Vx
-            for(int j = 0; j <= x; j++) {
-                vm->memory[vm->i + j] = vm->v[j];
-            }
-            return true;
-        case 0x0065: // LD Vx, [I]
-            for(int j = 0; j <= x; j++) {
-                vm->v[j] = vm->memory[vm->i + j];
-            }
-            return true;
-        case 0x0075: // SAVE FLAGS, Vx
-            vm->mode = ModeSuperChip8;
-            for(int j = 0; j <= x; j++) {
-                // save vm->v[j] to persistent memory
-            }
-            return false;
-        case 0x0085: // LOAD FLAGS, Vx
-            vm->mode = ModeSuperChip8;
-            for(int j = 0; j <= x; j++) {
-                // load vm->v[j] from persistent memory
-            }
-            return false;
-        case 0x00FD: // EXIT
-            // vm->is_game_over = true;
-            return true;
+    }
+    vm->sprite_cache_start = start;
+    vm->sprite_cache_end = end;
+}
+#endif
+
+void vm_memory_written(VM* vm, const word addr, const size_t size) {
+    uint64_t pages = 0;
+    for(size_t j = 0; j < size; j++) pages |= page_bit(addr + j);
+    vm->written_pages |= pages;
+#if VM_FEATURE_CLONE
+    vm->clone_dirty_memory |= pages;
+#endif
+#if VM_MEMORY_HEATMAP
+    heatmap_count(vm->heatmap.writes, addr, size);
+#endif
+#if VM_SPRITE_CACHE_ENTRIES > 0
+    sprite_cache_invalidate(vm, addr, size);
+#endif
+}
+
+/* Draws a row at a time: the sprite row, shifted to the pixel column, covers two
+ * screen words, the second of which is clipped at the right edge of the screen.
+ * Rows below the bottom edge are clipped as well. */
+void vm_draw_sprite(VM* vm, const byte x, const byte y, const byte n) {
+    vm->v[0xF] = 0x00;
+    vm->screen_changes++;
+    const int width = vm_get_screen_width(vm);
+    const int height = vm_get_screen_height(vm);
+    const byte y_orig = vm->v[y] % height;
+    // const byte y_orig = vm->v[y]; // clipping quirk
+    const byte x_orig = vm->v[x] % width;
+    // const byte x_orig = vm->v[x]; // clipping quirk
+    const byte shift = x_orig % SCREEN_WORD_BITS;
+    const size_t column = x_orig / SCREEN_WORD_BITS;
+    const bool is_clipped = (int)(column + 1) * SCREEN_WORD_BITS >= width;
+    const byte sprite_height = (n == 0) ? MAX_SPRITE_HEIGHT : n;
+    const byte rows = (y_orig + sprite_height > height) ? height - y_orig : sprite_height;
+
+#if VM_MEMORY_HEATMAP
+    heatmap_count(vm->heatmap.reads, vm->i, sprite_size(n));
+#endif
+    uint64_t buffer[MAX_SPRITE_HEIGHT];
+#if VM_SPRITE_CACHE_ENTRIES > 0
+    const uint64_t* shifted = sprite_cache_get(vm, n, shift, buffer);
+#else
+    shift_sprite(vm, n, shift, buffer);
+    const uint64_t* shifted = buffer;
+#endif
+
+    ScreenWord collision = 0;
+    for(byte row = 0; row < rows; row++) {
+        ScreenWord* screen = &vm->screen[y_orig + row][column];
+        const ScreenWord left = shifted[row] >> SCREEN_WORD_BITS;
+        collision |= screen[0] & left;
+        screen[0] ^= left;
+        if(!is_clipped) {
+            const ScreenWord right = (ScreenWord)shifted[row];
+            collision |= screen[1] & right;
+            screen[1] ^= right;
         }
+    }
+    vm->v[0xF] = (collision != 0) ? 0x01 : 0x00;
+#if VM_PROFILE_CALLS
+    vm->profile_nodes[vm->profile_node].sprites++;
+    vm->profile_nodes[vm->profile_node].sprite_rows += rows;
+#endif
+#if VM_FEATURE_CLONE
+    for(byte row = 0; row < rows; row++) {
+        vm->clone_dirty_screen |= (uint32_t)1 << ((y_orig + row) / SCREEN_ROWS_PER_PAGE);
+    }
+#endif
+}
 
-        break;
+/* The handlers of VM_OPCODES in opcodes.h, one per instruction. */
+
+VM_HANDLER bool execute_cls(VM* vm, const word opcode) {
+    (void)opcode;
+    vm_clear_display(vm);
+    return true;
+}
+
+VM_HANDLER bool execute_ret(VM* vm, const word opcode) {
+    (void)opcode;
+    vm->pc = vm->stack[--vm->sp];
+#if VM_PROFILE_CALLS
+    profile_return(vm);
+#endif
+    return true;
+}
+
+VM_HANDLER bool execute_scroll_down(VM* vm, const word opcode) {
+    vm->mode = ModeSuperChip8;
+    vm->scroll_vertical += opcode_n(opcode);
+    vm->screen_changes++;
+    return true;
+}
+
+VM_HANDLER bool execute_scroll_up(VM* vm, const word opcode) {
+    vm->mode = ModeSuperChip8;
+    vm->scroll_vertical -= opcode_n(opcode);
+    vm->screen_changes++;
+    return true;
+}
+
+VM_HANDLER bool execute_scroll_right(VM* vm, const word opcode) {
+    (void)opcode;
+    vm->scroll_horizontal += 4;
+    vm->screen_changes++;
+    vm->mode = ModeSuperChip8;
+    return true;
+}
+
+VM_HANDLER bool execute_scroll_left(VM* vm, const word opcode) {
+    (void)opcode;
+    vm->scroll_horizontal -= 4;
+    vm->screen_changes++;
+    vm->mode = ModeSuperChip8;
+    return true;
+}
+
+VM_HANDLER bool execute_exit(VM* vm, const word opcode) {
+    (void)vm;
+    (void)opcode;
+    // vm->is_game_over = true;
+    return true;
+}
+
+VM_HANDLER bool execute_lores(VM* vm, const word opcode) {
+    (void)opcode;
+    vm->screen_resolution = ScreenResolutionLow;
+    vm->mode = ModeSuperChip8;
+    vm->screen_changes++;
+    return true;
+}
+
+VM_HANDLER bool execute_hires(VM* vm, const word opcode) {
+    (void)opcode;
+    vm->screen_resolution = ScreenResolutionHigh;
+    vm->mode = ModeSuperChip8;
+    vm->screen_changes++;
+    return true;
+}
+
+VM_HANDLER bool execute_jp(VM* vm, const word opcode) {
+    vm->pc = opcode_nnn(opcode);
+    return true;
+}
+
+VM_HANDLER bool execute_call(VM* vm, const word opcode) {
+    if(vm->sp == STACK_SIZE) {
+        return false;
+    }
+    vm->stack[vm->sp++] = vm->pc;
+    vm->pc = opcode_nnn(opcode);
+#if VM_PROFILE_CALLS
+    profile_call(vm, vm->pc);
+#endif
+    return true;
+}
+
+VM_HANDLER bool execute_se_byte(VM* vm, const word opcode) {
+    if(vm->v[opcode_x(opcode)] == opcode_kk(opcode)) vm->pc += 2;
+    return true;
+}
+
+VM_HANDLER bool execute_sne_byte(VM* vm, const word opcode) {
+    if(vm->v[opcode_x(opcode)] != opcode_kk(opcode)) vm->pc += 2;
+    return true;
+}
+
+VM_HANDLER bool execute_se_reg(VM* vm, const word opcode) {
+    if(vm->v[opcode_x(opcode)] == vm->v[opcode_y(opcode)]) vm->pc += 2;
+    return true;
+}
+
+VM_HANDLER bool execute_ld_byte(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] = opcode_kk(opcode);
+    return true;
+}
+
+VM_HANDLER bool execute_add_byte(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] += opcode_kk(opcode);
+    return true;
+}
+
+VM_HANDLER bool execute_ld_reg(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] = vm->v[opcode_y(opcode)];
+    return true;
+}
+
+VM_HANDLER bool execute_or(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] |= vm->v[opcode_y(opcode)];
+    vf_reset(vm);
+    return true;
+}
+
+VM_HANDLER bool execute_and(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] &= vm->v[opcode_y(opcode)];
+    vf_reset(vm);
+    return true;
+}
+
+VM_HANDLER bool execute_xor(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] ^= vm->v[opcode_y(opcode)];
+    vf_reset(vm);
+    return true;
+}
+
+VM_HANDLER bool execute_add_reg(VM* vm, const word opcode) {
+    const byte x = opcode_x(opcode);
+    const byte y = opcode_y(opcode);
+    const bool carry = vm->v[x] > (0xFF - vm->v[y]);
+    vm->v[x] += vm->v[y];
+    vm->v[0xF] = carry ? 0x01 : 0x00;
+    return true;
+}
+
+VM_HANDLER bool execute_sub(VM* vm, const word opcode) {
+    const byte x = opcode_x(opcode);
+    const byte y = opcode_y(opcode);
+    const bool borrow = (vm->v[y] > vm->v[x]);
+    vm->v[x] -= vm->v[y];
+    vm->v[0xF] = borrow ? 0x00 : 0x01;
+    return true;
+}
+
+VM_HANDLER bool execute_shr(VM* vm, const word opcode) {
+    const byte x = opcode_x(opcode);
+    vm->v[x] = vm->v[opcode_y(opcode)]; // quirk
+    const bool carry = vm->v[x] & 0x01;
+    vm->v[x] >>= 1;
+    vm->v[0xF] = carry ? 0x01 : 0x00;
+    return true;
+}
+
+VM_HANDLER bool execute_subn(VM* vm, const word opcode) {
+    const byte x = opcode_x(opcode);
+    const byte y = opcode_y(opcode);
+    const bool borrow = vm->v[x] > vm->v[y];
+    vm->v[x] = vm->v[y] - vm->v[x];
+    vm->v[0xF] = borrow ? 0x00 : 0x01;
+    return true;
+}
+
+VM_HANDLER bool execute_shl(VM* vm, const word opcode) {
+    const byte x = opcode_x(opcode);
+    vm->v[x] = vm->v[opcode_y(opcode)]; // quirk
+    const bool carry = (vm->v[x] >> 7) & 0x01;
+    vm->v[x] <<= 1;
+    vm->v[0xF] = carry ? 0x01 : 0x00;
+    return true;
+}
+
+VM_HANDLER bool execute_sne_reg(VM* vm, const word opcode) {
+    if(vm->v[opcode_x(opcode)] != vm->v[opcode_y(opcode)]) vm->pc += 2;
+    return true;
+}
+
+VM_HANDLER bool execute_ld_i(VM* vm, const word opcode) {
+    vm->i = opcode_nnn(opcode);
+    return true;
+}
+
+VM_HANDLER bool execute_jp_v0(VM* vm, const word opcode) {
+    vm->pc = opcode_nnn(opcode) + vm->v[0x0];
+    // vm->pc = opcode_nnn(opcode) + vm->v[opcode_x(opcode)]; // quirk
+    return true;
+}
+
+VM_HANDLER bool execute_rnd(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] = vm_random_byte(vm) & opcode_kk(opcode);
+    return true;
+}
+
+VM_HANDLER bool execute_drw(VM* vm, const word opcode) {
+    vm_draw_sprite(vm, opcode_x(opcode), opcode_y(opcode), opcode_n(opcode));
+    return true;
+}
+
+VM_HANDLER bool execute_skp(VM* vm, const word opcode) {
+    if(vm_fetch_is_key_pressed(vm, vm->v[opcode_x(opcode)])) vm->pc += 2;
+    return true;
+}
+
+VM_HANDLER bool execute_sknp(VM* vm, const word opcode) {
+    if(!vm_fetch_is_key_pressed(vm, vm->v[opcode_x(opcode)])) vm->pc += 2;
+    return true;
+}
+
+VM_HANDLER bool execute_ld_vx_dt(VM* vm, const word opcode) {
+    vm->v[opcode_x(opcode)] = vm->delay_timer;
+    return true;
+}
+
+VM_HANDLER bool execute_ld_vx_k(VM* vm, const word opcode) {
+    vm->is_waiting_for_key = true;
+    vm->waiting_for_key_index = opcode_x(opcode);
+    return true;
+}
+
+VM_HANDLER bool execute_ld_dt_vx(VM* vm, const word opcode) {
+    vm->delay_timer = vm->v[opcode_x(opcode)];
+    return true;
+}
+
+VM_HANDLER bool execute_ld_st_vx(VM* vm, const word opcode) {
+    vm->sound_timer = vm->v[opcode_x(opcode)];
+    return true;
+}
+
+VM_HANDLER bool execute_add_i(VM* vm, const word opcode) {
+    vm->i += vm->v[opcode_x(opcode)];
+    return true;
+}
+
+VM_HANDLER bool execute_ld_f(VM* vm, const word opcode) {
+    vm->i = 5 * vm->v[opcode_x(opcode)];
+    return true;
+}
+
+VM_HANDLER bool execute_ld_hf(VM* vm, const word opcode) {
+    vm->i = 80 + 10 * vm->v[opcode_x(opcode)];
+    return true;
+}
+
+VM_HANDLER bool execute_ld_b(VM* vm, const word opcode) {
+    const byte vx = vm->v[opcode_x(opcode)];
+    vm->memory[vm->i] = vx / 100;
+    vm->memory[vm->i + 1] = (vx % 100) / 10;
+    vm->memory[vm->i + 2] = (vx % 10);
+    vm_memory_written(vm, vm->i, 3);
+    return true;
+}
+
+VM_HANDLER bool execute_store(VM* vm, const word opcode) {
+    for(int j = 0; j <= opcode_x(opcode); j++) {
+        vm->memory[vm->i + j] = vm->v[j];
+    }
+    vm_memory_written(vm, vm->i, opcode_x(opcode) + 1);
+    return true;
+}
+
+VM_HANDLER bool execute_load(VM* vm, const word opcode) {
+    for(int j = 0; j <= opcode_x(opcode); j++) {
+        vm->v[j] = vm->memory[vm->i + j];
+    }
+#if VM_MEMORY_HEATMAP
+    heatmap_count(vm->heatmap.reads, vm->i, opcode_x(opcode) + 1);
+#endif
+    return true;
+}
+
+VM_HANDLER bool execute_save_flags(VM* vm, const word opcode) {
+    vm->mode = ModeSuperChip8;
+    for(int j = 0; j <= opcode_x(opcode); j++) {
+        // save vm->v[j] to persistent memory
     }
     return false;
 }
 
+VM_HANDLER bool execute_load_flags(VM* vm, const word opcode) {
+    vm->mode = ModeSuperChip8;
+    for(int j = 0; j <= opcode_x(opcode); j++) {
+        // load vm->v[j] from persistent memory
+    }
+    return false;
+}
+
+/* The same decode as opcode_decode, but the rows are expanded in place so that the
+ * compiler can drop the ones of other nibbles and turn the rest into jump tables.
+ * SUPER-CHIP and XO-CHIP instructions are invalid when the VM is built without the
+ * SUPER-CHIP screen. */
+bool vm_execute(VM* vm, word opcode) {
+#define EXECUTE(nibble, Name, handler, mask, match, mnemonic, operands, mode, ...)    \
+    if((match) >> 12 == (nibble) && (opcode & (mask)) == (match)) {                \
+        return (VM_FEATURE_SCHIP || (mode) == OpcodeModeChip8) && handler(vm, opcode); \
+    }
+    switch(opcode >> 12) {
+    case 0x0:
+        VM_OPCODES(EXECUTE, 0x0)
+        return false;
+    case 0x1:
+        VM_OPCODES(EXECUTE, 0x1)
+        return false;
+    case 0x2:
+        VM_OPCODES(EXECUTE, 0x2)
+        return false;
+    case 0x3:
+        VM_OPCODES(EXECUTE, 0x3)
+        return false;
+    case 0x4:
+        VM_OPCODES(EXECUTE, 0x4)
+        return false;
+    case 0x5:
+        VM_OPCODES(EXECUTE, 0x5)
+        return false;
+    case 0x6:
+        VM_OPCODES(EXECUTE, 0x6)
+        return false;
+    case 0x7:
+        VM_OPCODES(EXECUTE, 0x7)
+        return false;
+    case 0x8:
+        VM_OPCODES(EXECUTE, 0x8)
+        return false;
+    case 0x9:
+        VM_OPCODES(EXECUTE, 0x9)
+        return false;
+    case 0xA:
+        VM_OPCODES(EXECUTE, 0xA)
+        return false;
+    case 0xB:
+        VM_OPCODES(EXECUTE, 0xB)
+        return false;
+    case 0xC:
+        VM_OPCODES(EXECUTE, 0xC)
+        return false;
+    case 0xD:
+        VM_OPCODES(EXECUTE, 0xD)
+        return false;
+    case 0xE:
+        VM_OPCODES(EXECUTE, 0xE)
+        return false;
+    case 0xF:
+        VM_OPCODES(EXECUTE, 0xF)
+        return false;
+    default:
+        return false;
+    }
+#undef EXECUTE
+}
+
 static void reset_time(VM* vm, const uint32_t timestamp_world) {
+#if VM_PROFILE_CALLS
+    vm_profile_flush(vm);
+    vm->profile_ticks = 0;
+#endif
     vm->timestamp_init = timestamp_world;
     vm->cpu_ticks = 0;
     vm->timer_ticks = 0;
@@ -455,10 +826,65 @@ uint32_t vm_calc_cpu_speed(VM* vm, const uint32_t timestamp_world) {
     return vm_tick_speed(vm->cpu_ticks, uptime(vm, timestamp_world));
 }
 
-static void handle_input(VM* vm) {
+uint32_t vm_get_recent_cpu_speed(VM* vm) {
+    return perf_window_rate(&vm->cpu_window);
+}
+
+uint32_t vm_get_recent_frame_speed(VM* vm) {
+    return perf_window_rate(&vm->frame_window);
+}
+
+uint32_t vm_calc_frame_speed(VM* vm, const uint32_t timestamp_world) {
+    return vm_tick_speed(vm->timer_ticks - vm->dropped_frames, uptime(vm, timestamp_world));
+}
+
+void vm_set_frame_pacing(
+    VM* vm,
+    const uint16_t instructions_per_sec,
+    const uint8_t max_catchup_frames,
+    const bool is_auto_tuned) {
+    vm->instructions_per_sec = instructions_per_sec;
+    vm->target_instructions_per_sec = instructions_per_sec;
+    vm->frame_instruction_carry = 0;
+    vm->max_catchup_frames = max_catchup_frames > 0 ? max_catchup_frames : 1;
+    vm->is_auto_tuned = is_auto_tuned && instructions_per_sec > 0;
+    vm->tune_frames = 0;
+    vm->tune_dropped_frames = 0;
+}
+
+void vm_set_vip_timing(VM* vm, const bool is_vip_timing) {
+    vm->is_vip_timing = is_vip_timing;
+    vm->vip_overrun_cycles = 0;
+}
+
+uint16_t vm_get_instructions_per_sec(VM* vm) {
+    return vm->instructions_per_sec;
+}
+
+uint32_t vm_get_dropped_frames(VM* vm) {
+    return vm->dropped_frames;
+}
+
+uint64_t vm_get_cpu_ticks(VM* vm) {
+    return vm->cpu_ticks;
+}
+
+uint64_t vm_get_timer_ticks(VM* vm) {
+    return vm->timer_ticks;
+}
+
+uint32_t vm_get_key_observations(VM* vm) {
+    return vm->key_observations;
+}
+
+uint32_t vm_get_screen_changes(VM* vm) {
+    return vm->screen_changes;
+}
+
+void vm_handle_input(VM* vm) {
     if(vm->is_waiting_for_key) {
         for(byte key_id = 0; key_id < 0x10; key_id++) {
-            if(fetch_is_key_pressed(vm, key_id)) {
+            if(vm_fetch_is_key_pressed(vm, key_id)) {
                 vm->v[vm->waiting_for_key_index] = key_id;
                 vm->is_waiting_for_key = false;
             }
@@ -466,13 +892,13 @@ static void handle_input(VM* vm) {
     }
 }
 
-static bool tick_cpu(VM* vm) {
+bool vm_tick_cpu(VM* vm) {
     vm->cpu_ticks++;
     if(vm->is_waiting_for_key) {
         return true;
     }
     const word opcode = fetch(vm);
-    return execute(vm, opcode);
+    return vm_execute(vm, opcode);
 }
 
 static void tick_timers(VM* vm) {
@@ -481,7 +907,7 @@ static void tick_timers(VM* vm) {
     vm->timer_ticks++;
 }
 
-static uint32_t timestamp_cpu(VM* vm) {
+uint32_t vm_timestamp_cpu(VM* vm) {
     return vm->timestamp_init + vm->cpu_ticks * MS_PER_CPU_TICK;
 }
 
@@ -489,24 +915,239 @@ static uint32_t timestamp_timers(VM* vm) {
     return vm->timestamp_init + vm->timer_ticks * MS_PER_TIMER_TICK;
 }
 
-static bool handle_scheduling(VM* vm) {
-    if(timestamp_cpu(vm) <= timestamp_timers(vm)) {
-        return tick_cpu(vm);
+void vm_tick_timers_until(VM* vm, const uint32_t timestamp) {
+    while(timestamp_timers(vm) < timestamp) {
+        tick_timers(vm);
+    }
+}
+
+static word peek(VM* vm, const word addr) {
+    return join(vm->memory[addr + 1], vm->memory[addr]);
+}
+
+/* `vx := delay / if vx != 0 then jump <self>`, spins until the delay timer runs out */
+static bool is_delay_spin(VM* vm) {
+    const word pc = vm->pc;
+    if(vm->delay_timer == 0 || pc + 6 > MEMORY_SIZE) return false;
+    const word load = peek(vm, pc);
+    const word x = load & 0x0F00;
+    return (load & 0xF0FF) == 0xF007 && peek(vm, pc + 2) == (0x3000 | x) &&
+           peek(vm, pc + 4) == (0x1000 | pc);
+}
+
+/* Length of a loop that only a key press can leave: `jump <self>`, which most
+ * programs end with, or `if vx -key then jump <self>`. Zero for anything else. */
+static byte input_spin_length(VM* vm) {
+    const word pc = vm->pc;
+    if(pc + 2 > MEMORY_SIZE) return 0;
+    const word check = peek(vm, pc);
+    if(check == (0x1000 | pc)) return 1;
+    if(pc + 4 > MEMORY_SIZE) return 0;
+    const byte key_id = vm->v[(check >> 8) & 0x0F];
+    const bool is_key_spin = (check & 0xF0FF) == 0xE09E && peek(vm, pc + 2) == (0x1000 | pc) &&
+                             key_id < 0x10 && !vm->is_key_pressed[key_id];
+    return is_key_spin ? 2 : 0;
+}
+
+/* Skips instructions that cannot change the machine state: waiting for a key
+ * and the spin loops above. At most `budget` instructions are skipped, and at
+ * most `timer_budget` of a loop that reads the delay timer. Returns the number
+ * of instructions skipped, the VM ends up exactly where running them one at a
+ * time would have left it. */
+static uint64_t skip_idle(VM* vm, const uint64_t budget, const uint64_t timer_budget) {
+    if(vm->is_waiting_for_key) {
+        // nothing runs until the next vm_handle_input
+        vm->cpu_ticks += budget;
+        return budget;
+    }
+    const byte spin_length = input_spin_length(vm);
+    if(spin_length > 0) {
+        const uint64_t skipped = budget / spin_length * spin_length;
+        vm->cpu_ticks += skipped;
+        return skipped;
+    }
+    if(is_delay_spin(vm)) {
+        const uint64_t skipped = timer_budget / 3 * 3;
+        if(skipped > 0) vm->v[(peek(vm, vm->pc) >> 8) & 0x0F] = vm->delay_timer;
+        vm->cpu_ticks += skipped;
+        return skipped;
+    }
+    return 0;
+}
+
+static bool is_idle(VM* vm) {
+    return vm->is_waiting_for_key || input_spin_length(vm) > 0 || is_delay_spin(vm);
+}
+
+// number of cpu ticks due from now up to and including the timestamp `last`
+static uint64_t ticks_until(VM* vm, const uint32_t last) {
+    const uint32_t first = vm_timestamp_cpu(vm);
+    return last < first ? 0 : (last - first) / MS_PER_CPU_TICK + 1;
+}
+
+static bool handle_scheduling(VM* vm, const uint32_t timestamp_world) {
+    const uint32_t timers = timestamp_timers(vm);
+    if(vm_timestamp_cpu(vm) <= timers) {
+        // the update ends before timestamp_world, a delay loop at the next timer tick
+        const uint64_t budget = ticks_until(vm, timestamp_world - 1);
+        const uint64_t timer_budget =
+            ticks_until(vm, timers < timestamp_world ? timers : timestamp_world - 1);
+        if(skip_idle(vm, budget, timer_budget) > 0) return true;
+        return vm_tick_cpu(vm);
     } else {
         tick_timers(vm);
         return true;
     }
 }
 
+/* Frame pacing runs the instructions due by the end of the frame, then one timer
+ * tick. What is left of an instruction carries over to the next frame. */
+
+static bool run_frame(VM* vm) {
+    const uint32_t due =
+        vm->frame_instruction_carry + (uint32_t)vm->instructions_per_sec * MS_PER_TIMER_TICK;
+    const uint64_t count = due / 1000;
+    vm->frame_instruction_carry = due % 1000;
+    uint64_t n = 0;
+    while(n < count && !vm->is_game_over) {
+        const uint64_t left = count - n;
+        const uint64_t skipped = skip_idle(vm, left, left);
+        if(skipped > 0) {
+            n += skipped;
+            continue;
+        }
+        if(!vm_tick_cpu(vm)) return false;
+        n++;
+    }
+    tick_timers(vm);
+    return true;
+}
+
+/* COSMAC VIP timing runs instructions until the cycles of the frame are spent. */
+
+static uint32_t vip_cycles(const word opcode) {
+    const Instruction instruction = opcode_decode(opcode);
+    uint32_t cycles = VIP_FETCH_CYCLES + opcode_get_info(instruction)->cycles;
+    switch(instruction) {
+    case InstructionDrw:
+        cycles += (opcode_n(opcode) == 0 ? 2 * 16 : opcode_n(opcode)) * VIP_SPRITE_BYTE_CYCLES;
+        break;
+    case InstructionStore:
+    case InstructionLoad:
+        cycles += (opcode_x(opcode) + 1) * VIP_REGISTER_CYCLES;
+        break;
+    default:
+        break;
+    }
+    return cycles;
+}
+
+// cycles of one pass through the idle loop at pc and its length, 0 if there is none
+static uint32_t vip_spin_cycles(VM* vm, byte* length) {
+    *length = is_delay_spin(vm) ? 3 : input_spin_length(vm);
+    uint32_t cycles = 0;
+    for(byte j = 0; j < *length; j++) cycles += vip_cycles(peek(vm, vm->pc + 2 * j));
+    return cycles;
+}
+
+/* An instruction that is still running at the end of the frame finishes first, the
+ * next frame starts that much later. Whole passes through an idle loop are skipped,
+ * nothing in them changes within a frame. */
+static bool run_vip_frame(VM* vm) {
+    const bool is_display_wait = vm->screen_resolution == ScreenResolutionLow;
+    uint32_t cycles = vm->vip_overrun_cycles;
+    bool is_frame_start = true;
+    while(cycles < VIP_CYCLES_PER_FRAME && !vm->is_game_over && !vm->is_waiting_for_key) {
+        byte spin_length;
+        const uint32_t spin_cycles = vip_spin_cycles(vm, &spin_length);
+        const uint32_t left = VIP_CYCLES_PER_FRAME - cycles;
+        const uint32_t passes = spin_cycles > 0 ? left / spin_cycles : 0;
+        if(passes > 0) {
+            if(spin_length == 3) vm->v[(peek(vm, vm->pc) >> 8) & 0x0F] = vm->delay_timer;
+            vm->cpu_ticks += passes * spin_length;
+            cycles += passes * spin_cycles;
+            continue;
+        }
+        const word opcode = peek(vm, vm->pc);
+        if(is_display_wait && (opcode & 0xF000) == 0xD000 && !is_frame_start) break;
+        cycles += vip_cycles(opcode);
+        if(!vm_tick_cpu(vm)) return false;
+        is_frame_start = false;
+    }
+    vm->vip_overrun_cycles = cycles > VIP_CYCLES_PER_FRAME ? cycles - VIP_CYCLES_PER_FRAME : 0;
+    tick_timers(vm);
+    return true;
+}
+
+/* Trades instructions per second for dropped frames: backs off quickly while
+ * frames are dropped and creeps back up to the configured rate, an instruction per
+ * frame at a time, once they are not. */
+static void tune_instructions_per_sec(VM* vm, const bool is_dropped) {
+    vm->tune_dropped_frames += is_dropped ? 1 : 0;
+    if(++vm->tune_frames < TUNE_WINDOW_FRAMES) return;
+    if(vm->tune_dropped_frames > 0) {
+        const uint16_t decrease = vm->instructions_per_sec / 8 + TUNE_STEP_PER_SEC;
+        const bool is_above_min = vm->instructions_per_sec > MIN_INSTRUCTIONS_PER_SEC + decrease;
+        vm->instructions_per_sec =
+            is_above_min ? vm->instructions_per_sec - decrease : MIN_INSTRUCTIONS_PER_SEC;
+    } else if(vm->instructions_per_sec < vm->target_instructions_per_sec) {
+        const uint16_t increase = vm->target_instructions_per_sec - vm->instructions_per_sec;
+        vm->instructions_per_sec += increase < TUNE_STEP_PER_SEC ? increase : TUNE_STEP_PER_SEC;
+    }
+    vm->tune_frames = 0;
+    vm->tune_dropped_frames = 0;
+}
+
+/* Runs the frames due by timestamp_world. Past max_catchup_frames the busy ones
+ * are dropped: the timers still tick, the instructions are not run. Idle frames
+ * cost next to nothing and are always run. */
+static bool run_frames(VM* vm, const uint32_t timestamp_world) {
+    uint32_t frames = 0;
+    while(!vm->is_game_over && timestamp_timers(vm) < timestamp_world) {
+        const bool is_dropped = frames >= vm->max_catchup_frames && !is_idle(vm);
+        if(is_dropped) {
+            tick_timers(vm);
+            vm->dropped_frames++;
+        } else {
+            if(!(vm->is_vip_timing ? run_vip_frame(vm) : run_frame(vm))) return false;
+            frames++;
+        }
+        if(vm->is_auto_tuned && !vm->is_vip_timing) tune_instructions_per_sec(vm, is_dropped);
+    }
+    return true;
+}
+
+uint32_t vm_get_next_event(VM* vm) {
+    uint32_t next_event = VM_NO_EVENT;
+    if(vm->sound_timer > 0) {
+        next_event = timestamp_timers(vm) + (vm->sound_timer - 1) * MS_PER_TIMER_TICK + 1;
+    }
+    if(vm->is_waiting_for_key || input_spin_length(vm) > 0) {
+        return next_event;
+    }
+    if(is_delay_spin(vm)) {
+        const uint32_t delay_expired =
+            timestamp_timers(vm) + (vm->delay_timer - 1) * MS_PER_TIMER_TICK + 1;
+        return delay_expired < next_event ? delay_expired : next_event;
+    }
+    const bool is_frame_paced = vm->instructions_per_sec > 0 || vm->is_vip_timing;
+    return is_frame_paced ? timestamp_timers(vm) + 1 : vm_timestamp_cpu(vm);
+}
+
 bool vm_update(VM* vm, const uint32_t timestamp_world) {
     // handle time
     if(timestamp_world < vm->timestamp_init) reset_time(vm, timestamp_world);
 
-    handle_input(vm);
+    vm_handle_input(vm);
+
+    perf_window_sample(&vm->cpu_window, timestamp_world, vm->cpu_ticks);
+    perf_window_sample(&vm->frame_window, timestamp_world, vm->timer_ticks - vm->dropped_frames);
+
+    if(vm->instructions_per_sec > 0 || vm->is_vip_timing) return run_frames(vm, timestamp_world);
 
     while((!vm->is_game_over) &&
-          ((timestamp_cpu(vm) < timestamp_world) || (timestamp_timers(vm) < timestamp_world))) {
-        if(!handle_scheduling(vm)) {
+          ((vm_timestamp_cpu(vm) < timestamp_world) || (timestamp_timers(vm) < timestamp_world))) {
+        if(!handle_scheduling(vm, timestamp_world)) {
             return false;
         }
     }
@@ -522,6 +1163,22 @@ void vm_write_prog_to_memory(VM* vm, const word addr, const byte data) {
     vm->memory[PROG_START + addr] = data;
 }
 
+void vm_memory_replaced(VM* vm) {
+#if VM_SPRITE_CACHE_ENTRIES > 0
+    sprite_cache_reset(vm);
+#else
+    (void)vm;
+#endif
+}
+
+uint64_t vm_get_written_pages(VM* vm) {
+    return vm->written_pages;
+}
+
+uint64_t vm_get_code_written_pages(VM* vm) {
+    return vm->executed_pages & vm->written_pages;
+}
+
 void vm_set_keys(VM* vm, const word key_bitfield) {
     for(size_t id = 0; id < VM_NUM_KEYS; id++) {
         vm->is_key_pressed[id] = (key_bitfield & (1 << id)) > 0;
@@ -542,7 +1199,31 @@ bool vm_get_pixel(VM* vm, const int x_screen, const int y_screen) {
     if(x < 0 || x >= vm_get_screen_width(vm) || y < 0 || y >= vm_get_screen_height(vm)) {
         return false;
     }
-    return vm->screen[x][y];
+    return read_pixel(vm, x, y);
+}
+
+// byte k of row y of the framebuffer, anything outside the screen reads as blank
+static byte read_screen_byte(VM* vm, const int y, const int k) {
+    if(k < 0 || k >= vm_get_screen_width(vm) / 8) return 0x00;
+    const ScreenWord w = vm->screen[y][k / (SCREEN_WORD_BITS / 8)];
+    return w >> (SCREEN_WORD_BITS - 8 - 8 * (k % (SCREEN_WORD_BITS / 8)));
+}
+
+void vm_get_screen_row(VM* vm, const int y_screen, byte* row) {
+    const int bytes = vm_get_screen_width(vm) / 8;
+    const int y = y_screen - vm->scroll_vertical;
+    if(y < 0 || y >= vm_get_screen_height(vm)) {
+        memset(row, 0x00, bytes);
+        return;
+    }
+    // the scroll offset splits into whole bytes and a remaining shift
+    const int shift = ((vm->scroll_horizontal % 8) + 8) % 8;
+    const int offset = (vm->scroll_horizontal - shift) / 8;
+    for(int k = 0; k < bytes; k++) {
+        const byte right = read_screen_byte(vm, y, k - offset) >> shift;
+        const byte left = shift > 0 ? read_screen_byte(vm, y, k - offset - 1) << (8 - shift) : 0;
+        row[k] = left | right;
+    }
 }
 
 bool vm_is_sound_playing(VM* vm) {
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define VM_NUM_KEYS 16
 #define VM_CPU_TICKS_PER_SEC 500 // Hz (cpu speed)
+#define VM_NO_EVENT UINT32_MAX
+#define VM_DEFAULT_INSTRUCTIONS_PER_SEC VM_CPU_TICKS_PER_SEC
+#define VM_DEFAULT_MAX_CATCHUP_FRAMES 4
+#define VM_MEMORY_PAGE_SIZE 64 // bytes, the 4 KB of memory are 64 pages
 
 typedef uint8_t byte;
 typedef uint16_t word;
@@ -15,20 +20,83 @@ VM* vm_alloc();
 
 void vm_free(VM* vm);
 
+// size of one VM instance, for callers that place many VMs in a single allocation
+size_t vm_get_size();
+
 void vm_start(VM* vm, const uint32_t timestamp_world);
 bool vm_update(VM* vm, const uint32_t timestamp_world);
 bool vm_is_game_over(VM* vm);
 
+// world timestamp at which vm_update has something to do again: the next
+// instruction while the program runs, the end of a delay or sound timer while it
+// idles, or VM_NO_EVENT if only a key press can wake it up
+uint32_t vm_get_next_event(VM* vm);
+
+// selects the SUPER-CHIP quirks up front instead of on the first SUPER-CHIP opcode
+void vm_set_superchip(VM* vm, const bool is_superchip);
+
+// Runs instructions_per_sec instructions in bursts, one before each timer tick,
+// instead of one every 2 ms. A frame runs the instructions due by its end and
+// carries the fraction over, at any rate: the timers tick every 16 ms, so 500
+// per second run 8 a frame, 600 run 9 or 10. An update
+// that is more than max_catchup_frames behind drops the rest of its frames
+// rather than running them in a burst. With auto-tuning the rate drops below the
+// given one while frames are dropped. Passing 0 instructions per second returns
+// to millisecond scheduling, the default.
+void vm_set_frame_pacing(
+    VM* vm,
+    const uint16_t instructions_per_sec,
+    const uint8_t max_catchup_frames,
+    const bool is_auto_tuned);
+uint16_t vm_get_instructions_per_sec(VM* vm);
+
+// Runs the program at the speed of the CHIP-8 interpreter of the COSMAC VIP,
+// frame by frame like frame pacing, whose instructions per frame it replaces.
+// Each 60 Hz frame has a budget of machine cycles that instructions spend at
+// their VIP cost. DRW in the 64x32 mode waits for the start of the next frame,
+// as the VIP waited for the display interrupt. This mode is slower to emulate
+// than the other two.
+void vm_set_vip_timing(VM* vm, const bool is_vip_timing);
+uint32_t vm_get_dropped_frames(VM* vm);
+
+// the RNG is seeded from the start timestamp, reseed after vm_start for reproducible runs
+void vm_set_seed(VM* vm, const uint32_t seed);
+
+// goes before vm_start, which resets everything that depends on the memory
 void vm_write_prog_to_memory(VM* vm, const word addr, const byte data);
 
+// Pages of memory as a bitmap, bit n for the VM_MEMORY_PAGE_SIZE bytes from
+// n * VM_MEMORY_PAGE_SIZE on. Written pages were stored to by the program since
+// vm_start, loading it does not count. Code written pages also had instructions
+// run from them, before or after the store, so the program may modify itself
+// there; a ROM without any does not. Instructions outside the written pages
+// can be decoded once and kept.
+uint64_t vm_get_written_pages(VM* vm);
+uint64_t vm_get_code_written_pages(VM* vm);
+
 void vm_set_keys(VM* vm, const word key_bitfield);
 word vm_get_keys(VM* vm);
+// counts the SKP, SKNP and LD Vx, K that found their key pressed, the program has
+// seen a key set with vm_set_keys once this changes
+uint32_t vm_get_key_observations(VM* vm);
 
 bool vm_get_pixel(VM* vm, const int x_screen, const int y_screen);
+// copies a scrolled row of vm_get_screen_width() / 8 bytes, the leftmost pixel is the MSB
+void vm_get_screen_row(VM* vm, const int y_screen, byte* row);
 bool vm_is_sound_playing(VM* vm);
 
 uint32_t vm_calc_cpu_speed(VM* vm, const uint32_t timestamp_world);
 uint32_t vm_calc_timer_speed(VM* vm, const uint32_t timestamp_world);
+uint32_t vm_calc_frame_speed(VM* vm, const uint32_t timestamp_world);
+// the same over about the last second of updates, rather than since vm_start
+uint32_t vm_get_recent_cpu_speed(VM* vm);
+uint32_t vm_get_recent_frame_speed(VM* vm);
+uint64_t vm_get_cpu_ticks(VM* vm);
+// one timer tick per 60 Hz frame
+uint64_t vm_get_timer_ticks(VM* vm);
+// counts clears, sprites, scrolls and resolution switches, the screen is unchanged
+// for as long as this is
+uint32_t vm_get_screen_changes(VM* vm);
 
 int vm_get_screen_width(VM* vm);
 int vm_get_screen_height(VM* vm);
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "vm_clone.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm_i.h"
+
+#if VM_FEATURE_CLONE
+
+#define POOL_CHUNK_NODES 256
+#define HASH_SEED 14695981039346656037ull
+#define HASH_PRIME 1099511628211ull
+
+/* The state a clone copies besides memory, screen and stack, one field of the
+ * VM after the other. The program state comes first, it is what vm_clone_equals
+ * compares; the rest is when and how fast the program runs. */
+// clang-format off
+#define CLONE_FIELDS(X)                       \
+    X(pc)                                     \
+    X(i)                                      \
+    X(v)                                      \
+    X(sp)                                     \
+    X(delay_timer)                            \
+    X(sound_timer)                            \
+    X(is_key_pressed)                         \
+    X(is_waiting_for_key)                     \
+    X(waiting_for_key_index)                  \
+    X(mode)                                   \
+    X(rng_state)                              \
+    X(screen_resolution)                      \
+    X(scroll_horizontal)                      \
+    X(scroll_vertical)                        \
+    X(is_game_over)
+#define CLONE_TIMING_FIELDS(X)                \
+    X(timestamp_init)                         \
+    X(cpu_ticks)                              \
+    X(timer_ticks)                            \
+    X(instructions_per_sec)                   \
+    X(target_instructions_per_sec)            \
+    X(frame_instruction_carry)                \
+    X(max_catchup_frames)                     \
+    X(is_auto_tuned)                          \
+    X(dropped_frames)                         \
+    X(tune_frames)                            \
+    X(tune_dropped_frames)                    \
+    X(is_vip_timing)                          \
+    X(vip_overrun_cycles)                     \
+    X(screen_changes)                         \
+    X(key_observations)                       \
+    X(executed_pages)                         \
+    X(written_pages)
+// clang-format on
+
+#define FIELD_SIZE(field) +sizeof(((VM*)0)->field)
+#define STATE_SIZE (0 CLONE_FIELDS(FIELD_SIZE))
+#define CORE_SIZE (STATE_SIZE CLONE_TIMING_FIELDS(FIELD_SIZE))
+
+#define MEMORY_GROUPS (MEMORY_PAGES / CLONE_GROUP_PAGES)
+_Static_assert(
+    MEMORY_PAGES % CLONE_GROUP_PAGES == 0 && SCREEN_PAGES % CLONE_GROUP_PAGES == 0,
+    "memory and screen have to fill whole groups");
+_Static_assert(
+    sizeof(((VM*)0)->screen) == SCREEN_PAGES * VM_MEMORY_PAGE_SIZE,
+    "the screen has to fill whole pages");
+
+/* A page of memory or screen, or a group of CLONE_GROUP_PAGES pages. Pages are
+ * referenced by groups, groups by clones and by the VM they were last cloned
+ * from or restored to. The hash of a page is that of its data, the hash of a
+ * group the sum of the hashes of its pages, each times a weight for its
+ * position, so that a group can follow a change of page without going over the
+ * others. */
+typedef struct VmCloneNode {
+    uint32_t refs;
+    uint64_t hash;
+    struct VmCloneNode* next_free;
+    union {
+        byte data[VM_MEMORY_PAGE_SIZE];
+        struct VmCloneNode* pages[CLONE_GROUP_PAGES];
+    };
+} VmCloneNode;
+
+typedef struct PoolChunk {
+    struct PoolChunk* next;
+    VmCloneNode nodes[POOL_CHUNK_NODES];
+} PoolChunk;
+
+struct VmClonePool {
+    PoolChunk* chunks;
+    VmCloneNode* free_nodes;
+    size_t used_nodes;
+};
+
+struct VmClone {
+    VmClonePool* pool;
+    uint64_t hash;
+    VmCloneNode* groups[CLONE_GROUPS];
+    byte core[CORE_SIZE]; // the fields of CLONE_FIELDS and CLONE_TIMING_FIELDS, packed
+    byte sp;
+    word stack[]; // the sp entries in use
+};
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, const size_t size) {
+    const byte* bytes = data;
+    for(size_t j = 0; j < size; j++) hash = (hash ^ bytes[j]) * HASH_PRIME;
+    return hash;
+}
+
+// odd and different for every page of memory and screen
+static uint64_t page_weight(const size_t group, const size_t page) {
+    return ((group * CLONE_GROUP_PAGES + page) * HASH_PRIME) << 1 | 1;
+}
+
+VmClonePool* vm_clone_pool_alloc() {
+    VmClonePool* pool = malloc(sizeof(VmClonePool));
+    pool->chunks = NULL;
+    pool->free_nodes = NULL;
+    pool->used_nodes = 0;
+    return pool;
+}
+
+void vm_clone_pool_free(VmClonePool* pool) {
+    while(pool->chunks) {
+        PoolChunk* next = pool->chunks->next;
+        free(pool->chunks);
+        pool->chunks = next;
+    }
+    free(pool);
+}
+
+size_t vm_clone_pool_get_size(VmClonePool* pool) {
+    return pool->used_nodes * sizeof(VmCloneNode);
+}
+
+static VmCloneNode* node_alloc(VmClonePool* pool) {
+    if(!pool->free_nodes) {
+        PoolChunk* chunk = malloc(sizeof(PoolChunk));
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        for(size_t j = 0; j < POOL_CHUNK_NODES; j++) {
+            chunk->nodes[j].next_free = pool->free_nodes;
+            pool->free_nodes = &chunk->nodes[j];
+        }
+    }
+    VmCloneNode* node = pool->free_nodes;
+    pool->free_nodes = node->next_free;
+    pool->used_nodes++;
+    node->refs = 1;
+    return node;
+}
+
+static VmCloneNode* node_ref(VmCloneNode* node) {
+    node->refs++;
+    return node;
+}
+
+// false while the node is still referenced
+static bool node_unref(VmClonePool* pool, VmCloneNode* node) {
+    if(--node->refs > 0) return false;
+    node->next_free = pool->free_nodes;
+    pool->free_nodes = node;
+    pool->used_nodes--;
+    return true;
+}
+
+static VmCloneNode* page_alloc(VmClonePool* pool, const byte* data) {
+    VmCloneNode* page = node_alloc(pool);
+    memcpy(page->data, data, VM_MEMORY_PAGE_SIZE);
+    page->hash = hash_bytes(HASH_SEED, data, VM_MEMORY_PAGE_SIZE);
+    return page;
+}
+
+static void group_unref(VmClonePool* pool, VmCloneNode* group) {
+    if(!group || !node_unref(pool, group)) return;
+    for(size_t j = 0; j < CLONE_GROUP_PAGES; j++) node_unref(pool, group->pages[j]);
+}
+
+static byte* page_data(VM* vm, const size_t group, const size_t page) {
+    const size_t index = group * CLONE_GROUP_PAGES + page;
+    return index < MEMORY_PAGES ?
+               vm->memory + index * VM_MEMORY_PAGE_SIZE :
+               (byte*)vm->screen + (index - MEMORY_PAGES) * VM_MEMORY_PAGE_SIZE;
+}
+
+// a bit for each page of the group that changed since the last clone or restore
+static uint8_t group_dirty(VM* vm, const size_t group) {
+    return group < MEMORY_GROUPS ?
+               vm->clone_dirty_memory >> (group * CLONE_GROUP_PAGES) :
+               vm->clone_dirty_screen >> ((group - MEMORY_GROUPS) * CLONE_GROUP_PAGES);
+}
+
+static VmCloneNode* group_alloc(VmClonePool* pool, VM* vm, const size_t group) {
+    VmCloneNode* node = node_alloc(pool);
+    node->hash = 0;
+    for(size_t j = 0; j < CLONE_GROUP_PAGES; j++) {
+        node->pages[j] = page_alloc(pool, page_data(vm, group, j));
+        node->hash += node->pages[j]->hash * page_weight(group, j);
+    }
+    return node;
+}
+
+/* Brings a group of the VM up to date with the pages that changed. The group is
+ * changed in place if no clone shares it, else the VM gets a copy of its own. */
+static void group_update(VmClonePool* pool, VM* vm, const size_t group) {
+    VmCloneNode* node = vm->clone_groups[group];
+    if(!node) {
+        vm->clone_groups[group] = group_alloc(pool, vm, group);
+        return;
+    }
+    const uint8_t dirty = group_dirty(vm, group);
+    for(size_t j = 0; j < CLONE_GROUP_PAGES; j++) {
+        const byte* data = page_data(vm, group, j);
+        if(!((dirty >> j) & 1) ||
+           memcmp(node->pages[j]->data, data, VM_MEMORY_PAGE_SIZE) == 0) {
+            continue;
+        }
+        if(node->refs > 1) {
+            VmCloneNode* copy = node_alloc(pool);
+            copy->hash = node->hash;
+            for(size_t k = 0; k < CLONE_GROUP_PAGES; k++) {
+                copy->pages[k] = node_ref(node->pages[k]);
+            }
+            node_unref(pool, node);
+            vm->clone_groups[group] = node = copy;
+        }
+        VmCloneNode* page = page_alloc(pool, data);
+        node->hash += (page->hash - node->pages[j]->hash) * page_weight(group, j);
+        node_unref(pool, node->pages[j]);
+        node->pages[j] = page;
+    }
+}
+
+static void attach(VmClonePool* pool, VM* vm) {
+    if(vm->clone_pool == pool) return;
+    vm_clone_detach(vm);
+    vm->clone_pool = pool;
+}
+
+void vm_clone_detach(VM* vm) {
+    if(!vm->clone_pool) return;
+    for(size_t j = 0; j < CLONE_GROUPS; j++) {
+        group_unref(vm->clone_pool, vm->clone_groups[j]);
+        vm->clone_groups[j] = NULL;
+    }
+    vm->clone_pool = NULL;
+}
+
+VmClone* vm_clone(VmClonePool* pool, VM* vm) {
+    VmClone* clone = malloc(sizeof(VmClone) + vm->sp * sizeof(word));
+    clone->pool = pool;
+    attach(pool, vm);
+    uint64_t pages_hash = 0;
+    for(size_t j = 0; j < CLONE_GROUPS; j++) {
+        if(!vm->clone_groups[j] || group_dirty(vm, j)) group_update(pool, vm, j);
+        clone->groups[j] = node_ref(vm->clone_groups[j]);
+        pages_hash += clone->groups[j]->hash;
+    }
+    vm->clone_dirty_memory = 0;
+    vm->clone_dirty_screen = 0;
+
+    byte* core = clone->core;
+#define SAVE_FIELD(field)                        \
+    memcpy(core, &vm->field, sizeof(vm->field)); \
+    core += sizeof(vm->field);
+    CLONE_FIELDS(SAVE_FIELD)
+    CLONE_TIMING_FIELDS(SAVE_FIELD)
+#undef SAVE_FIELD
+    clone->sp = vm->sp;
+    memcpy(clone->stack, vm->stack, vm->sp * sizeof(word));
+
+    uint64_t hash = hash_bytes(HASH_SEED, clone->core, STATE_SIZE);
+    hash = hash_bytes(hash, clone->stack, clone->sp * sizeof(word));
+    clone->hash = (hash ^ pages_hash) * HASH_PRIME;
+    return clone;
+}
+
+void vm_clone_free(VmClone* clone) {
+    for(size_t j = 0; j < CLONE_GROUPS; j++) group_unref(clone->pool, clone->groups[j]);
+    free(clone);
+}
+
+/* Copies the pages in which the VM differs from the clone: those of another page
+ * or changed since. Groups the two share are skipped as a whole. */
+void vm_clone_restore(VmClone* clone, VM* vm) {
+    attach(clone->pool, vm);
+    bool is_memory_changed = false;
+    for(size_t j = 0; j < CLONE_GROUPS; j++) {
+        VmCloneNode* node = vm->clone_groups[j];
+        VmCloneNode* from = clone->groups[j];
+        const uint8_t dirty = group_dirty(vm, j);
+        if(node == from && !dirty) continue;
+        for(size_t k = 0; k < CLONE_GROUP_PAGES; k++) {
+            if(node && node->pages[k] == from->pages[k] && !((dirty >> k) & 1)) continue;
+            memcpy(page_data(vm, j, k), from->pages[k]->data, VM_MEMORY_PAGE_SIZE);
+            if(j < MEMORY_GROUPS) is_memory_changed = true;
+        }
+        group_unref(clone->pool, node);
+        vm->clone_groups[j] = node_ref(from);
+    }
+    if(is_memory_changed) vm_memory_replaced(vm);
+    vm->clone_dirty_memory = 0;
+    vm->clone_dirty_screen = 0;
+
+    const byte* core = clone->core;
+#define LOAD_FIELD(field)                        \
+    memcpy(&vm->field, core, sizeof(vm->field)); \
+    core += sizeof(vm->field);
+    CLONE_FIELDS(LOAD_FIELD)
+    CLONE_TIMING_FIELDS(LOAD_FIELD)
+#undef LOAD_FIELD
+    memcpy(vm->stack, clone->stack, clone->sp * sizeof(word));
+}
+
+uint64_t vm_clone_hash(const VmClone* clone) {
+    return clone->hash;
+}
+
+static bool pages_equal(const VmCloneNode* a, const VmCloneNode* b) {
+    return a == b ||
+           (a->hash == b->hash && memcmp(a->data, b->data, VM_MEMORY_PAGE_SIZE) == 0);
+}
+
+static bool groups_equal(VmCloneNode* const* a, VmCloneNode* const* b) {
+    for(size_t j = 0; j < CLONE_GROUPS; j++) {
+        if(a[j] == b[j]) continue;
+        if(a[j]->hash != b[j]->hash) return false;
+        for(size_t k = 0; k < CLONE_GROUP_PAGES; k++) {
+            if(!pages_equal(a[j]->pages[k], b[j]->pages[k])) return false;
+        }
+    }
+    return true;
+}
+
+bool vm_clone_equals(const VmClone* a, const VmClone* b) {
+    return a->hash == b->hash && a->sp == b->sp && memcmp(a->core, b->core, STATE_SIZE) == 0 &&
+           memcmp(a->stack, b->stack, a->sp * sizeof(word)) == 0 &&
+           groups_equal(a->groups, b->groups);
+}
+
+#endif
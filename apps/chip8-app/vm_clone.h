@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vm.h"
+
+/* Copy-on-write clones of a VM, for tree search and play-testing on the host.
+ * Only built with VM_FEATURE_CLONE, see vm_config.h.
+ *
+ * A clone keeps memory and screen in pages of VM_MEMORY_PAGE_SIZE bytes from a
+ * pool, in groups of CLONE_GROUP_PAGES. Pages and groups are reference counted
+ * and shared between clones, and with the VM a clone was taken from or restored
+ * to, for as long as no store or sprite changes them. Cloning a VM copies only
+ * the pages it changed since its last clone or restore, restoring a clone only
+ * the pages in which the VM differs from it; groups without such pages are
+ * skipped as a whole. Everything else of the VM, registers, stack and timing, is
+ * copied outright, it takes a few hundred bytes.
+ *
+ * The trade-off against copying the whole VM into a snapshot of its own: a clone
+ * takes some 140-310 bytes per distinct state against the 10 KB of a VM, while
+ * cloning and restoring take about as long as the two copies. Over 200000 steps
+ * of make search at -O2, clone and restore took 1.2-1.7 us together against 2.5
+ * us to copy to and from 4096 snapshots, and 0.15 us against 0.19 us when the
+ * same two states take turns and everything stays in the cache. */
+
+typedef struct VmClonePool VmClonePool;
+typedef struct VmClone VmClone;
+
+VmClonePool* vm_clone_pool_alloc();
+// the clones from the pool have to be freed, and the VMs detached, before
+void vm_clone_pool_free(VmClonePool* pool);
+// bytes in use by clones and VMs, for their pages and the tables of them
+size_t vm_clone_pool_get_size(VmClonePool* pool);
+
+VmClone* vm_clone(VmClonePool* pool, VM* vm);
+void vm_clone_free(VmClone* clone);
+// the VM goes on from the state of the clone, which stays as it is
+void vm_clone_restore(VmClone* clone, VM* vm);
+// releases the pages a VM shares with its clones, vm_free does so as well
+void vm_clone_detach(VM* vm);
+
+// Equal clones have the same program state: registers, stack, timers, keys,
+// memory and screen. When they were reached and at what speed does not count.
+// The hash is computed at vm_clone, it is equal for equal clones.
+uint64_t vm_clone_hash(const VmClone* clone);
+bool vm_clone_equals(const VmClone* a, const VmClone* b);
@@ -0,0 +1,47 @@
+#pragma once
+
+// Compile-time feature selection. Everything the VM allocates is sized from
+// these, override them with -D to trade features for RAM.
+
+// CHIP-8 is always available. SUPER-CHIP adds the 128x64 screen, scrolling
+// and the large font.
+#ifndef VM_FEATURE_SCHIP
+#define VM_FEATURE_SCHIP 1
+#endif
+
+// return addresses. The original interpreters offered 12 to 16 levels, but some
+// ROMs leave subroutines without returning (games/flightrunner.ch8 climbs past 50).
+// A word each: the VM spends 510 bytes on them, 16 levels would take 32
+#ifndef VM_STACK_DEPTH
+#define VM_STACK_DEPTH 0xFF
+#endif
+
+// sprites kept pre-shifted for DRW, see vm_draw_sprite. An entry takes 136
+// bytes; with 0 every sprite is shifted as it is drawn
+#ifndef VM_SPRITE_CACHE_ENTRIES
+#define VM_SPRITE_CACHE_ENTRIES 4
+#endif
+
+// per-address read, write and execute counters for the host tools, see
+// MemoryHeatmap. They take 48 KB
+#ifndef VM_MEMORY_HEATMAP
+#define VM_MEMORY_HEATMAP 0
+#endif
+
+// copy-on-write clones of a VM for search and play-testing on the host, see
+// vm_clone.h. Every store and sprite marks the pages it changes
+#ifndef VM_FEATURE_CLONE
+#define VM_FEATURE_CLONE 0
+#endif
+
+// the handlers of the instructions, see VM_OPCODES, callable from outside vm.c
+// for the code chip8-test/aot generates. Otherwise they stay static
+#ifndef VM_EXPORT_HANDLERS
+#define VM_EXPORT_HANDLERS 0
+#endif
+
+// a call graph of the subroutines with the cpu ticks and sprites spent in each,
+// for the host tools, see ProfileNode
+#ifndef VM_PROFILE_CALLS
+#define VM_PROFILE_CALLS 0
+#endif
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "opcodes.h"
+#include "perf.h"
+#include "vm.h"
+#include "vm_config.h"
+
+#define PROG_START 0x0200
+#define MEMORY_SIZE 0x1000
+#define STACK_SIZE VM_STACK_DEPTH
+#define TIMER_TICKS_PER_SEC 60
+#define MS_PER_CPU_TICK (1000 / VM_CPU_TICKS_PER_SEC)
+#define MS_PER_TIMER_TICK (1000 / TIMER_TICKS_PER_SEC)
+// auto-tuning of the instructions per second, see vm_set_frame_pacing
+#define TUNE_WINDOW_FRAMES TIMER_TICKS_PER_SEC
+// an instruction per frame
+#define TUNE_STEP_PER_SEC (1000 / MS_PER_TIMER_TICK)
+#define MIN_INSTRUCTIONS_PER_SEC (2 * TUNE_STEP_PER_SEC)
+// COSMAC VIP timing, see vm_set_vip_timing: the 3668 machine cycles of a 60 Hz
+// frame at 1.76 MHz, less the display DMA and its interrupt routine
+#define VIP_CYCLES_PER_FRAME 2600
+#define VIP_FETCH_CYCLES 40 // fetch and decode, paid by every instruction
+#define VIP_SPRITE_BYTE_CYCLES 46 // DRW, per byte of the sprite
+#define VIP_REGISTER_CYCLES 14 // LD [I], Vx and LD Vx, [I], per register
+
+#if VM_FEATURE_SCHIP
+#define MAX_SCREEN_WIDTH 128
+#define MAX_SCREEN_HEIGHT 64
+#else
+#define MAX_SCREEN_WIDTH 64
+#define MAX_SCREEN_HEIGHT 32
+#endif
+
+// the framebuffer is packed row by row, the leftmost pixel is the MSB of a word
+typedef uint32_t ScreenWord;
+#define SCREEN_WORD_BITS 32
+#define SCREEN_WORDS_PER_ROW (MAX_SCREEN_WIDTH / SCREEN_WORD_BITS)
+
+#define MAX_SPRITE_HEIGHT 16
+
+// copy-on-write pages of vm_clone, the framebuffer is paged by whole rows
+#define MEMORY_PAGES (MEMORY_SIZE / VM_MEMORY_PAGE_SIZE)
+#define SCREEN_ROWS_PER_PAGE (VM_MEMORY_PAGE_SIZE / (SCREEN_WORDS_PER_ROW * sizeof(ScreenWord)))
+#define SCREEN_PAGES (MAX_SCREEN_HEIGHT / SCREEN_ROWS_PER_PAGE)
+// the pages of memory and then screen in groups, which clones share as a whole
+#define CLONE_GROUP_PAGES 8
+#define CLONE_GROUPS ((MEMORY_PAGES + SCREEN_PAGES) / CLONE_GROUP_PAGES)
+
+/* A sprite as DRW reads it from I, each row shifted right by shift so it lines
+ * up with the two screen words it covers. */
+typedef struct {
+    word addr;
+    byte n; // the nibble of the DRW, 0 for a 16x16 sprite
+    byte shift; // x % SCREEN_WORD_BITS
+    uint32_t last_used; // 0 for a free entry
+    uint64_t rows[MAX_SPRITE_HEIGHT];
+} SpriteCacheEntry;
+
+#if VM_MEMORY_HEATMAP
+/* How often the program touched each address since vm_start. Reads are the
+ * sprites of DRW and LD Vx, [I], writes LD B, Vx and LD [I], Vx, executes the
+ * two bytes of every instruction run. Skipped idle loops are not counted. */
+typedef struct {
+    uint32_t reads[MEMORY_SIZE];
+    uint32_t writes[MEMORY_SIZE];
+    uint32_t executes[MEMORY_SIZE];
+} MemoryHeatmap;
+#endif
+
+#if VM_PROFILE_CALLS
+#define PROFILE_NODES 4096
+#define PROFILE_ROOT 0
+
+/* A subroutine in the context of its callers, the root is the program outside
+ * of any. CALL enters a child of the current node, RET returns to its parent.
+ * The cpu ticks since the last CALL or RET, instructions and idle or key waits,
+ * go to the node they were spent in; those of its children are not included. */
+typedef struct {
+    word addr;
+    uint16_t parent, first_child, next_sibling;
+    uint32_t calls;
+    uint64_t ticks;
+    uint32_t sprites, sprite_rows; // DRW and the rows it drew
+} ProfileNode;
+#endif
+
+typedef enum {
+    ModeChip8,
+    ModeSuperChip8,
+} Mode;
+
+typedef enum {
+    ScreenResolutionLow,
+    ScreenResolutionHigh,
+} ScreenResolution;
+
+// vm_clone copies the state field by field, new fields go into CLONE_FIELDS in vm_clone.c
+struct VirtualMachine {
+    byte memory[MEMORY_SIZE];
+    word pc, i;
+
+    byte v[0x10];
+
+    word stack[STACK_SIZE];
+    byte sp;
+
+    byte delay_timer, sound_timer;
+    uint32_t timestamp_init;
+    uint64_t cpu_ticks, timer_ticks;
+
+    bool is_game_over;
+
+    // frame pacing, instructions_per_sec is 0 for millisecond scheduling, and the
+    // thousandths of an instruction the frames so far were due but did not run
+    uint16_t instructions_per_sec, target_instructions_per_sec;
+    uint16_t frame_instruction_carry;
+    uint8_t max_catchup_frames;
+    bool is_auto_tuned;
+    uint32_t dropped_frames;
+    byte tune_frames, tune_dropped_frames;
+    // COSMAC VIP timing, cycles the last instruction ran into the next frame
+    bool is_vip_timing;
+    uint16_t vip_overrun_cycles;
+
+    // recent speeds for the performance overlay
+    PerfWindow cpu_window, frame_window;
+
+    bool is_key_pressed[0x10];
+    uint32_t key_observations; // see vm_get_key_observations
+
+    bool is_waiting_for_key;
+    byte waiting_for_key_index;
+
+    Mode mode;
+    uint32_t rng_state;
+
+    ScreenResolution screen_resolution;
+    int scroll_horizontal, scroll_vertical;
+    uint32_t screen_changes; // see vm_get_screen_changes
+    ScreenWord screen[MAX_SCREEN_HEIGHT][SCREEN_WORDS_PER_ROW];
+
+    // one bit per VM_MEMORY_PAGE_SIZE bytes, see vm_get_code_written_pages
+    uint64_t executed_pages, written_pages;
+
+#if VM_SPRITE_CACHE_ENTRIES > 0
+    // least recently used goes first, [start, end) is the memory the entries cover
+    SpriteCacheEntry sprite_cache[VM_SPRITE_CACHE_ENTRIES];
+    uint32_t sprite_cache_clock;
+    word sprite_cache_start, sprite_cache_end;
+#endif
+
+#if VM_FEATURE_CLONE
+    // the page groups memory and screen were last cloned to or restored from,
+    // and a bit for each page that changed since, see vm_clone.c
+    struct VmClonePool* clone_pool;
+    struct VmCloneNode* clone_groups[CLONE_GROUPS];
+    uint64_t clone_dirty_memory;
+    uint32_t clone_dirty_screen;
+#endif
+#if VM_MEMORY_HEATMAP
+    MemoryHeatmap heatmap;
+#endif
+#if VM_PROFILE_CALLS
+    // calls past a full table stay with their caller, profile_overflow_depth deep
+    ProfileNode profile_nodes[PROFILE_NODES];
+    uint16_t profile_size, profile_node, profile_overflow_depth;
+    uint64_t profile_ticks; // cpu_ticks when they were last added to a node
+#endif
+};
+
+/* Building blocks of the interpreter, shared with code translated ahead of time
+ * (see chip8-test/aot.c). Translated code must behave exactly like vm_execute. */
+
+bool vm_execute(VM* vm, word opcode);
+#if VM_EXPORT_HANDLERS
+#define VM_HANDLER
+#define VM_DECLARE_HANDLER(_, Name, handler, ...) bool handler(VM* vm, const word opcode);
+VM_OPCODES(VM_DECLARE_HANDLER, _)
+#undef VM_DECLARE_HANDLER
+#else
+#define VM_HANDLER static
+#endif
+bool vm_tick_cpu(VM* vm);
+void vm_tick_timers_until(VM* vm, const uint32_t timestamp);
+uint32_t vm_timestamp_cpu(VM* vm);
+void vm_handle_input(VM* vm);
+
+void vm_clear_display(VM* vm);
+void vm_draw_sprite(VM* vm, const byte x, const byte y, const byte n);
+// to be called after writing size bytes of memory from addr on
+void vm_memory_written(VM* vm, const word addr, const size_t size);
+// to be called after replacing memory outside of the program, as vm_clone_restore does
+void vm_memory_replaced(VM* vm);
+#if VM_PROFILE_CALLS
+// adds the cpu ticks since the last CALL or RET to the current node
+void vm_profile_flush(VM* vm);
+#endif
+bool vm_fetch_is_key_pressed(VM* vm, const byte key_id);
+byte vm_random_byte(VM* vm);
+void vf_reset(VM* vm);
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../chip8-app/analyzer.h"
+
+#define MAX_PROG_SIZE (0x1000 - 0x200)
+
+static const char* FEATURE_NAMES[] = {
+    "scroll", "hires",  "large-sprite",  "large-font", "flags",
+    "exit",   "computed-jump", "self-modifying", "key-wait",
+};
+
+static void print_features(const char* name, const uint32_t features) {
+  printf("%s:", name);
+  for (size_t j = 0; j < sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0]);
+       j++) {
+    if (features & (1 << j)) {
+      printf(" %s", FEATURE_NAMES[j]);
+    }
+  }
+  printf("%s\n", (features & ROM_FEATURES_SUPERCHIP) ? " (super-chip)" : "");
+}
+
+static void print_ranges(RomAnalysis* analysis,
+                         const char* name,
+                         const byte flag) {
+  printf("%s:", name);
+  for (size_t addr = 0; addr < ANALYZER_MEMORY_SIZE; addr++) {
+    if ((analysis->flags[addr] & flag) &&
+        (addr == 0 || !(analysis->flags[addr - 1] & flag))) {
+      size_t end = addr;
+      while (end < ANALYZER_MEMORY_SIZE && (analysis->flags[end] & flag)) {
+        end++;
+      }
+      printf(" %03zX-%03zX", addr, end - 1);
+    }
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s ROM\n", argv[0]);
+    return 1;
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (file == NULL) {
+    printf("could not read '%s'\n", argv[1]);
+    return 1;
+  }
+  byte prog[MAX_PROG_SIZE];
+  const size_t size = fread(prog, 1, MAX_PROG_SIZE, file);
+  fclose(file);
+
+  RomAnalysis* analysis = rom_analysis_alloc();
+  rom_analyze(analysis, prog, size);
+
+  printf("rom '%s', %zu bytes\n", argv[1], size);
+  print_features("features", analysis->features);
+  print_features("entry features", analysis->entry_features);
+  print_ranges(analysis, "code", AnalyzerByteCode | AnalyzerByteOperand);
+  print_ranges(analysis, "sprites", AnalyzerByteSprite);
+  print_ranges(analysis, "written", AnalyzerByteWritten);
+
+  printf("self-modifying stores:");
+  for (size_t j = 0; j < analysis->num_smc_stores; j++) {
+    printf(" %03X", analysis->smc_stores[j]);
+  }
+  printf("\n\nopcode census:\n");
+  for (Instruction j = 0; j < InstructionMAX; j++) {
+    if (analysis->census[j] > 0) {
+      const OpcodeInfo* info = opcode_get_info(j);
+      printf("  %-5s %-14s %-8s %u\n", info->mnemonic, info->operands,
+             opcode_get_class_name(info->opcode_class), analysis->census[j]);
+    }
+  }
+
+  printf("\ncontrol-flow graph, %zu blocks:\n", analysis->num_blocks);
+  for (size_t j = 0; j < analysis->num_blocks; j++) {
+    const BasicBlock* block = &analysis->blocks[j];
+    printf("  %03X-%03X ->", block->start, block->end - 1);
+    for (byte k = 0; k < block->num_successors; k++) {
+      printf(" %03X", block->successors[k]);
+    }
+    printf("%s\n", block->is_computed_jump ? " (computed)" : "");
+  }
+
+  rom_analysis_free(analysis);
+  return 0;
+}
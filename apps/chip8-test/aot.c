@@ -0,0 +1,229 @@
+// Translates a ROM ahead of time into C, one function per basic block.
+//
+//   ./aot ROM > rom_aot.c
+//
+// The generated aot_update() drives a VM exactly like vm_update() does. It
+// falls back to the interpreter wherever the translation does not apply:
+// jumps to addresses that start no known block (Bnnn targets, code found only
+// at run time) and blocks whose bytes no longer match the ROM.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../chip8-app/analyzer.h"
+
+#define PROG_START 0x200
+#define MAX_PROG_SIZE (0x1000 - PROG_START)
+
+static byte memory[ANALYZER_MEMORY_SIZE];
+static bool is_block_start[ANALYZER_MEMORY_SIZE];
+
+static word opcode_at(const word addr) {
+  return ((word)(memory[addr]) << 8) | memory[addr + 1];
+}
+
+static bool ends_block(const Instruction instruction) {
+  switch (instruction) {
+    case InstructionRet:
+    case InstructionJp:
+    case InstructionCall:
+    case InstructionSeByte:
+    case InstructionSneByte:
+    case InstructionSeReg:
+    case InstructionSneReg:
+    case InstructionSkp:
+    case InstructionSknp:
+    case InstructionJpV0:
+    case InstructionLdVxK:
+    case InstructionLdB:
+    case InstructionStore:
+    case InstructionInvalid:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// stores may rewrite the code that follows them
+static bool is_store(const Instruction instruction) {
+  return instruction == InstructionLdB || instruction == InstructionStore;
+}
+
+// instructions that touch the timers need the timers brought up to date
+static void emit_sync(FILE* out, unsigned* pending) {
+  if (*pending > 0) {
+    fprintf(out, "    vm->cpu_ticks += %u;\n", *pending);
+    *pending = 0;
+  }
+  fprintf(out, "    vm_tick_timers_until(vm, vm_timestamp_cpu(vm));\n");
+}
+
+// pc is NULL where the instruction has set it already
+static void emit_exit(FILE* out, unsigned* pending, const char* pc) {
+  if (*pending > 0) {
+    fprintf(out, "    vm->cpu_ticks += %u;\n", *pending);
+    *pending = 0;
+  }
+  if (pc != NULL) fprintf(out, "    vm->pc = %s;\n", pc);
+  fprintf(out, "    return AotDone;\n");
+}
+
+static const char* HANDLERS[InstructionMAX] = {
+#define HANDLER_NAME(_, Name, handler, ...) [Instruction##Name] = #handler,
+    VM_OPCODES(HANDLER_NAME, _)
+#undef HANDLER_NAME
+};
+
+// emits one instruction as a call to its handler in vm.c, returns true if it
+// ends the block
+static bool emit_instruction(FILE* out, const word addr, unsigned* pending) {
+  const word opcode = opcode_at(addr);
+  const Instruction instruction = opcode_decode(opcode);
+  char text[OPCODE_MAX_DISASSEMBLY];
+
+  opcode_disassemble(opcode, text, sizeof(text));
+  fprintf(out, "    // %03X: %04X %s\n", addr, opcode, text);
+
+  // a tick is accounted for before the instruction runs, like vm_tick_cpu
+  if (opcode_get_info(instruction)->opcode_class == OpcodeClassTimer) {
+    emit_sync(out, pending);
+  }
+  (*pending)++;
+
+  // jumps, calls and skips go on from the next instruction, as in vm_tick_cpu
+  const bool is_end = ends_block(instruction);
+  if (is_end) fprintf(out, "    vm->pc = 0x%03X;\n", addr + 2);
+  if (instruction == InstructionInvalid ||
+      opcode_get_info(instruction)->mode != OpcodeModeChip8) {
+    // the decoder knows whether the VM was built with these
+    fprintf(out, "    if(!vm_execute(vm, 0x%04X)) return AotError;\n", opcode);
+  } else {
+    fprintf(out, "    if(!%s(vm, 0x%04X)) return AotError;\n",
+            HANDLERS[instruction], opcode);
+  }
+  if (is_end) emit_exit(out, pending, NULL);
+  return is_end;
+}
+
+static word emit_block(FILE* out, const word start) {
+  fprintf(out, "static AotResult block_%03X(VM* vm) {\n", start);
+
+  word end = start;
+  while (end + 1 < ANALYZER_MEMORY_SIZE &&
+         (end == start || !is_block_start[end])) {
+    const Instruction instruction = opcode_decode(opcode_at(end));
+    end += 2;
+    if (ends_block(instruction)) {
+      break;
+    }
+  }
+
+  fprintf(out, "    static const byte code[] = {");
+  for (word addr = start; addr < end; addr++) {
+    fprintf(out, "%s0x%02X", addr > start ? ", " : "", memory[addr]);
+  }
+  fprintf(out,
+          "};\n"
+          "    if(memcmp(vm->memory + 0x%03X, code, sizeof(code)) != 0) "
+          "return AotMiss;\n\n",
+          start);
+
+  unsigned pending = 0;
+  for (word addr = start; addr < end; addr += 2) {
+    if (emit_instruction(out, addr, &pending)) {
+      fprintf(out, "}\n\n");
+      return end;
+    }
+  }
+  char text[16];
+  snprintf(text, sizeof(text), "0x%03X", end);
+  emit_exit(out, &pending, text);
+  fprintf(out, "}\n\n");
+  return end;
+}
+
+static const char* PROLOGUE =
+    "// generated by chip8-test/aot, do not edit\n"
+    "\n"
+    "#include <string.h>\n"
+    "\n"
+    "#include \"../chip8-app/vm_i.h\"\n"
+    "#include \"aot.h\"\n"
+    "\n"
+    "#if !VM_EXPORT_HANDLERS\n"
+    "#error \"build with -DVM_EXPORT_HANDLERS=1, see the Makefile\"\n"
+    "#endif\n"
+    "\n"
+    "typedef enum {\n"
+    "    AotDone,\n"
+    "    AotMiss,\n"
+    "    AotError,\n"
+    "} AotResult;\n"
+    "\n";
+
+static const char* EPILOGUE =
+    "bool aot_update(VM* vm, const uint32_t timestamp_world) {\n"
+    "    vm_handle_input(vm);\n"
+    "    while(!vm->is_game_over && vm_timestamp_cpu(vm) < timestamp_world) "
+    "{\n"
+    "        vm_tick_timers_until(vm, vm_timestamp_cpu(vm));\n"
+    "        const AotResult result = vm->is_waiting_for_key ? AotMiss : "
+    "dispatch(vm);\n"
+    "        if(result == AotError) return false;\n"
+    "        if(result == AotMiss && !vm_tick_cpu(vm)) return false;\n"
+    "    }\n"
+    "    vm_tick_timers_until(vm, timestamp_world);\n"
+    "    return true;\n"
+    "}\n";
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s ROM > OUTPUT.c\n", argv[0]);
+    return 1;
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (file == NULL) {
+    fprintf(stderr, "could not read '%s'\n", argv[1]);
+    return 1;
+  }
+  const size_t size = fread(memory + PROG_START, 1, MAX_PROG_SIZE, file);
+  fclose(file);
+
+  RomAnalysis* analysis = rom_analysis_alloc();
+  rom_analyze(analysis, memory + PROG_START, size);
+  for (size_t addr = 0; addr + 1 < ANALYZER_MEMORY_SIZE; addr++) {
+    const byte flags = analysis->flags[addr];
+    if (!(flags & AnalyzerByteCode)) {
+      continue;
+    }
+    if (flags & AnalyzerByteLeader) {
+      is_block_start[addr] = true;
+    }
+    const Instruction instruction = opcode_decode(opcode_at(addr));
+    if ((instruction == InstructionLdVxK || is_store(instruction)) &&
+        (analysis->flags[addr + 2] & AnalyzerByteCode)) {
+      is_block_start[addr + 2] = true;
+    }
+  }
+  rom_analysis_free(analysis);
+
+  FILE* out = stdout;
+  fprintf(out, "%s", PROLOGUE);
+  for (size_t addr = 0; addr < ANALYZER_MEMORY_SIZE; addr++) {
+    if (is_block_start[addr]) {
+      emit_block(out, addr);
+    }
+  }
+
+  fprintf(out, "static AotResult dispatch(VM* vm) {\n    switch(vm->pc) {\n");
+  for (size_t addr = 0; addr < ANALYZER_MEMORY_SIZE; addr++) {
+    if (is_block_start[addr]) {
+      fprintf(out, "    case 0x%03zX:\n        return block_%03zX(vm);\n", addr,
+              addr);
+    }
+  }
+  fprintf(out, "    default:\n        return AotMiss;\n    }\n}\n\n");
+  fprintf(out, "%s", EPILOGUE);
+  return 0;
+}
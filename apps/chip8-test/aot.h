@@ -0,0 +1,7 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../chip8-app/vm.h"
+
+// entry point of a ROM translated by aot, a drop-in for vm_update
+bool aot_update(VM* vm, const uint32_t timestamp_world);
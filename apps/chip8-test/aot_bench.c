@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../chip8-app/vm_i.h"
+#include "aot.h"
+
+// compares the interpreter with a ROM translated by aot, see `make aot-bench`
+
+#define STEP_MS 1000
+
+static double seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double run(VM* vm,
+                  bool (*update)(VM*, const uint32_t),
+                  const uint32_t duration_s) {
+  vm_start(vm, 0);
+  vm_set_seed(vm, 1);
+  const double start = seconds();
+  for (uint32_t s = 1; s <= duration_s; s++) {
+    if (!update(vm, s * STEP_MS)) {
+      printf("vm error at pc 0x%03X\n", vm->pc);
+      break;
+    }
+  }
+  return seconds() - start;
+}
+
+static bool is_same_state(VM* a, VM* b) {
+  return a->pc == b->pc && a->i == b->i && a->sp == b->sp &&
+         memcmp(a->v, b->v, sizeof(a->v)) == 0 &&
+         memcmp(a->stack, b->stack, sizeof(a->stack)) == 0 &&
+         a->delay_timer == b->delay_timer && a->sound_timer == b->sound_timer &&
+         memcmp(a->memory, b->memory, sizeof(a->memory)) == 0 &&
+         memcmp(a->screen, b->screen, sizeof(a->screen)) == 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s ROM [virtual seconds]\n", argv[0]);
+    return 1;
+  }
+  const uint32_t duration_s = argc > 2 ? strtoul(argv[2], NULL, 0) : 600;
+
+  VM* interpreted = vm_alloc();
+  VM* translated = vm_alloc();
+  FILE* file = fopen(argv[1], "rb");
+  if (file == NULL) {
+    printf("could not read '%s'\n", argv[1]);
+    return 1;
+  }
+  int c;
+  for (word addr = 0; (c = fgetc(file)) != EOF; addr++) {
+    vm_write_prog_to_memory(interpreted, addr, c);
+    vm_write_prog_to_memory(translated, addr, c);
+  }
+  fclose(file);
+
+  const double t_interpreted = run(interpreted, vm_update, duration_s);
+  const double t_translated = run(translated, aot_update, duration_s);
+  const uint64_t ticks = vm_get_cpu_ticks(interpreted);
+
+  // translated blocks run to completion and may overshoot by a few ticks
+  while (interpreted->cpu_ticks < translated->cpu_ticks) {
+    vm_tick_timers_until(interpreted, vm_timestamp_cpu(interpreted));
+    vm_tick_cpu(interpreted);
+  }
+  vm_tick_timers_until(interpreted, vm_timestamp_cpu(interpreted));
+  vm_tick_timers_until(translated, vm_timestamp_cpu(translated));
+
+  printf("interpreter: %.2f M instructions/s\n", ticks / t_interpreted * 1e-6);
+  printf("translated:  %.2f M instructions/s\n", ticks / t_translated * 1e-6);
+  printf("final states %s\n",
+         is_same_state(interpreted, translated) ? "match" : "DIFFER");
+
+  vm_free(interpreted);
+  vm_free(translated);
+  return 0;
+}
@@ -0,0 +1,259 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+
+#define CACHE_LINE 64
+#define CHUNK_SIZE 32  // instances per scheduling unit
+#define MAX_THREADS 64
+
+// Each worker owns a deque of chunk indices [head, tail). The owner takes
+// chunks from the head, thieves take them from the tail. Both ends are
+// packed into one word so a single CAS settles every race.
+typedef struct {
+  _Atomic uint64_t range;
+  char padding[CACHE_LINE - sizeof(uint64_t)];
+} Deque;
+
+typedef struct {
+  VmBatch* batch;
+  size_t id;
+} Worker;
+
+// The workers live as long as the batch. The caller of vm_batch_step_parallel
+// is worker 0, the threads wait for the generation to change, run the step
+// and count themselves off in num_running.
+struct VmBatch {
+  byte* arena;  // all instances, back to back
+  size_t stride;
+  size_t count;
+  bool* is_faulted;
+  uint32_t timestamp;
+
+  size_t num_workers;
+  Deque* deques;
+  Worker workers[MAX_THREADS];
+  pthread_t threads[MAX_THREADS - 1];
+  pthread_mutex_t mutex;
+  pthread_cond_t start, done;
+  uint64_t generation;
+  size_t num_running;
+  bool is_stopping;
+};
+
+static uint64_t pack(const uint32_t head, const uint32_t tail) {
+  return ((uint64_t)(tail) << 32) | head;
+}
+
+static uint32_t head_of(const uint64_t range) {
+  return range & 0xFFFFFFFF;
+}
+
+static uint32_t tail_of(const uint64_t range) {
+  return range >> 32;
+}
+
+static void* worker_main(void* context);
+
+VmBatch* vm_batch_alloc(const size_t count, const size_t num_threads) {
+  VmBatch* batch = malloc(sizeof(VmBatch));
+  batch->stride = (vm_get_size() + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  batch->count = count;
+  batch->arena = aligned_alloc(CACHE_LINE, batch->stride * count);
+  batch->is_faulted = calloc(count, sizeof(bool));
+  batch->timestamp = 0;
+
+  const size_t num_chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  size_t num_workers = num_threads < MAX_THREADS ? num_threads : MAX_THREADS;
+  num_workers = num_workers < num_chunks ? num_workers : num_chunks;
+  num_workers = num_workers > 0 ? num_workers : 1;
+  batch->deques = aligned_alloc(CACHE_LINE, num_workers * sizeof(Deque));
+  pthread_mutex_init(&batch->mutex, NULL);
+  pthread_cond_init(&batch->start, NULL);
+  pthread_cond_init(&batch->done, NULL);
+  batch->generation = 0;
+  batch->num_running = 0;
+  batch->is_stopping = false;
+  // a thread that cannot be created leaves its share to the others
+  batch->num_workers = 1;
+  for (size_t w = 0; w < num_workers; w++) {
+    batch->workers[w] = (Worker){.batch = batch, .id = w};
+  }
+  for (size_t w = 1; w < num_workers; w++) {
+    if (pthread_create(&batch->threads[w - 1], NULL, worker_main,
+                       &batch->workers[w]) != 0) {
+      break;
+    }
+    batch->num_workers++;
+  }
+  return batch;
+}
+
+void vm_batch_free(VmBatch* batch) {
+  pthread_mutex_lock(&batch->mutex);
+  batch->is_stopping = true;
+  pthread_cond_broadcast(&batch->start);
+  pthread_mutex_unlock(&batch->mutex);
+  for (size_t w = 1; w < batch->num_workers; w++) {
+    pthread_join(batch->threads[w - 1], NULL);
+  }
+  pthread_cond_destroy(&batch->done);
+  pthread_cond_destroy(&batch->start);
+  pthread_mutex_destroy(&batch->mutex);
+  free(batch->deques);
+  free(batch->is_faulted);
+  free(batch->arena);
+  free(batch);
+}
+
+size_t vm_batch_get_num_workers(VmBatch* batch) {
+  return batch->num_workers;
+}
+
+size_t vm_batch_get_count(VmBatch* batch) {
+  return batch->count;
+}
+
+VM* vm_batch_get(VmBatch* batch, const size_t index) {
+  return (VM*)(batch->arena + index * batch->stride);
+}
+
+bool vm_batch_is_faulted(VmBatch* batch, const size_t index) {
+  return batch->is_faulted[index];
+}
+
+void vm_batch_load(VmBatch* batch, const byte* prog, const size_t size) {
+  for (size_t j = 0; j < batch->count; j++) {
+    VM* vm = vm_batch_get(batch, j);
+    for (size_t addr = 0; addr < size; addr++) {
+      vm_write_prog_to_memory(vm, addr, prog[addr]);
+    }
+  }
+}
+
+void vm_batch_start(VmBatch* batch) {
+  batch->timestamp = 0;
+  for (size_t j = 0; j < batch->count; j++) {
+    VM* vm = vm_batch_get(batch, j);
+    vm_start(vm, batch->timestamp);
+    vm_set_seed(vm, j + 1);
+    batch->is_faulted[j] = false;
+  }
+}
+
+static void step_range(VmBatch* batch,
+                       const size_t begin,
+                       const size_t end,
+                       const uint32_t timestamp) {
+  for (size_t j = begin; j < end && j < batch->count; j++) {
+    if (!batch->is_faulted[j]) {
+      batch->is_faulted[j] = !vm_update(vm_batch_get(batch, j), timestamp);
+    }
+  }
+}
+
+static size_t count_faults(VmBatch* batch) {
+  size_t faults = 0;
+  for (size_t j = 0; j < batch->count; j++) {
+    faults += batch->is_faulted[j] ? 1 : 0;
+  }
+  return faults;
+}
+
+size_t vm_batch_step(VmBatch* batch, const uint32_t duration_ms) {
+  batch->timestamp += duration_ms;
+  step_range(batch, 0, batch->count, batch->timestamp);
+  return count_faults(batch);
+}
+
+static bool take_own(Deque* deque, uint32_t* chunk) {
+  uint64_t range = atomic_load(&deque->range);
+  while (head_of(range) < tail_of(range)) {
+    const uint64_t next = pack(head_of(range) + 1, tail_of(range));
+    if (atomic_compare_exchange_weak(&deque->range, &range, next)) {
+      *chunk = head_of(range);
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool steal(Deque* deque, uint32_t* chunk) {
+  uint64_t range = atomic_load(&deque->range);
+  while (head_of(range) < tail_of(range)) {
+    const uint64_t next = pack(head_of(range), tail_of(range) - 1);
+    if (atomic_compare_exchange_weak(&deque->range, &range, next)) {
+      *chunk = tail_of(range) - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+// one step: the own chunks first, then those of the others
+static void run_step(VmBatch* batch, const size_t id) {
+  uint32_t chunk;
+  for (;;) {
+    bool found = take_own(&batch->deques[id], &chunk);
+    for (size_t k = 1; !found && k < batch->num_workers; k++) {
+      const size_t victim = (id + k) % batch->num_workers;
+      found = steal(&batch->deques[victim], &chunk);
+    }
+    if (!found) return;
+    step_range(batch, chunk * CHUNK_SIZE, (chunk + 1) * CHUNK_SIZE,
+               batch->timestamp);
+  }
+}
+
+static void* worker_main(void* context) {
+  Worker* worker = context;
+  VmBatch* batch = worker->batch;
+  uint64_t generation = 0;
+  for (;;) {
+    pthread_mutex_lock(&batch->mutex);
+    while (batch->generation == generation && !batch->is_stopping) {
+      pthread_cond_wait(&batch->start, &batch->mutex);
+    }
+    generation = batch->generation;
+    const bool is_stopping = batch->is_stopping;
+    pthread_mutex_unlock(&batch->mutex);
+    if (is_stopping) return NULL;
+
+    run_step(batch, worker->id);
+
+    pthread_mutex_lock(&batch->mutex);
+    if (--batch->num_running == 0) pthread_cond_signal(&batch->done);
+    pthread_mutex_unlock(&batch->mutex);
+  }
+}
+
+size_t vm_batch_step_parallel(VmBatch* batch, const uint32_t duration_ms) {
+  if (batch->num_workers <= 1) {
+    return vm_batch_step(batch, duration_ms);
+  }
+
+  batch->timestamp += duration_ms;
+  const size_t num_chunks = (batch->count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  for (size_t w = 0; w < batch->num_workers; w++) {
+    const uint32_t head = w * num_chunks / batch->num_workers;
+    const uint32_t tail = (w + 1) * num_chunks / batch->num_workers;
+    atomic_store(&batch->deques[w].range, pack(head, tail));
+  }
+
+  pthread_mutex_lock(&batch->mutex);
+  batch->num_running = batch->num_workers - 1;
+  batch->generation++;
+  pthread_cond_broadcast(&batch->start);
+  pthread_mutex_unlock(&batch->mutex);
+
+  run_step(batch, 0);
+
+  pthread_mutex_lock(&batch->mutex);
+  while (batch->num_running > 0) {
+    pthread_cond_wait(&batch->done, &batch->mutex);
+  }
+  pthread_mutex_unlock(&batch->mutex);
+  return count_faults(batch);
+}
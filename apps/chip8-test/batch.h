@@ -0,0 +1,34 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../chip8-app/vm.h"
+
+typedef struct VmBatch VmBatch;
+
+// starts num_threads - 1 worker threads for vm_batch_step_parallel, at most
+// one per chunk of instances, which wait for steps until vm_batch_free
+VmBatch* vm_batch_alloc(const size_t count, const size_t num_threads);
+
+void vm_batch_free(VmBatch* batch);
+
+// the threads vm_batch_step_parallel runs on, the caller's included, fewer
+// than asked for if not all of them could be created
+size_t vm_batch_get_num_workers(VmBatch* batch);
+
+size_t vm_batch_get_count(VmBatch* batch);
+VM* vm_batch_get(VmBatch* batch, const size_t index);
+bool vm_batch_is_faulted(VmBatch* batch, const size_t index);
+
+// loads the same program into every instance
+void vm_batch_load(VmBatch* batch, const byte* prog, const size_t size);
+
+// starts every instance at the virtual time 0, instance j is seeded with j + 1
+void vm_batch_start(VmBatch* batch);
+
+// advances all instances by duration_ms of virtual time in lockstep,
+// returns the number of instances that faulted so far
+size_t vm_batch_step(VmBatch* batch, const uint32_t duration_ms);
+
+// same as vm_batch_step, spreading the instances across the workers
+size_t vm_batch_step_parallel(VmBatch* batch, const uint32_t duration_ms);
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "octo.h"
+
+#define MAX_PROG_SIZE (0x1000 - 0x200)
+#define STEP_MS 1000
+#define MAX_DEFINES 16
+
+static double seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// .8o sources are assembled with the NAME=VALUE arguments as constants,
+// which is how the templates in microbench/ are parameterized
+static size_t assemble_prog(const char* file_name,
+                            char** args,
+                            const int num_args,
+                            byte* prog) {
+  OctoDefine defines[MAX_DEFINES];
+  size_t num_defines = 0;
+  for (int j = 0; j < num_args && num_defines < MAX_DEFINES; j++) {
+    char* value = strchr(args[j], '=');
+    if (value != NULL) {
+      *value = '\0';
+      defines[num_defines++] =
+          (OctoDefine){.name = args[j], .value = strtol(value + 1, NULL, 0)};
+    }
+  }
+  OctoProgram* program = malloc(sizeof(OctoProgram));
+  size_t size = 0;
+  if (octo_assemble_file(file_name, defines, num_defines, program)) {
+    memcpy(prog, program->rom, program->size);
+    size = program->size;
+  } else {
+    printf("%s:%d: %s\n", file_name, program->error_line, program->error);
+  }
+  free(program);
+  return size;
+}
+
+static size_t read_prog(const char* file_name, byte* prog) {
+  FILE* file = fopen(file_name, "rb");
+  if (file == NULL) {
+    return 0;
+  }
+  const size_t size = fread(prog, 1, MAX_PROG_SIZE, file);
+  fclose(file);
+  return size;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s ROM [instances] [virtual seconds] [threads] "
+           "[NAME=VALUE]...\n",
+           argv[0]);
+    return 1;
+  }
+  const size_t instances = argc > 2 ? strtoul(argv[2], NULL, 0) : 1024;
+  const uint32_t duration_s = argc > 3 ? strtoul(argv[3], NULL, 0) : 10;
+  const size_t threads = argc > 4 ? strtoul(argv[4], NULL, 0) : 1;
+
+  byte prog[MAX_PROG_SIZE];
+  const size_t size =
+      octo_is_source(argv[1])
+          ? assemble_prog(argv[1], argv + 5, argc > 5 ? argc - 5 : 0, prog)
+          : read_prog(argv[1], prog);
+  if (size == 0) {
+    printf("could not read '%s'\n", argv[1]);
+    return 1;
+  }
+
+  printf("vm footprint: %zu bytes per instance\n", vm_get_size());
+
+  VmBatch* batch = vm_batch_alloc(instances, threads);
+  const size_t workers = vm_batch_get_num_workers(batch);
+  vm_batch_load(batch, prog, size);
+  vm_batch_start(batch);
+
+  const double start = seconds();
+  size_t faults = 0;
+  for (uint32_t s = 0; s < duration_s; s++) {
+    faults = vm_batch_step_parallel(batch, STEP_MS);
+  }
+  const double elapsed = seconds() - start;
+
+  uint64_t ticks = 0;
+  for (size_t j = 0; j < instances; j++) {
+    ticks += vm_get_cpu_ticks(vm_batch_get(batch, j));
+  }
+  vm_batch_free(batch);
+
+  printf("%zu instances x %u s on %zu threads: %.3f s wall, %zu faulted\n",
+         instances, duration_s, workers, elapsed, faults);
+  printf("%.2f M instructions/s total, %.2f M instructions/s per thread\n",
+         ticks / elapsed * 1e-6, ticks / elapsed * 1e-6 / workers);
+  return 0;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../chip8-app/vm_i.h"
+#include "debugger.h"
+#include "harness.h"
+
+#define MAX_LINE 256
+#define DEFAULT_MAX_INSTRUCTIONS 1000000
+
+// addresses are hex, counts decimal
+static const char* HELP =
+    "b ADDR          toggle a breakpoint\n"
+    "w ADDR [LEN]    stop on stores into LEN bytes at ADDR, w alone clears\n"
+    "r [REG]...      stop when one of the registers V0-VF or I changes\n"
+    "s [N]           step N instructions\n"
+    "n               step, running a CALL until it returns\n"
+    "c [N]           continue, for at most N instructions\n"
+    "d [ADDR] [N]    disassemble N instructions\n"
+    "x ADDR [N]      dump N bytes of memory\n"
+    "p               print the registers\n"
+    "k KEYS          press the keys of a hex bitfield, k 0 releases them\n"
+    "screen          print the screen\n"
+    "q               quit\n";
+
+static void print_instruction(VM* vm, const word address, Debugger* debugger) {
+  const word opcode =
+      vm->memory[address % MEMORY_SIZE] << 8 |
+      vm->memory[(address + 1) % MEMORY_SIZE];
+  char text[OPCODE_MAX_DISASSEMBLY];
+  opcode_disassemble(opcode, text, sizeof(text));
+  printf("%c%c %03X  %04X  %s\n", address == vm->pc ? '>' : ' ',
+         debugger_is_breakpoint(debugger, address) ? '*' : ' ', address,
+         opcode, text);
+}
+
+static void print_registers(VM* vm) {
+  printf("pc=%03X i=%03X sp=%u dt=%u st=%u ticks=%llu\n", vm->pc, vm->i,
+         vm->sp, vm->delay_timer, vm->sound_timer,
+         (unsigned long long)vm->cpu_ticks);
+  for (int j = 0; j < 0x10; j++) {
+    printf("V%X=%02X%c", j, vm->v[j], j % 8 == 7 ? '\n' : ' ');
+  }
+}
+
+static void print_screen(VM* vm) {
+  for (int y = 0; y < vm_get_screen_height(vm); y++) {
+    for (int x = 0; x < vm_get_screen_width(vm); x++) {
+      putchar(vm_get_pixel(vm, x, y) ? '#' : '.');
+    }
+    putchar('\n');
+  }
+}
+
+static void print_stop(Debugger* debugger) {
+  VM* vm = debugger->vm;
+  printf("%s", debugger_get_stop_name(debugger->stop));
+  switch (debugger->stop) {
+    case DebugStopMemoryWatch:
+      printf(": %03X stored to %03X", debugger->stop_pc,
+             debugger->stop_address);
+      break;
+    case DebugStopRegisterWatch:
+      printf(": %03X changed", debugger->stop_pc);
+      for (int j = 0; j < 0x10; j++) {
+        if (debugger->stop_registers & (1 << j)) printf(" V%X", j);
+      }
+      if (debugger->stop_registers & DEBUGGER_REGISTER_I) printf(" I");
+      break;
+    case DebugStopError:
+      printf(" at %03X", debugger->stop_pc);
+      break;
+    default:
+      break;
+  }
+  printf("\n");
+  print_registers(vm);
+  print_instruction(vm, vm->pc, debugger);
+}
+
+static uint32_t parse_registers(char* arguments) {
+  uint32_t registers = 0;
+  for (char* name = strtok(arguments, " \t\n"); name != NULL;
+       name = strtok(NULL, " \t\n")) {
+    if (strcmp(name, "I") == 0 || strcmp(name, "i") == 0) {
+      registers |= DEBUGGER_REGISTER_I;
+    } else if ((name[0] == 'V' || name[0] == 'v') && name[1] != '\0') {
+      registers |= 1 << (strtol(name + 1, NULL, 16) & 0x0F);
+    } else {
+      printf("unknown register '%s'\n", name);
+    }
+  }
+  return registers;
+}
+
+static bool run_command(Debugger* debugger, char* line) {
+  VM* vm = debugger->vm;
+  char command[16] = "";
+  int consumed = 0;
+  if (sscanf(line, "%15s%n", command, &consumed) != 1) return true;
+  char* arguments = line + consumed;
+  unsigned long a = 0, b = 0;
+  const int num_arguments = sscanf(arguments, "%lx %lu", &a, &b);
+
+  if (strcmp(command, "q") == 0) {
+    return false;
+  } else if (strcmp(command, "b") == 0 && num_arguments >= 1) {
+    const bool is_set = !debugger_is_breakpoint(debugger, a);
+    debugger_set_breakpoint(debugger, a, is_set);
+    printf("breakpoint at %03lX %s\n", a, is_set ? "set" : "cleared");
+  } else if (strcmp(command, "w") == 0) {
+    if (num_arguments < 1) {
+      debugger_clear_watches(debugger);
+      printf("memory watches cleared\n");
+    } else if (debugger_add_watch(debugger, a, a + (num_arguments > 1 ? b : 1))) {
+      printf("watching %03lX-%03lX\n", a, a + (num_arguments > 1 ? b : 1) - 1);
+    } else {
+      printf("too many watches\n");
+    }
+  } else if (strcmp(command, "r") == 0) {
+    debugger_watch_registers(debugger, parse_registers(arguments));
+  } else if (strcmp(command, "s") == 0) {
+    const unsigned long steps = num_arguments >= 1 ? strtoul(arguments, NULL, 10) : 1;
+    for (unsigned long j = 0; j < steps; j++) {
+      if (debugger_step(debugger) != DebugStopStep) break;
+    }
+    print_stop(debugger);
+  } else if (strcmp(command, "n") == 0) {
+    debugger_step_over(debugger, DEFAULT_MAX_INSTRUCTIONS);
+    print_stop(debugger);
+  } else if (strcmp(command, "c") == 0) {
+    debugger_continue(debugger, num_arguments >= 1 ? strtoul(arguments, NULL, 10)
+                                                   : DEFAULT_MAX_INSTRUCTIONS);
+    print_stop(debugger);
+  } else if (strcmp(command, "d") == 0) {
+    const word address = num_arguments >= 1 ? a : vm->pc;
+    const unsigned long count = num_arguments >= 2 ? b : 8;
+    for (unsigned long j = 0; j < count; j++) {
+      print_instruction(vm, address + 2 * j, debugger);
+    }
+  } else if (strcmp(command, "x") == 0 && num_arguments >= 1) {
+    const unsigned long count = num_arguments >= 2 ? b : 16;
+    for (unsigned long j = 0; j < count; j++) {
+      if (j % 16 == 0) printf("%s%03lX:", j > 0 ? "\n" : "", a + j);
+      printf(" %02X", vm->memory[(a + j) % MEMORY_SIZE]);
+    }
+    printf("\n");
+  } else if (strcmp(command, "p") == 0) {
+    print_registers(vm);
+  } else if (strcmp(command, "k") == 0 && num_arguments >= 1) {
+    vm_set_keys(vm, a);
+  } else if (strcmp(command, "screen") == 0) {
+    print_screen(vm);
+  } else {
+    printf("%s", HELP);
+  }
+  return true;
+}
+
+// usage: debug ROM, reads commands from stdin, see HELP
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    printf("usage: %s ROM\n%s", argv[0], HELP);
+    return 1;
+  }
+
+  VM* vm = vm_alloc();
+  memset(vm, 0, vm_get_size());
+  if (!harness_load(vm, argv[1])) {
+    vm_free(vm);
+    return 1;
+  }
+  vm_start(vm, 0);
+  vm_set_seed(vm, 1);
+
+  Debugger* debugger = malloc(sizeof(Debugger));
+  debugger_init(debugger, vm);
+  print_registers(vm);
+  print_instruction(vm, vm->pc, debugger);
+
+  char line[MAX_LINE];
+  printf("(debug) ");
+  fflush(stdout);
+  while (fgets(line, sizeof(line), stdin) != NULL && run_command(debugger, line)) {
+    printf("(debug) ");
+    fflush(stdout);
+  }
+
+  free(debugger);
+  vm_free(vm);
+  return 0;
+}
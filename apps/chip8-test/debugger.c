@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../chip8-app/vm_i.h"
+#include "debugger.h"
+
+_Static_assert(DEBUGGER_MEMORY_SIZE == MEMORY_SIZE,
+               "debugger and vm disagree on memory size");
+
+static const char* STOP_NAMES[] = {
+    [DebugStopStep] = "step",
+    [DebugStopBreakpoint] = "breakpoint",
+    [DebugStopMemoryWatch] = "memory watch",
+    [DebugStopRegisterWatch] = "register watch",
+    [DebugStopError] = "error",
+    [DebugStopGameOver] = "game over",
+    [DebugStopLimit] = "instruction limit",
+};
+
+void debugger_init(Debugger* debugger, VM* vm) {
+  memset(debugger, 0, sizeof(Debugger));
+  debugger->vm = vm;
+}
+
+void debugger_set_breakpoint(Debugger* debugger,
+                             const word address,
+                             const bool is_set) {
+  const word index = address % MEMORY_SIZE;
+  if (is_set) {
+    debugger->breakpoints[index / 8] |= 1 << (index % 8);
+  } else {
+    debugger->breakpoints[index / 8] &= ~(1 << (index % 8));
+  }
+}
+
+bool debugger_is_breakpoint(Debugger* debugger, const word address) {
+  const word index = address % MEMORY_SIZE;
+  return debugger->breakpoints[index / 8] & (1 << (index % 8));
+}
+
+bool debugger_add_watch(Debugger* debugger, const word start, const word end) {
+  if (debugger->num_watches == DEBUGGER_MAX_WATCHES) return false;
+  debugger->watches[debugger->num_watches++] = (DebugRange){start, end};
+  return true;
+}
+
+void debugger_clear_watches(Debugger* debugger) {
+  debugger->num_watches = 0;
+}
+
+void debugger_watch_registers(Debugger* debugger, const uint32_t registers) {
+  debugger->watched_registers = registers;
+}
+
+static word peek(VM* vm, const word address) {
+  return vm->memory[address % MEMORY_SIZE] << 8 |
+         vm->memory[(address + 1) % MEMORY_SIZE];
+}
+
+// the memory an instruction stores to, empty for all but LD B and LD [I]
+static DebugRange get_stores(VM* vm, const word opcode) {
+  const word i = vm->i;
+  switch (opcode_decode(opcode)) {
+    case InstructionLdB:
+      return (DebugRange){i, i + 3};
+    case InstructionStore:
+      return (DebugRange){i, i + opcode_x(opcode) + 1};
+    default:
+      return (DebugRange){0, 0};
+  }
+}
+
+static uint32_t get_changed_registers(VM* vm, const byte* v, const word i) {
+  uint32_t changed = vm->i != i ? DEBUGGER_REGISTER_I : 0;
+  for (int j = 0; j < 0x10; j++) {
+    if (vm->v[j] != v[j]) changed |= 1 << j;
+  }
+  return changed;
+}
+
+/* One instruction as handle_scheduling in vm.c runs it: the timer ticks due
+ * first, then the instruction, without skipping idle loops. */
+static DebugStop tick(Debugger* debugger) {
+  VM* vm = debugger->vm;
+  vm_handle_input(vm);
+  vm_tick_timers_until(vm, vm_timestamp_cpu(vm));
+  debugger->stop_pc = vm->pc;
+  if (vm->is_waiting_for_key) {
+    vm_tick_cpu(vm);
+    return DebugStopStep;
+  }
+
+  const word opcode = peek(vm, vm->pc);
+  const DebugRange stores = get_stores(vm, opcode);
+  byte v[0x10];
+  memcpy(v, vm->v, sizeof(v));
+  const word i = vm->i;
+
+  if (!vm_tick_cpu(vm)) return DebugStopError;
+
+  for (size_t j = 0; j < debugger->num_watches; j++) {
+    const DebugRange* watch = &debugger->watches[j];
+    if (stores.start < watch->end && watch->start < stores.end) {
+      debugger->stop_address =
+          stores.start > watch->start ? stores.start : watch->start;
+      return DebugStopMemoryWatch;
+    }
+  }
+  debugger->stop_registers =
+      get_changed_registers(vm, v, i) & debugger->watched_registers;
+  if (debugger->stop_registers != 0) return DebugStopRegisterWatch;
+  return vm->is_game_over ? DebugStopGameOver : DebugStopStep;
+}
+
+/* Runs until something stops it, or with is_returning until the subroutine at
+ * stack depth return_sp returns to return_pc. */
+static DebugStop run(Debugger* debugger,
+                     const uint64_t max_instructions,
+                     const bool is_returning,
+                     const word return_pc,
+                     const byte return_sp) {
+  VM* vm = debugger->vm;
+  for (uint64_t n = 0; n < max_instructions; n++) {
+    if (n > 0 && debugger_is_breakpoint(debugger, vm->pc) &&
+        !vm->is_waiting_for_key) {
+      debugger->stop_pc = vm->pc;
+      return debugger->stop = DebugStopBreakpoint;
+    }
+    const DebugStop stop = tick(debugger);
+    if (stop != DebugStopStep) return debugger->stop = stop;
+    if (is_returning && vm->pc == return_pc && vm->sp == return_sp) {
+      return debugger->stop = DebugStopStep;
+    }
+  }
+  return debugger->stop = DebugStopLimit;
+}
+
+DebugStop debugger_step(Debugger* debugger) {
+  return debugger->stop = tick(debugger);
+}
+
+DebugStop debugger_step_over(Debugger* debugger,
+                             const uint64_t max_instructions) {
+  VM* vm = debugger->vm;
+  if (vm->is_waiting_for_key ||
+      opcode_decode(peek(vm, vm->pc)) != InstructionCall) {
+    return debugger_step(debugger);
+  }
+  return run(debugger, max_instructions, true, vm->pc + 2, vm->sp);
+}
+
+DebugStop debugger_continue(Debugger* debugger,
+                            const uint64_t max_instructions) {
+  return run(debugger, max_instructions, false, 0, 0);
+}
+
+const char* debugger_get_stop_name(const DebugStop stop) {
+  return STOP_NAMES[stop];
+}
@@ -0,0 +1,69 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../chip8-app/vm.h"
+
+// A debug engine for the VM. It runs the program itself, one instruction at a
+// time with the timer ticks the millisecond scheduler of vm_update would put in
+// between, so vm_update pays nothing for breakpoints and watchpoints.
+
+#define DEBUGGER_MEMORY_SIZE 0x1000
+#define DEBUGGER_MAX_WATCHES 8
+// register watches, bit j is Vj
+#define DEBUGGER_REGISTER_I (1 << 16)
+
+typedef enum {
+  DebugStopStep,
+  DebugStopBreakpoint,
+  DebugStopMemoryWatch,
+  DebugStopRegisterWatch,
+  DebugStopError,  // vm_execute failed on the instruction at stop_pc
+  DebugStopGameOver,
+  DebugStopLimit,  // ran the maximum number of instructions
+} DebugStop;
+
+typedef struct {
+  word start, end;  // [start, end)
+} DebugRange;
+
+typedef struct {
+  VM* vm;
+  uint8_t breakpoints[DEBUGGER_MEMORY_SIZE / 8];  // one bit per address
+  DebugRange watches[DEBUGGER_MAX_WATCHES];       // stores into these stop
+  size_t num_watches;
+  uint32_t watched_registers;  // changes of these stop
+
+  // why and where the last run stopped
+  DebugStop stop;
+  word stop_pc;       // address of the last instruction run
+  word stop_address;  // first watched address stored to
+  uint32_t stop_registers;  // watched registers that changed
+} Debugger;
+
+void debugger_init(Debugger* debugger, VM* vm);
+
+void debugger_set_breakpoint(Debugger* debugger,
+                             const word address,
+                             const bool is_set);
+bool debugger_is_breakpoint(Debugger* debugger, const word address);
+
+// stops after any store into [start, end), returns false if there are too many
+bool debugger_add_watch(Debugger* debugger, const word start, const word end);
+void debugger_clear_watches(Debugger* debugger);
+
+// registers is a mask of Vj bits and DEBUGGER_REGISTER_I
+void debugger_watch_registers(Debugger* debugger, const uint32_t registers);
+
+DebugStop debugger_step(Debugger* debugger);
+
+// like debugger_step, but a CALL runs until the subroutine returns
+DebugStop debugger_step_over(Debugger* debugger,
+                             const uint64_t max_instructions);
+
+// runs until a breakpoint, a watchpoint, an error or max_instructions, the
+// breakpoint at the current address does not stop it again
+DebugStop debugger_continue(Debugger* debugger,
+                            const uint64_t max_instructions);
+
+const char* debugger_get_stop_name(const DebugStop stop);
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../chip8-app/vm_i.h"
+#include "harness.h"
+#include "octo.h"
+
+bool harness_read_rom(const char* file_name, byte* rom, const size_t max_size,
+                      size_t* size) {
+  if (octo_is_source(file_name)) {
+    OctoProgram* program = malloc(sizeof(OctoProgram));
+    bool is_read = octo_assemble_file(file_name, NULL, 0, program);
+    if (!is_read) {
+      printf("%s:%d: %s\n", file_name, program->error_line, program->error);
+    } else if (program->size > max_size) {
+      printf("'%s' assembles to %zu bytes, more than %zu\n", file_name,
+             program->size, max_size);
+      is_read = false;
+    } else {
+      memcpy(rom, program->rom, program->size);
+      *size = program->size;
+    }
+    free(program);
+    return is_read;
+  }
+
+  FILE* file = fopen(file_name, "rb");
+  if (file == NULL) {
+    printf("could not read '%s'\n", file_name);
+    return false;
+  }
+  *size = fread(rom, 1, max_size, file);
+  const bool is_larger = fgetc(file) != EOF;
+  fclose(file);
+  if (is_larger) printf("'%s' holds more than %zu bytes\n", file_name, max_size);
+  return !is_larger;
+}
+
+bool harness_load(VM* vm, const char* file_name) {
+  byte prog[MEMORY_SIZE - PROG_START];
+  size_t size;
+  if (!harness_read_rom(file_name, prog, sizeof(prog), &size)) return false;
+  for (word addr = 0; addr < size; addr++) {
+    vm_write_prog_to_memory(vm, addr, prog[addr]);
+  }
+  return true;
+}
+
+void harness_presses_init(HarnessPresses* presses) {
+  presses->state = 0x2545F491;
+  presses->release = 0;
+  harness_presses_next(presses);
+}
+
+void harness_presses_next(HarnessPresses* presses) {
+  uint32_t state = presses->state;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  presses->state = state;
+  presses->press = presses->release + 100 + state % 900;
+  presses->keys = 1 << (state >> 8) % 0x10;
+  presses->release = presses->press + 50 + (state >> 16) % 250;
+}
+
+uint32_t harness_run(VM* vm, const uint32_t duration_ms) {
+  HarnessPresses presses;
+  harness_presses_init(&presses);
+  for (uint32_t t = 1; t <= duration_ms && !vm_is_game_over(vm); t++) {
+    if (t == presses.press) {
+      vm_set_keys(vm, presses.keys);
+    } else if (t == presses.release) {
+      vm_set_keys(vm, 0);
+      harness_presses_next(&presses);
+    }
+    if (!vm_update(vm, t)) return t;
+  }
+  return 0;
+}
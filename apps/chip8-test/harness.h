@@ -0,0 +1,35 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../chip8-app/vm.h"
+
+// What the host tools share: reading a ROM, which is either a binary or Octo
+// source, into a buffer or the program memory of a VM, and pressing random
+// keys while it runs.
+
+// reads at most max_size bytes, prints what went wrong and returns false if
+// the file could not be read or assembled or holds more
+bool harness_read_rom(const char* file_name, byte* rom, const size_t max_size,
+                      size_t* size);
+
+// loads the ROM into the program memory, see harness_read_rom
+bool harness_load(VM* vm, const char* file_name);
+
+// Random key presses, the same ones on every run: nothing for 100-1000 ms,
+// then a key held for 50-300 ms, and so on.
+typedef struct {
+  uint32_t state;
+  uint32_t press, release;  // ms, of the current press
+  word keys;
+} HarnessPresses;
+
+// the first press
+void harness_presses_init(HarnessPresses* presses);
+
+// moves on to the press after the current one
+void harness_presses_next(HarnessPresses* presses);
+
+// runs the VM with random presses a millisecond at a time for duration_ms or
+// until the game is over, returns the time of an invalid instruction or 0
+uint32_t harness_run(VM* vm, const uint32_t duration_ms);
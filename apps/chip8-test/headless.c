@@ -0,0 +1,215 @@
+// Runs the whole app, chip8_app from chip8.c, against the host stand-in of the
+// Flipper SDK in sdk/, with SD_DIR as /ext and the input read from SCRIPT.
+//
+//   make headless && ./headless SD_DIR SCRIPT
+//
+// The script has one command per line, `MILLISECONDS COMMAND [ARGUMENT]`, the
+// time counted from the start of the app:
+//
+//   press KEY    a short press: Press, Short, Release
+//   long KEY     a long press: Press, Long, Release
+//   hold KEY     Press only, until a release
+//   release KEY  Release
+//   screen       prints the display
+//   save FILE    writes the display as a PBM image
+//   quit         presses Back until the app exits
+//
+// KEY is up, down, left, right, ok or back. Lines starting with # are comments.
+// At the exit the lock statistics of every thread are printed: how often it
+// took a mutex, how often it had to wait for another thread, and how long.
+// The app is built with its latency probes, the report of the last game is
+// printed as well.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <furi.h>
+#include <furi_hal.h>
+#include <gui/gui.h>
+#include <storage/storage.h>
+
+#define MAX_LINE 256
+#define QUIT_TIMEOUT_MS 5000
+#define QUIT_RETRY_MS 200
+
+int32_t chip8_app();
+
+static int32_t app_thread_callback(void* context) {
+  UNUSED(context);
+  return chip8_app();
+}
+
+static bool parse_key(const char* name, InputKey* key) {
+  for (InputKey k = 0; k < InputKeyMAX; k++) {
+    if (strcasecmp(name, input_get_key_name(k)) == 0) {
+      *key = k;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void send(Gui* gui, InputKey key, InputType type) {
+  static uint32_t sequence = 0;
+  const InputEvent event = {.sequence = ++sequence, .key = key, .type = type};
+  gui_host_send_input(gui, &event);
+}
+
+static void print_screen(Gui* gui, uint32_t timestamp) {
+  static uint8_t frame[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH];
+  const uint32_t frames = gui_host_get_frame(gui, frame);
+  printf("screen at %u ms, frame %u\n", timestamp, frames);
+  for (int y = 0; y < GUI_DISPLAY_HEIGHT; y++) {
+    char line[GUI_DISPLAY_WIDTH + 1];
+    for (int x = 0; x < GUI_DISPLAY_WIDTH; x++) line[x] = frame[y][x] ? '#' : '.';
+    line[GUI_DISPLAY_WIDTH] = '\0';
+    printf("%s\n", line);
+  }
+}
+
+static bool save_screen(Gui* gui, const char* path) {
+  static uint8_t frame[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH];
+  gui_host_get_frame(gui, frame);
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+  fprintf(file, "P1\n%d %d\n", GUI_DISPLAY_WIDTH, GUI_DISPLAY_HEIGHT);
+  for (int y = 0; y < GUI_DISPLAY_HEIGHT; y++) {
+    for (int x = 0; x < GUI_DISPLAY_WIDTH; x++) fputc(frame[y][x] ? '1' : '0', file);
+    fputc('\n', file);
+  }
+  return fclose(file) == 0;
+}
+
+static bool is_running(FuriThread* thread) {
+  return furi_thread_get_state(thread) != FuriThreadStateStopped;
+}
+
+// returns false on a malformed line
+static bool run_command(Gui* gui, uint32_t timestamp, const char* command,
+                        const char* argument, bool* is_quit) {
+  InputKey key;
+  if (strcmp(command, "press") == 0 && parse_key(argument, &key)) {
+    send(gui, key, InputTypePress);
+    send(gui, key, InputTypeShort);
+    send(gui, key, InputTypeRelease);
+  } else if (strcmp(command, "long") == 0 && parse_key(argument, &key)) {
+    send(gui, key, InputTypePress);
+    send(gui, key, InputTypeLong);
+    send(gui, key, InputTypeRelease);
+  } else if (strcmp(command, "hold") == 0 && parse_key(argument, &key)) {
+    send(gui, key, InputTypePress);
+  } else if (strcmp(command, "release") == 0 && parse_key(argument, &key)) {
+    send(gui, key, InputTypeRelease);
+  } else if (strcmp(command, "screen") == 0) {
+    print_screen(gui, timestamp);
+  } else if (strcmp(command, "save") == 0 && argument[0] != '\0') {
+    if (!save_screen(gui, argument)) {
+      fprintf(stderr, "Unable to write %s\n", argument);
+    }
+  } else if (strcmp(command, "quit") == 0) {
+    *is_quit = true;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void run_script(Gui* gui, FILE* script, FuriThread* app_thread) {
+  char line[MAX_LINE];
+  bool is_quit = false;
+  for (int line_number = 1; !is_quit && fgets(line, sizeof(line), script);
+       line_number++) {
+    unsigned timestamp;
+    char command[16] = "", argument[MAX_LINE] = "";
+    if (line[0] == '#' || line[0] == '\n') continue;
+    if (sscanf(line, "%u %15s %255s", &timestamp, command, argument) < 2) {
+      fprintf(stderr, "line %d: expected MILLISECONDS COMMAND\n", line_number);
+      continue;
+    }
+    while (furi_get_tick() < timestamp && is_running(app_thread)) furi_delay_ms(1);
+    if (!is_running(app_thread)) {
+      fprintf(stderr, "line %d: the app has already exited\n", line_number);
+      return;
+    }
+    if (!run_command(gui, timestamp, command, argument, &is_quit)) {
+      fprintf(stderr, "line %d: unknown command '%s %s'\n", line_number, command,
+              argument);
+    }
+  }
+}
+
+static void print_lock_stats(const char* name, const FuriHostLockStats* stats,
+                             void* context) {
+  UNUSED(context);
+  printf("%-16s %10u %10u %12.3f %12.3f\n", name, stats->acquired,
+         stats->contended, stats->wait_us / 1000.0, stats->max_wait_us / 1000.0);
+}
+
+// the report game_end left in SD_DIR, if a game ran
+static void print_latency(const char* sd_dir) {
+  char path[MAX_LINE];
+  snprintf(path, sizeof(path), "%s/chip8/chip8.latency", sd_dir);
+  FILE* file = fopen(path, "r");
+  if (!file) return;
+  printf("latency of the last game:\n");
+  char line[MAX_LINE];
+  while (fgets(line, sizeof(line), file)) fputs(line, stdout);
+  fclose(file);
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s SD_DIR SCRIPT\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  FILE* script = fopen(argv[2], "r");
+  if (!script) {
+    fprintf(stderr, "Unable to read %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  Storage* storage = storage_host_alloc(argv[1]);
+  furi_record_create(RECORD_STORAGE, storage);
+  Gui* gui = gui_host_alloc();
+  furi_record_create(RECORD_GUI, gui);
+
+  FuriThread* app_thread = furi_thread_alloc_ex("app", 4096, app_thread_callback, NULL);
+  furi_thread_start(app_thread);
+  run_script(gui, script, app_thread);
+  fclose(script);
+
+  // Back leaves the game for the library and the library for the desktop
+  for (uint32_t start = furi_get_tick(); is_running(app_thread);
+       furi_delay_ms(QUIT_RETRY_MS)) {
+    if (furi_get_tick() - start > QUIT_TIMEOUT_MS) {
+      fprintf(stderr, "The app did not exit within %d ms\n", QUIT_TIMEOUT_MS);
+      return EXIT_FAILURE;
+    }
+    send(gui, InputKeyBack, InputTypePress);
+    send(gui, InputKeyBack, InputTypeShort);
+    send(gui, InputKeyBack, InputTypeRelease);
+  }
+  furi_thread_join(app_thread);
+  const int32_t return_code = furi_thread_get_return_code(app_thread);
+  furi_thread_free(app_thread);
+
+  uint8_t frame[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH];
+  const uint32_t frames = gui_host_get_frame(gui, frame);
+  printf("app returned %d after %u ms, %u frames drawn\n", return_code,
+         furi_get_tick(), frames);
+
+  printf("%-16s %10s %10s %12s %12s\n", "thread", "locks", "contended",
+         "wait ms", "max wait ms");
+  furi_host_for_each_thread(print_lock_stats, NULL);
+
+  FuriHalHostSpeakerStats speaker;
+  furi_hal_speaker_host_get_stats(&speaker);
+  printf("speaker: %u starts, on for %u ms\n", speaker.starts, speaker.on_ms);
+  print_latency(argv[1]);
+
+  gui_host_free(gui);
+  storage_host_free(storage);
+  return return_code == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+// Runs a ROM with random key presses and reports how it used memory: the
+// pages it wrote to and ran code from, and per address how often it was read,
+// written and executed.
+//
+//   make heatmap && ./heatmap ROM [SECONDS [IMAGE]]
+//
+// The report lists every address that was touched. IMAGE, if given, is a PPM
+// with a cell per address, 64 addresses to a row: red for writes, green for
+// reads, blue for executes, brighter for more, on a log scale.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../chip8-app/vm_i.h"
+#include "harness.h"
+
+#if !VM_MEMORY_HEATMAP
+#error "build with -DVM_MEMORY_HEATMAP=1, see the Makefile"
+#endif
+
+#define DEFAULT_SECONDS 60
+#define IMAGE_COLUMNS 64
+#define IMAGE_CELL 8 // pixels per address
+
+static void print_pages(const char* name, const uint64_t pages) {
+  printf("%-13s", name);
+  if (pages == 0) printf(" none");
+  for (size_t page = 0; page < 64; page++) {
+    if (pages & ((uint64_t)1 << page)) {
+      printf(" %03zX", page * VM_MEMORY_PAGE_SIZE);
+    }
+  }
+  printf("\n");
+}
+
+static uint32_t max_count(const uint32_t* counters) {
+  uint32_t max = 0;
+  for (size_t addr = 0; addr < MEMORY_SIZE; addr++) {
+    if (counters[addr] > max) max = counters[addr];
+  }
+  return max;
+}
+
+// 0 for untouched, then 64 to 255 by the log of the count
+static byte brightness(const uint32_t count, const uint32_t max) {
+  if (count == 0) return 0;
+  if (max <= 1) return 255;
+  return 64 + (byte)(191 * log((double)count) / log((double)max));
+}
+
+static bool save_image(const MemoryHeatmap* heatmap, const char* file_name) {
+  FILE* file = fopen(file_name, "wb");
+  if (file == NULL) return false;
+  const uint32_t max_writes = max_count(heatmap->writes);
+  const uint32_t max_reads = max_count(heatmap->reads);
+  const uint32_t max_executes = max_count(heatmap->executes);
+  const size_t rows = MEMORY_SIZE / IMAGE_COLUMNS;
+  fprintf(file, "P6\n%d %zu\n255\n", IMAGE_COLUMNS * IMAGE_CELL,
+          rows * IMAGE_CELL);
+  for (size_t y = 0; y < rows * IMAGE_CELL; y++) {
+    for (size_t x = 0; x < IMAGE_COLUMNS * IMAGE_CELL; x++) {
+      const size_t addr = y / IMAGE_CELL * IMAGE_COLUMNS + x / IMAGE_CELL;
+      fputc(brightness(heatmap->writes[addr], max_writes), file);
+      fputc(brightness(heatmap->reads[addr], max_reads), file);
+      fputc(brightness(heatmap->executes[addr], max_executes), file);
+    }
+  }
+  return fclose(file) == 0;
+}
+
+// the addresses that were both written and run as code
+static void print_self_modified(const MemoryHeatmap* heatmap) {
+  size_t count = 0;
+  for (size_t addr = 0; addr < MEMORY_SIZE; addr++) {
+    if (heatmap->writes[addr] && heatmap->executes[addr]) {
+      printf("%s %03zX", count++ == 0 ? "self-modifying:" : "", addr);
+    }
+  }
+  printf("%s\n", count == 0 ? "no address both written and executed" : "");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s ROM [SECONDS [IMAGE]]\n", argv[0]);
+    return 1;
+  }
+  const uint32_t duration_ms =
+      (argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_SECONDS) * 1000;
+
+  VM* vm = vm_alloc();
+  memset(vm, 0, vm_get_size());
+  if (!harness_load(vm, argv[1])) return 1;
+  vm_start(vm, 0);
+  vm_set_seed(vm, 1);
+  const uint32_t error_ms = harness_run(vm, duration_ms);
+  if (error_ms != 0) {
+    printf("invalid instruction at %03X after %u ms\n", vm->pc, error_ms);
+  }
+
+  // the pages only narrow it down, a page may hold both code and data
+  print_pages("written", vm_get_written_pages(vm));
+  print_pages("code written", vm_get_code_written_pages(vm));
+  const MemoryHeatmap* heatmap = &vm->heatmap;
+  print_self_modified(heatmap);
+
+  printf("\naddr %10s %10s %10s\n", "executes", "reads", "writes");
+  for (size_t addr = 0; addr < MEMORY_SIZE; addr++) {
+    if (heatmap->executes[addr] || heatmap->reads[addr] ||
+        heatmap->writes[addr]) {
+      printf("%03zX  %10u %10u %10u\n", addr, heatmap->executes[addr],
+             heatmap->reads[addr], heatmap->writes[addr]);
+    }
+  }
+
+  if (argc > 3 && !save_image(heatmap, argv[3])) {
+    printf("could not write '%s'\n", argv[3]);
+    return 1;
+  }
+  vm_free(vm);
+  return 0;
+}
@@ -0,0 +1,322 @@
+// Runs an engine in lockstep with the reference interpreter and stops at the
+// first state in which they differ.
+//
+//   make lockstep && ./lockstep ROM [ENGINE [SECONDS [STEP_MS [INPUTS]]]]
+//   make lockstep-aot ROM=... && ./lockstep ROM aot
+//
+// The reference runs one instruction at a time, vm_tick_cpu with the timer ticks
+// due before it, and never skips anything. Its sprite cache is emptied before
+// every instruction, so each DRW shifts the sprite afresh from memory and a
+// stale entry in the engine's cache shows up as a difference. The engine under
+// test runs through its update function, which has the signature of vm_update,
+// for STEP_MS of virtual time at a time (default 1: every block or idle skip on
+// its own). After each step the reference catches up to the same number of cpu
+// ticks and the two machines are compared: registers, I, PC, stack, timers,
+// mode, memory and the framebuffer.
+//
+// Both get the same input: the key bitfields of INPUTS, lines of
+// `MILLISECONDS KEYS` with the keys in hex, or without it random presses from
+// a fixed seed. Keys are only ever changed between steps.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../chip8-app/vm_i.h"
+#include "harness.h"
+#ifdef LOCKSTEP_AOT
+#include "aot.h"
+#endif
+
+#define DEFAULT_SECONDS 60
+#define DEFAULT_STEP_MS 1
+#define MAX_INPUTS 4096
+#define HISTORY_SIZE 16
+#define MAX_ERROR_CATCHUP 0x800
+
+typedef struct {
+  const char* name;
+  const char* description;
+  bool (*update)(VM* vm, const uint32_t timestamp_world);
+} Engine;
+
+static const Engine ENGINES[] = {
+    {"update", "vm_update, skipping idle loops", vm_update},
+#ifdef LOCKSTEP_AOT
+    {"aot", "the ROM translated by aot", aot_update},
+#endif
+};
+
+#define NUM_ENGINES (sizeof(ENGINES) / sizeof(ENGINES[0]))
+
+typedef struct {
+  uint32_t timestamp;
+  word keys;
+} Input;
+
+// the last instructions the reference ran, for the report
+typedef struct {
+  word pc[HISTORY_SIZE];
+  word opcode[HISTORY_SIZE];
+  uint64_t count;
+} History;
+
+static size_t read_inputs(const char* file_name, Input* inputs) {
+  FILE* file = fopen(file_name, "r");
+  if (file == NULL) {
+    printf("could not read '%s'\n", file_name);
+    exit(1);
+  }
+  size_t count = 0;
+  unsigned long timestamp, keys;
+  while (count < MAX_INPUTS &&
+         fscanf(file, "%lu %lx", &timestamp, &keys) == 2) {
+    inputs[count++] = (Input){timestamp, keys};
+  }
+  fclose(file);
+  return count;
+}
+
+// the presses of HarnessPresses as key bitfields
+static size_t random_inputs(const uint32_t duration_ms, Input* inputs) {
+  size_t count = 0;
+  HarnessPresses presses;
+  for (harness_presses_init(&presses);
+       presses.press < duration_ms && count + 1 < MAX_INPUTS;
+       harness_presses_next(&presses)) {
+    inputs[count++] = (Input){presses.press, presses.keys};
+    inputs[count++] = (Input){presses.release, 0};
+  }
+  return count;
+}
+
+static word peek(VM* vm, const word address) {
+  return vm->memory[address % MEMORY_SIZE] << 8 |
+         vm->memory[(address + 1) % MEMORY_SIZE];
+}
+
+// the reference: one instruction with the timer ticks due before it, drawing
+// without the sprite cache
+static bool tick_reference(VM* vm, History* history) {
+  vm_tick_timers_until(vm, vm_timestamp_cpu(vm));
+  vm_memory_replaced(vm);
+  const size_t slot = history->count++ % HISTORY_SIZE;
+  history->pc[slot] = vm->pc;
+  history->opcode[slot] = vm->is_waiting_for_key ? 0 : peek(vm, vm->pc);
+  return vm_tick_cpu(vm);
+}
+
+static uint32_t hash_screen(VM* vm) {
+  const byte* bytes = (const byte*)vm->screen;
+  uint32_t hash = 2166136261u;
+  for (size_t j = 0; j < sizeof(vm->screen); j++) {
+    hash = (hash ^ bytes[j]) * 16777619u;
+  }
+  return hash;
+}
+
+static bool is_same_state(VM* a, VM* b) {
+  return a->pc == b->pc && a->i == b->i && a->sp == b->sp &&
+         memcmp(a->v, b->v, sizeof(a->v)) == 0 &&
+         memcmp(a->stack, b->stack, a->sp * sizeof(word)) == 0 &&
+         a->delay_timer == b->delay_timer &&
+         a->sound_timer == b->sound_timer &&
+         a->is_waiting_for_key == b->is_waiting_for_key &&
+         a->is_game_over == b->is_game_over && a->mode == b->mode &&
+         a->screen_resolution == b->screen_resolution &&
+         a->scroll_horizontal == b->scroll_horizontal &&
+         a->scroll_vertical == b->scroll_vertical &&
+         memcmp(a->memory, b->memory, sizeof(a->memory)) == 0 &&
+         hash_screen(a) == hash_screen(b);
+}
+
+static void print_field(const char* name, const long a, const long b) {
+  if (a != b) printf("  %-18s %8lX %8lX\n", name, a, b);
+}
+
+static void print_diff(VM* reference, VM* engine, const char* engine_name) {
+  printf("  %-18s %8s %8s\n", "", "reference", engine_name);
+  print_field("pc", reference->pc, engine->pc);
+  print_field("i", reference->i, engine->i);
+  print_field("sp", reference->sp, engine->sp);
+  char name[32];
+  for (int j = 0; j < 0x10; j++) {
+    snprintf(name, sizeof(name), "V%X", j);
+    print_field(name, reference->v[j], engine->v[j]);
+  }
+  const byte depth = reference->sp < engine->sp ? reference->sp : engine->sp;
+  for (byte j = 0; j < depth; j++) {
+    snprintf(name, sizeof(name), "stack[%u]", j);
+    print_field(name, reference->stack[j], engine->stack[j]);
+  }
+  print_field("delay timer", reference->delay_timer, engine->delay_timer);
+  print_field("sound timer", reference->sound_timer, engine->sound_timer);
+  print_field("waiting for key", reference->is_waiting_for_key,
+              engine->is_waiting_for_key);
+  print_field("game over", reference->is_game_over, engine->is_game_over);
+  print_field("mode", reference->mode, engine->mode);
+  print_field("resolution", reference->screen_resolution,
+              engine->screen_resolution);
+  print_field("scroll x", reference->scroll_horizontal,
+              engine->scroll_horizontal);
+  print_field("scroll y", reference->scroll_vertical, engine->scroll_vertical);
+
+  size_t num_bytes = 0;
+  for (word addr = 0; addr < MEMORY_SIZE; addr++) {
+    if (reference->memory[addr] == engine->memory[addr]) continue;
+    if (num_bytes++ < 8) {
+      snprintf(name, sizeof(name), "memory[%03X]", addr);
+      print_field(name, reference->memory[addr], engine->memory[addr]);
+    }
+  }
+  if (num_bytes > 8) printf("  ... %zu bytes of memory differ\n", num_bytes);
+
+  size_t num_pixels = 0;
+  int first_x = 0, first_y = 0;
+  for (int y = 0; y < vm_get_screen_height(reference); y++) {
+    for (int x = 0; x < vm_get_screen_width(reference); x++) {
+      if (vm_get_pixel(reference, x, y) == vm_get_pixel(engine, x, y)) continue;
+      if (num_pixels++ == 0) {
+        first_x = x;
+        first_y = y;
+      }
+    }
+  }
+  print_field("screen hash", hash_screen(reference), hash_screen(engine));
+  if (num_pixels > 0) {
+    printf("  %zu pixels differ, the first at %d,%d\n", num_pixels, first_x,
+           first_y);
+  }
+}
+
+static void print_history(History* history) {
+  const uint64_t first =
+      history->count > HISTORY_SIZE ? history->count - HISTORY_SIZE : 0;
+  printf("last instructions of the reference:\n");
+  for (uint64_t n = first; n < history->count; n++) {
+    const size_t slot = n % HISTORY_SIZE;
+    char text[OPCODE_MAX_DISASSEMBLY] = "(waiting for a key)";
+    if (history->opcode[slot] != 0) {
+      opcode_disassemble(history->opcode[slot], text, sizeof(text));
+    }
+    printf("  %03X  %04X  %s\n", history->pc[slot], history->opcode[slot], text);
+  }
+}
+
+static const Engine* find_engine(const char* name) {
+  for (size_t j = 0; j < NUM_ENGINES; j++) {
+    if (strcmp(ENGINES[j].name, name) == 0) return &ENGINES[j];
+  }
+  return NULL;
+}
+
+static void print_usage(const char* program) {
+  printf("usage: %s ROM [ENGINE [SECONDS [STEP_MS [INPUTS]]]]\nengines:\n",
+         program);
+  for (size_t j = 0; j < NUM_ENGINES; j++) {
+    printf("  %-8s %s\n", ENGINES[j].name, ENGINES[j].description);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  const Engine* engine = find_engine(argc > 2 ? argv[2] : ENGINES[0].name);
+  if (engine == NULL) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  const uint32_t duration_ms =
+      (argc > 3 ? strtoul(argv[3], NULL, 0) : DEFAULT_SECONDS) * 1000;
+  const uint32_t step_ms = argc > 4 ? strtoul(argv[4], NULL, 0) : DEFAULT_STEP_MS;
+
+  Input* inputs = malloc(MAX_INPUTS * sizeof(Input));
+  const size_t num_inputs = argc > 5 ? read_inputs(argv[5], inputs)
+                                     : random_inputs(duration_ms, inputs);
+
+  VM* reference = vm_alloc();
+  VM* tested = vm_alloc();
+  memset(reference, 0, vm_get_size());
+  memset(tested, 0, vm_get_size());
+  if (!harness_load(reference, argv[1]) || !harness_load(tested, argv[1])) return 1;
+  vm_start(reference, 0);
+  vm_start(tested, 0);
+  vm_set_seed(reference, 1);
+  vm_set_seed(tested, 1);
+
+  History history = {0};
+  size_t next_input = 0;
+  uint64_t steps = 0;
+  int status = 0;
+  const char* ending = "";
+  while (vm_timestamp_cpu(tested) < duration_ms && !tested->is_game_over) {
+    const uint32_t timestamp = vm_timestamp_cpu(tested);
+    while (next_input < num_inputs && inputs[next_input].timestamp <= timestamp) {
+      vm_set_keys(reference, inputs[next_input].keys);
+      vm_set_keys(tested, inputs[next_input].keys);
+      next_input++;
+    }
+
+    // the update functions handle input once, before they run anything
+    vm_handle_input(reference);
+    const bool is_tested_ok = engine->update(tested, timestamp + step_ms);
+    bool is_reference_ok = true;
+    while (is_reference_ok && reference->cpu_ticks < tested->cpu_ticks &&
+           !reference->is_game_over) {
+      is_reference_ok = tick_reference(reference, &history);
+    }
+    // an engine may fail in the middle of a block without counting its ticks
+    for (uint32_t n = 0; !is_tested_ok && n < MAX_ERROR_CATCHUP; n++) {
+      if (!is_reference_ok || reference->is_game_over) break;
+      is_reference_ok = tick_reference(reference, &history);
+    }
+    steps++;
+
+    if (!is_tested_ok || !is_reference_ok) {
+      if (is_tested_ok == is_reference_ok && is_same_state(reference, tested)) {
+        ending = ", both stopped with an error";
+      } else {
+        printf("%s failed at %.3f s: reference %s, %s %s\n",
+               is_tested_ok ? "reference" : engine->name,
+               vm_timestamp_cpu(reference) / 1000.0,
+               is_reference_ok ? "ok" : "error", engine->name,
+               is_tested_ok ? "ok" : "error");
+        print_diff(reference, tested, engine->name);
+        print_history(&history);
+        status = 1;
+      }
+      break;
+    }
+
+    // timer ticks due up to the next instruction, both would run them first
+    vm_tick_timers_until(reference, vm_timestamp_cpu(reference));
+    vm_tick_timers_until(tested, vm_timestamp_cpu(tested));
+    if (reference->is_game_over) ending = ", game over";
+    if (reference->cpu_ticks != tested->cpu_ticks ||
+        !is_same_state(reference, tested)) {
+      printf("divergence after %llu instructions (%.3f s, step %llu)\n",
+             (unsigned long long)reference->cpu_ticks,
+             vm_timestamp_cpu(reference) / 1000.0, (unsigned long long)steps);
+      print_field("cpu ticks", reference->cpu_ticks, tested->cpu_ticks);
+      print_diff(reference, tested, engine->name);
+      print_history(&history);
+      status = 1;
+      break;
+    }
+  }
+
+  if (status == 0) {
+    printf("%s matches the reference: %llu instructions in %llu steps, "
+           "%.3f s%s at pc %03X\n",
+           engine->name, (unsigned long long)reference->cpu_ticks,
+           (unsigned long long)steps, vm_timestamp_cpu(reference) / 1000.0,
+           ending, reference->pc);
+  }
+
+  free(inputs);
+  vm_free(reference);
+  vm_free(tested);
+  return status;
+}
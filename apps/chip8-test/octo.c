@@ -0,0 +1,1058 @@
+#include <ctype.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "octo.h"
+
+#define MAX_FRAMES 64
+#define MAX_MACRO_ARGS 16
+#define MAX_CONTROL_DEPTH 64
+#define COMPARE_TEMP 0xF
+
+typedef struct {
+  char* text;
+  int line;
+  bool is_string;
+} Token;
+
+typedef struct {
+  Token* items;
+  size_t count;
+  size_t capacity;
+} TokenList;
+
+typedef struct {
+  TokenList* list;
+  size_t pos;
+  bool is_owned;
+} Frame;
+
+typedef enum {
+  SymbolLabel,
+  SymbolConst,
+  SymbolAlias,
+} SymbolKind;
+
+typedef struct {
+  char* name;
+  SymbolKind kind;
+  int value;
+  bool is_predefined;  // wins over a :const of the same name
+} Symbol;
+
+typedef struct {
+  char* name;
+  char* params[MAX_MACRO_ARGS];
+  size_t num_params;
+  TokenList body;
+  char* alphabet;  // stringmodes only
+} Macro;
+
+typedef enum {
+  FixupAddress,  // low 12 bits of an instruction
+  FixupUnpack,   // the two immediates of :unpack
+  FixupPointer,  // two bytes
+} FixupKind;
+
+typedef struct {
+  char* label;
+  FixupKind kind;
+  int addr;
+  int line;
+} Fixup;
+
+typedef enum {
+  ControlLoop,
+  ControlWhile,
+  ControlIf,
+} ControlKind;
+
+typedef struct {
+  ControlKind kind;
+  int addr;
+} Control;
+
+typedef struct {
+  OctoProgram* program;
+  jmp_buf on_error;
+  int line;
+
+  TokenList source;
+  Frame frames[MAX_FRAMES];
+  size_t num_frames;
+
+  Symbol* symbols;
+  size_t num_symbols;
+  Macro* macros;
+  size_t num_macros;
+  Fixup* fixups;
+  size_t num_fixups;
+  Control control[MAX_CONTROL_DEPTH];
+  size_t num_control;
+
+  int here;
+  bool has_main_jump;
+} Assembler;
+
+static void fail(Assembler* as, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(as->program->error, OCTO_MAX_ERROR, format, args);
+  va_end(args);
+  as->program->error_line = as->line;
+  longjmp(as->on_error, 1);
+}
+
+static char* copy_string(const char* text, const size_t len) {
+  char* copy = malloc(len + 1);
+  memcpy(copy, text, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+static void push_token(TokenList* list, const Token token) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? 2 * list->capacity : 256;
+    list->items = realloc(list->items, list->capacity * sizeof(Token));
+  }
+  list->items[list->count++] = token;
+}
+
+static void free_tokens(TokenList* list) {
+  for (size_t j = 0; j < list->count; j++) {
+    free(list->items[j].text);
+  }
+  free(list->items);
+  *list = (TokenList){0};
+}
+
+static void tokenize(Assembler* as, const char* source) {
+  int line = 1;
+  const char* c = source;
+  while (*c != '\0') {
+    if (*c == '\n') {
+      line++;
+      c++;
+    } else if (isspace((unsigned char)*c)) {
+      c++;
+    } else if (*c == '#') {
+      while (*c != '\0' && *c != '\n') {
+        c++;
+      }
+    } else if (*c == '"') {
+      const char* begin = ++c;
+      while (*c != '\0' && *c != '"') {
+        c++;
+      }
+      if (*c != '"') {
+        as->line = line;
+        fail(as, "unterminated string");
+      }
+      push_token(&as->source, (Token){copy_string(begin, c - begin), line, true});
+      c++;
+    } else {
+      const char* begin = c;
+      while (*c != '\0' && !isspace((unsigned char)*c)) {
+        c++;
+      }
+      push_token(&as->source, (Token){copy_string(begin, c - begin), line, false});
+    }
+  }
+}
+
+// token stream
+
+static void push_frame(Assembler* as, TokenList* list, const bool is_owned) {
+  if (as->num_frames == MAX_FRAMES) {
+    fail(as, "macros nested too deeply");
+  }
+  as->frames[as->num_frames++] = (Frame){list, 0, is_owned};
+}
+
+static Token* peek_token(Assembler* as) {
+  while (as->num_frames > 0) {
+    Frame* frame = &as->frames[as->num_frames - 1];
+    if (frame->pos < frame->list->count) {
+      return &frame->list->items[frame->pos];
+    }
+    if (frame->is_owned) {
+      free_tokens(frame->list);
+      free(frame->list);
+    }
+    as->num_frames--;
+  }
+  return NULL;
+}
+
+static bool at_end(Assembler* as) {
+  return peek_token(as) == NULL;
+}
+
+static const char* peek(Assembler* as) {
+  Token* token = peek_token(as);
+  return token ? token->text : "";
+}
+
+static Token* next_token(Assembler* as) {
+  Token* token = peek_token(as);
+  if (token == NULL) {
+    fail(as, "unexpected end of file");
+  }
+  as->frames[as->num_frames - 1].pos++;
+  as->line = token->line;
+  return token;
+}
+
+static const char* next(Assembler* as) {
+  return next_token(as)->text;
+}
+
+static void expect(Assembler* as, const char* text) {
+  const char* token = next(as);
+  if (strcmp(token, text) != 0) {
+    fail(as, "expected '%s', found '%s'", text, token);
+  }
+}
+
+// symbols
+
+static Symbol* find_symbol(Assembler* as, const char* name) {
+  for (size_t j = 0; j < as->num_symbols; j++) {
+    if (strcmp(as->symbols[j].name, name) == 0) {
+      return &as->symbols[j];
+    }
+  }
+  return NULL;
+}
+
+static void define_symbol(Assembler* as,
+                          const char* name,
+                          const SymbolKind kind,
+                          const int value) {
+  Symbol* symbol = find_symbol(as, name);
+  if (symbol != NULL && symbol->kind == SymbolLabel && kind == SymbolLabel) {
+    fail(as, "label '%s' defined twice", name);
+  }
+  if (symbol != NULL && symbol->is_predefined && kind == SymbolConst) {
+    return;
+  }
+  if (symbol == NULL) {
+    as->symbols =
+        realloc(as->symbols, (as->num_symbols + 1) * sizeof(Symbol));
+    symbol = &as->symbols[as->num_symbols++];
+    symbol->name = copy_string(name, strlen(name));
+    symbol->is_predefined = false;
+  }
+  symbol->kind = kind;
+  symbol->value = value;
+}
+
+static Macro* find_macro(Assembler* as, const char* name) {
+  for (size_t j = 0; j < as->num_macros; j++) {
+    if (strcmp(as->macros[j].name, name) == 0) {
+      return &as->macros[j];
+    }
+  }
+  return NULL;
+}
+
+static bool parse_number(const char* text, int* value) {
+  const bool negative = (text[0] == '-');
+  const char* digits = negative ? text + 1 : text;
+  char* end;
+  long parsed;
+  if (strncmp(digits, "0b", 2) == 0) {
+    parsed = strtol(digits + 2, &end, 2);
+  } else if (strncmp(digits, "0x", 2) == 0) {
+    parsed = strtol(digits + 2, &end, 16);
+  } else {
+    parsed = strtol(digits, &end, 10);
+  }
+  if (*digits == '\0' || *end != '\0' || !isdigit((unsigned char)*digits)) {
+    return false;
+  }
+  *value = negative ? -parsed : parsed;
+  return true;
+}
+
+static bool is_register(Assembler* as, const char* text, int* reg) {
+  Symbol* symbol = find_symbol(as, text);
+  if (symbol != NULL && symbol->kind == SymbolAlias) {
+    *reg = symbol->value;
+    return true;
+  }
+  if ((text[0] == 'v' || text[0] == 'V') && isxdigit((unsigned char)text[1]) &&
+      text[2] == '\0') {
+    *reg = isdigit((unsigned char)text[1]) ? text[1] - '0'
+                                           : tolower(text[1]) - 'a' + 10;
+    return true;
+  }
+  return false;
+}
+
+static int parse_register(Assembler* as) {
+  const char* text = next(as);
+  int reg;
+  if (!is_register(as, text, &reg)) {
+    fail(as, "expected a register, found '%s'", text);
+  }
+  return reg;
+}
+
+// expressions in braces, evaluated right away like :calc
+
+static int parse_expression(Assembler* as);
+
+static int parse_operand(Assembler* as) {
+  const char* text = next(as);
+  int value;
+  if (strcmp(text, "(") == 0) {
+    value = parse_expression(as);
+    expect(as, ")");
+    return value;
+  }
+  if (strcmp(text, "-") == 0) {
+    return -parse_operand(as);
+  }
+  if (strcmp(text, "~") == 0) {
+    return ~parse_operand(as);
+  }
+  if (strcmp(text, "HERE") == 0) {
+    return as->here;
+  }
+  if (parse_number(text, &value)) {
+    return value;
+  }
+  Symbol* symbol = find_symbol(as, text);
+  if (symbol != NULL && symbol->kind != SymbolAlias) {
+    return symbol->value;
+  }
+  if (symbol != NULL) {
+    return symbol->value;  // the register number of an alias
+  }
+  fail(as, "undefined name '%s' in expression", text);
+  return 0;
+}
+
+static int precedence(const char* op) {
+  static const char* LEVELS[][4] = {
+      {"|", NULL},         {"^", NULL},       {"&", NULL},
+      {"<<", ">>", NULL},  {"+", "-", NULL},  {"*", "/", "%", NULL},
+  };
+  for (size_t level = 0; level < sizeof(LEVELS) / sizeof(LEVELS[0]); level++) {
+    for (size_t j = 0; LEVELS[level][j] != NULL; j++) {
+      if (strcmp(op, LEVELS[level][j]) == 0) {
+        return level + 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int apply(Assembler* as, const char* op, const int a, const int b) {
+  switch (op[0]) {
+    case '|':
+      return a | b;
+    case '^':
+      return a ^ b;
+    case '&':
+      return a & b;
+    case '<':
+      return a << b;
+    case '>':
+      return a >> b;
+    case '+':
+      return a + b;
+    case '-':
+      return a - b;
+    case '*':
+      return a * b;
+    case '/':
+    case '%':
+      if (b == 0) {
+        fail(as, "division by zero");
+      }
+      return op[0] == '/' ? a / b : a % b;
+  }
+  return 0;
+}
+
+static int parse_binary(Assembler* as, const int min_precedence) {
+  int value = parse_operand(as);
+  for (;;) {
+    const char* op = peek(as);
+    const int p = precedence(op);
+    if (p == 0 || p < min_precedence) {
+      return value;
+    }
+    next(as);
+    value = apply(as, op, value, parse_binary(as, p + 1));
+  }
+}
+
+static int parse_expression(Assembler* as) {
+  return parse_binary(as, 1);
+}
+
+static int parse_braced_expression(Assembler* as) {
+  expect(as, "{");
+  const int value = parse_expression(as);
+  expect(as, "}");
+  return value;
+}
+
+// a constant value: number, :const, defined label or braced expression
+static int parse_value(Assembler* as) {
+  if (strcmp(peek(as), "{") == 0) {
+    return parse_braced_expression(as);
+  }
+  const char* text = next(as);
+  int value;
+  if (parse_number(text, &value)) {
+    return value;
+  }
+  Symbol* symbol = find_symbol(as, text);
+  if (symbol != NULL && symbol->kind != SymbolAlias) {
+    return symbol->value;
+  }
+  fail(as, "expected a value, found '%s'", text);
+  return 0;
+}
+
+static int parse_byte(Assembler* as) {
+  const int value = parse_value(as);
+  if (value < -128 || value > 255) {
+    fail(as, "value %d does not fit a byte", value);
+  }
+  return value & 0xFF;
+}
+
+static int parse_nibble(Assembler* as) {
+  const int value = parse_value(as);
+  if (value < 0 || value > 15) {
+    fail(as, "value %d does not fit a nibble", value);
+  }
+  return value;
+}
+
+// emitting
+
+static void emit_byte(Assembler* as, const int value) {
+  const int offset = as->here - OCTO_PROG_START;
+  if (offset < 0 || offset >= OCTO_MAX_ROM_SIZE) {
+    fail(as, "program does not fit into memory");
+  }
+  as->program->rom[offset] = value & 0xFF;
+  as->here++;
+  if ((size_t)(offset + 1) > as->program->size) {
+    as->program->size = offset + 1;
+  }
+}
+
+static void emit(Assembler* as, const int hi, const int lo) {
+  emit_byte(as, hi);
+  emit_byte(as, lo);
+}
+
+static void patch_address(Assembler* as, const int addr, const int target) {
+  uint8_t* rom = as->program->rom + (addr - OCTO_PROG_START);
+  rom[0] = (rom[0] & 0xF0) | ((target >> 8) & 0x0F);
+  rom[1] = target & 0xFF;
+}
+
+static void add_fixup(Assembler* as,
+                      const char* label,
+                      const FixupKind kind,
+                      const int addr) {
+  as->fixups = realloc(as->fixups, (as->num_fixups + 1) * sizeof(Fixup));
+  as->fixups[as->num_fixups++] =
+      (Fixup){copy_string(label, strlen(label)), kind, addr, as->line};
+}
+
+// 12-bit operand, labels may be defined later
+static void emit_with_address(Assembler* as, const int opcode_nibble) {
+  const int addr = as->here;
+  if (strcmp(peek(as), "{") == 0) {
+    const int value = parse_braced_expression(as);
+    emit(as, (opcode_nibble << 4) | ((value >> 8) & 0x0F), value);
+    return;
+  }
+  const char* text = next(as);
+  int value;
+  Symbol* symbol = find_symbol(as, text);
+  if (parse_number(text, &value) ||
+      (symbol != NULL && symbol->kind != SymbolAlias &&
+       (value = symbol->value, true))) {
+    emit(as, (opcode_nibble << 4) | ((value >> 8) & 0x0F), value);
+  } else {
+    emit(as, opcode_nibble << 4, 0x00);
+    add_fixup(as, text, FixupAddress, addr);
+  }
+}
+
+// conditions
+
+// emits the skip that makes the next instruction run only if the condition
+// holds, or with negated set only if it does not
+static void emit_condition(Assembler* as, const bool negated) {
+  const int reg = parse_register(as);
+  const char* op = next(as);
+
+  static const char* NEGATIONS[][2] = {
+      {"==", "!="}, {"!=", "=="}, {"<", ">="}, {">", "<="},
+      {">=", "<"},  {"<=", ">"},  {"key", "-key"}, {"-key", "key"},
+  };
+  if (negated) {
+    for (size_t j = 0; j < sizeof(NEGATIONS) / sizeof(NEGATIONS[0]); j++) {
+      if (strcmp(op, NEGATIONS[j][0]) == 0) {
+        op = NEGATIONS[j][1];
+        break;
+      }
+    }
+  }
+
+  if (strcmp(op, "key") == 0) {
+    emit(as, 0xE0 | reg, 0xA1);
+    return;
+  }
+  if (strcmp(op, "-key") == 0) {
+    emit(as, 0xE0 | reg, 0x9E);
+    return;
+  }
+
+  int other;
+  const bool is_reg = is_register(as, peek(as), &other);
+  if (is_reg) {
+    next(as);
+  }
+
+  if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
+    const bool equal = (strcmp(op, "==") == 0);
+    if (is_reg) {
+      emit(as, (equal ? 0x90 : 0x50) | reg, other << 4);
+    } else {
+      emit(as, (equal ? 0x40 : 0x30) | reg, parse_byte(as));
+    }
+    return;
+  }
+
+  // comparisons subtract in the temporary register and test its flag
+  int subtract;
+  int skip;
+  if (strcmp(op, ">") == 0) {
+    subtract = 0x5;
+    skip = 0x4F;
+  } else if (strcmp(op, "<") == 0) {
+    subtract = 0x7;
+    skip = 0x4F;
+  } else if (strcmp(op, ">=") == 0) {
+    subtract = 0x7;
+    skip = 0x3F;
+  } else if (strcmp(op, "<=") == 0) {
+    subtract = 0x5;
+    skip = 0x3F;
+  } else {
+    fail(as, "unknown comparison '%s'", op);
+    return;
+  }
+  if (is_reg) {
+    emit(as, 0x80 | COMPARE_TEMP, other << 4);
+  } else {
+    emit(as, 0x60 | COMPARE_TEMP, parse_byte(as));
+  }
+  emit(as, 0x80 | COMPARE_TEMP, (reg << 4) | subtract);
+  emit(as, skip, 0x00);
+}
+
+static void push_control(Assembler* as, const ControlKind kind, const int addr) {
+  if (as->num_control == MAX_CONTROL_DEPTH) {
+    fail(as, "control structures nested too deeply");
+  }
+  as->control[as->num_control++] = (Control){kind, addr};
+}
+
+// statements
+
+static void parse_statement(Assembler* as);
+
+static void parse_register_statement(Assembler* as, const int reg) {
+  const char* op = next(as);
+  int other;
+
+  if (strcmp(op, ":=") == 0) {
+    const char* source = peek(as);
+    if (is_register(as, source, &other)) {
+      next(as);
+      emit(as, 0x80 | reg, other << 4);
+    } else if (strcmp(source, "random") == 0) {
+      next(as);
+      emit(as, 0xC0 | reg, parse_byte(as));
+    } else if (strcmp(source, "key") == 0) {
+      next(as);
+      emit(as, 0xF0 | reg, 0x0A);
+    } else if (strcmp(source, "delay") == 0) {
+      next(as);
+      emit(as, 0xF0 | reg, 0x07);
+    } else {
+      emit(as, 0x60 | reg, parse_byte(as));
+    }
+    return;
+  }
+
+  if (strcmp(op, "+=") == 0 || strcmp(op, "-=") == 0) {
+    const bool add = (op[0] == '+');
+    if (is_register(as, peek(as), &other)) {
+      next(as);
+      emit(as, 0x80 | reg, (other << 4) | (add ? 0x4 : 0x5));
+    } else {
+      const int value = parse_byte(as);
+      emit(as, 0x70 | reg, add ? value : (256 - value) & 0xFF);
+    }
+    return;
+  }
+
+  static const struct {
+    const char* op;
+    int code;
+  } ALU[] = {
+      {"|=", 0x1}, {"&=", 0x2},  {"^=", 0x3}, {"=-", 0x7},
+      {">>=", 0x6}, {"<<=", 0xE},
+  };
+  for (size_t j = 0; j < sizeof(ALU) / sizeof(ALU[0]); j++) {
+    if (strcmp(op, ALU[j].op) == 0) {
+      emit(as, 0x80 | reg, (parse_register(as) << 4) | ALU[j].code);
+      return;
+    }
+  }
+  fail(as, "unknown operator '%s'", op);
+}
+
+static void parse_i_statement(Assembler* as) {
+  const char* op = next(as);
+  if (strcmp(op, "+=") == 0) {
+    emit(as, 0xF0 | parse_register(as), 0x1E);
+    return;
+  }
+  if (strcmp(op, ":=") != 0) {
+    fail(as, "unknown operator '%s' for i", op);
+  }
+  if (strcmp(peek(as), "hex") == 0) {
+    next(as);
+    emit(as, 0xF0 | parse_register(as), 0x29);
+  } else if (strcmp(peek(as), "bighex") == 0) {
+    next(as);
+    emit(as, 0xF0 | parse_register(as), 0x30);
+  } else {
+    emit_with_address(as, 0xA);
+  }
+}
+
+static void parse_macro_definition(Assembler* as, const bool is_stringmode) {
+  as->macros = realloc(as->macros, (as->num_macros + 1) * sizeof(Macro));
+  Macro* macro = &as->macros[as->num_macros++];
+  *macro = (Macro){0};
+  const char* name = next(as);
+  macro->name = copy_string(name, strlen(name));
+  if (is_stringmode) {
+    Token* alphabet = next_token(as);
+    macro->alphabet = copy_string(alphabet->text, strlen(alphabet->text));
+  }
+  while (strcmp(peek(as), "{") != 0) {
+    if (macro->num_params == MAX_MACRO_ARGS) {
+      fail(as, "too many macro parameters");
+    }
+    const char* param = next(as);
+    macro->params[macro->num_params++] = copy_string(param, strlen(param));
+  }
+  expect(as, "{");
+  for (int depth = 1;;) {
+    Token* token = next_token(as);
+    depth += (strcmp(token->text, "{") == 0) - (strcmp(token->text, "}") == 0);
+    if (depth == 0) {
+      break;
+    }
+    push_token(&macro->body,
+               (Token){copy_string(token->text, strlen(token->text)),
+                       token->line, token->is_string});
+  }
+}
+
+static void expand(Assembler* as,
+                   Macro* macro,
+                   char** names,
+                   char** values,
+                   const size_t count) {
+  TokenList* expansion = calloc(1, sizeof(TokenList));
+  for (size_t j = 0; j < macro->body.count; j++) {
+    const Token* token = &macro->body.items[j];
+    const char* text = token->text;
+    for (size_t k = 0; k < count; k++) {
+      if (strcmp(text, names[k]) == 0) {
+        text = values[k];
+      }
+    }
+    push_token(expansion,
+               (Token){copy_string(text, strlen(text)), as->line,
+                       token->is_string});
+  }
+  push_frame(as, expansion, true);
+}
+
+static void invoke_macro(Assembler* as, Macro* macro) {
+  char* values[MAX_MACRO_ARGS];
+  for (size_t j = 0; j < macro->num_params; j++) {
+    const char* arg = next(as);
+    values[j] = copy_string(arg, strlen(arg));
+  }
+  expand(as, macro, macro->params, values, macro->num_params);
+  for (size_t j = 0; j < macro->num_params; j++) {
+    free(values[j]);
+  }
+}
+
+// a string mode expands its body once per character, last character first
+// on the frame stack so that they come out in order
+static void invoke_stringmode(Assembler* as, Macro* macro) {
+  Token* string = next_token(as);
+  if (!string->is_string) {
+    fail(as, "string mode '%s' expects a string", macro->name);
+  }
+  char* text = copy_string(string->text, strlen(string->text));
+  const size_t len = strlen(text);
+  for (size_t j = len; j-- > 0;) {
+    const char* found = strchr(macro->alphabet, text[j]);
+    if (found == NULL) {
+      const char missing = text[j];
+      free(text);
+      fail(as, "character '%c' is not part of string mode '%s'", missing,
+           macro->name);
+    }
+    char value[24], character[24], index[24];
+    snprintf(value, sizeof(value), "%d", (int)(found - macro->alphabet));
+    snprintf(character, sizeof(character), "%d", text[j]);
+    snprintf(index, sizeof(index), "%zu", j);
+    char* names[] = {"VALUE", "CHAR", "INDEX"};
+    char* values[] = {value, character, index};
+    expand(as, macro, names, values, 3);
+  }
+  free(text);
+}
+
+static void parse_directive(Assembler* as, const char* directive) {
+  if (strcmp(directive, ":") == 0) {
+    const char* name = next(as);
+    if (strcmp(name, "main") == 0 && as->has_main_jump &&
+        as->here == OCTO_PROG_START + 2) {
+      // main comes first, no need to jump there
+      as->has_main_jump = false;
+      as->here = OCTO_PROG_START;
+      as->program->size = 0;
+    }
+    define_symbol(as, name, SymbolLabel, as->here);
+  } else if (strcmp(directive, ":const") == 0) {
+    const char* name = next(as);
+    define_symbol(as, name, SymbolConst, parse_value(as));
+  } else if (strcmp(directive, ":calc") == 0) {
+    const char* name = next(as);
+    define_symbol(as, name, SymbolConst, parse_braced_expression(as));
+  } else if (strcmp(directive, ":alias") == 0) {
+    const char* name = next(as);
+    define_symbol(as, name, SymbolAlias, parse_register(as));
+  } else if (strcmp(directive, ":macro") == 0) {
+    parse_macro_definition(as, false);
+  } else if (strcmp(directive, ":stringmode") == 0) {
+    parse_macro_definition(as, true);
+  } else if (strcmp(directive, ":byte") == 0) {
+    emit_byte(as, parse_byte(as));
+  } else if (strcmp(directive, ":org") == 0) {
+    as->here = parse_value(as);
+  } else if (strcmp(directive, ":call") == 0) {
+    emit_with_address(as, 0x2);
+  } else if (strcmp(directive, ":pointer") == 0) {
+    add_fixup(as, next(as), FixupPointer, as->here);
+    emit(as, 0x00, 0x00);
+  } else if (strcmp(directive, ":unpack") == 0) {
+    const int nibble = parse_nibble(as);
+    add_fixup(as, next(as), FixupUnpack, as->here);
+    emit(as, 0x60, nibble << 4);
+    emit(as, 0x61, 0x00);
+  } else if (strcmp(directive, ":breakpoint") == 0) {
+    next(as);
+  } else {
+    fail(as, "unsupported directive '%s'", directive);
+  }
+}
+
+static void parse_statement(Assembler* as) {
+  const char* token = next(as);
+  int reg;
+  int value;
+
+  static const struct {
+    const char* name;
+    int opcode;
+  } FIXED[] = {
+      {"clear", 0x00E0},        {"return", 0x00EE},      {";", 0x00EE},
+      {"scroll-right", 0x00FB}, {"scroll-left", 0x00FC}, {"exit", 0x00FD},
+      {"lores", 0x00FE},        {"hires", 0x00FF},
+  };
+  for (size_t j = 0; j < sizeof(FIXED) / sizeof(FIXED[0]); j++) {
+    if (strcmp(token, FIXED[j].name) == 0) {
+      emit(as, FIXED[j].opcode >> 8, FIXED[j].opcode);
+      return;
+    }
+  }
+
+  static const struct {
+    const char* name;
+    int low_byte;
+  } REGISTER_OPS[] = {
+      {"bcd", 0x33},  {"save", 0x55},      {"load", 0x65},
+      {"saveflags", 0x75}, {"loadflags", 0x85},
+  };
+  for (size_t j = 0; j < sizeof(REGISTER_OPS) / sizeof(REGISTER_OPS[0]); j++) {
+    if (strcmp(token, REGISTER_OPS[j].name) == 0) {
+      emit(as, 0xF0 | parse_register(as), REGISTER_OPS[j].low_byte);
+      return;
+    }
+  }
+
+  Macro* macro = find_macro(as, token);
+  Symbol* symbol = find_symbol(as, token);
+
+  if (token[0] == ':') {
+    parse_directive(as, token);
+  } else if (macro != NULL) {
+    if (macro->alphabet != NULL) {
+      invoke_stringmode(as, macro);
+    } else {
+      invoke_macro(as, macro);
+    }
+  } else if (is_register(as, token, &reg)) {
+    parse_register_statement(as, reg);
+  } else if (strcmp(token, "i") == 0) {
+    parse_i_statement(as);
+  } else if (strcmp(token, "delay") == 0 || strcmp(token, "buzzer") == 0) {
+    const int low_byte = (token[0] == 'd') ? 0x15 : 0x18;
+    expect(as, ":=");
+    emit(as, 0xF0 | parse_register(as), low_byte);
+  } else if (strcmp(token, "sprite") == 0) {
+    const int x = parse_register(as);
+    const int y = parse_register(as);
+    emit(as, 0xD0 | x, (y << 4) | parse_nibble(as));
+  } else if (strcmp(token, "scroll-down") == 0) {
+    emit(as, 0x00, 0xC0 | parse_nibble(as));
+  } else if (strcmp(token, "scroll-up") == 0) {
+    emit(as, 0x00, 0xD0 | parse_nibble(as));
+  } else if (strcmp(token, "jump") == 0) {
+    emit_with_address(as, 0x1);
+  } else if (strcmp(token, "jump0") == 0) {
+    emit_with_address(as, 0xB);
+  } else if (strcmp(token, "native") == 0) {
+    emit_with_address(as, 0x0);
+  } else if (strcmp(token, "if") == 0) {
+    // `then` guards one statement, `begin` a block that is jumped over
+    int end = 0;
+    for (Frame* frame = &as->frames[as->num_frames - 1];
+         frame->pos + end < frame->list->count; end++) {
+      const char* word = frame->list->items[frame->pos + end].text;
+      if (strcmp(word, "then") == 0 || strcmp(word, "begin") == 0) {
+        break;
+      }
+    }
+    const Frame* frame = &as->frames[as->num_frames - 1];
+    if (frame->pos + end >= frame->list->count) {
+      fail(as, "'if' without 'then' or 'begin'");
+    }
+    const bool is_block =
+        strcmp(frame->list->items[frame->pos + end].text, "begin") == 0;
+    emit_condition(as, is_block);
+    next(as);
+    if (is_block) {
+      push_control(as, ControlIf, as->here);
+      emit(as, 0x10, 0x00);
+    } else {
+      parse_statement(as);
+    }
+  } else if (strcmp(token, "else") == 0) {
+    if (as->num_control == 0 ||
+        as->control[as->num_control - 1].kind != ControlIf) {
+      fail(as, "'else' without 'begin'");
+    }
+    Control* control = &as->control[as->num_control - 1];
+    const int jump = as->here;
+    emit(as, 0x10, 0x00);
+    patch_address(as, control->addr, as->here);
+    control->addr = jump;
+  } else if (strcmp(token, "end") == 0) {
+    if (as->num_control == 0 ||
+        as->control[as->num_control - 1].kind != ControlIf) {
+      fail(as, "'end' without 'begin'");
+    }
+    patch_address(as, as->control[--as->num_control].addr, as->here);
+  } else if (strcmp(token, "loop") == 0) {
+    push_control(as, ControlLoop, as->here);
+  } else if (strcmp(token, "while") == 0) {
+    emit_condition(as, true);
+    push_control(as, ControlWhile, as->here);
+    emit(as, 0x10, 0x00);
+  } else if (strcmp(token, "again") == 0) {
+    size_t start = as->num_control;
+    while (start > 0 && as->control[start - 1].kind == ControlWhile) {
+      start--;
+    }
+    if (start == 0 || as->control[start - 1].kind != ControlLoop) {
+      fail(as, "'again' without 'loop'");
+    }
+    const int loop = as->control[start - 1].addr;
+    emit(as, 0x10 | ((loop >> 8) & 0x0F), loop);
+    for (size_t j = start; j < as->num_control; j++) {
+      patch_address(as, as->control[j].addr, as->here);
+    }
+    as->num_control = start - 1;
+  } else if (parse_number(token, &value)) {
+    if (value < -128 || value > 255) {
+      fail(as, "value %d does not fit a byte", value);
+    }
+    emit_byte(as, value);
+  } else if (symbol != NULL && symbol->kind == SymbolConst) {
+    emit_byte(as, symbol->value);
+  } else {
+    // anything else names a subroutine
+    const int addr = as->here;
+    if (symbol != NULL) {
+      emit(as, 0x20 | ((symbol->value >> 8) & 0x0F), symbol->value);
+    } else {
+      emit(as, 0x20, 0x00);
+      add_fixup(as, token, FixupAddress, addr);
+    }
+  }
+}
+
+static void resolve_fixups(Assembler* as) {
+  for (size_t j = 0; j < as->num_fixups; j++) {
+    const Fixup* fixup = &as->fixups[j];
+    Symbol* symbol = find_symbol(as, fixup->label);
+    as->line = fixup->line;
+    if (symbol == NULL || symbol->kind == SymbolAlias) {
+      fail(as, "undefined label '%s'", fixup->label);
+    }
+    uint8_t* rom = as->program->rom + (fixup->addr - OCTO_PROG_START);
+    switch (fixup->kind) {
+      case FixupAddress:
+        patch_address(as, fixup->addr, symbol->value);
+        break;
+      case FixupUnpack:
+        rom[1] |= (symbol->value >> 8) & 0x0F;
+        rom[3] = symbol->value & 0xFF;
+        break;
+      case FixupPointer:
+        rom[0] = (symbol->value >> 8) & 0xFF;
+        rom[1] = symbol->value & 0xFF;
+        break;
+    }
+  }
+}
+
+static void free_assembler(Assembler* as) {
+  while (as->num_frames > 0) {
+    Frame* frame = &as->frames[--as->num_frames];
+    if (frame->is_owned) {
+      free_tokens(frame->list);
+      free(frame->list);
+    }
+  }
+  free_tokens(&as->source);
+  for (size_t j = 0; j < as->num_symbols; j++) {
+    free(as->symbols[j].name);
+  }
+  free(as->symbols);
+  for (size_t j = 0; j < as->num_macros; j++) {
+    Macro* macro = &as->macros[j];
+    free(macro->name);
+    free(macro->alphabet);
+    for (size_t k = 0; k < macro->num_params; k++) {
+      free(macro->params[k]);
+    }
+    free_tokens(&macro->body);
+  }
+  free(as->macros);
+  for (size_t j = 0; j < as->num_fixups; j++) {
+    free(as->fixups[j].label);
+  }
+  free(as->fixups);
+}
+
+bool octo_assemble(const char* source,
+                   const OctoDefine* defines,
+                   const size_t num_defines,
+                   OctoProgram* program) {
+  Assembler* as = calloc(1, sizeof(Assembler));
+  as->program = program;
+  memset(program, 0, sizeof(OctoProgram));
+
+  bool ok = false;
+  if (setjmp(as->on_error) == 0) {
+    for (size_t j = 0; j < num_defines; j++) {
+      define_symbol(as, defines[j].name, SymbolConst, defines[j].value);
+      find_symbol(as, defines[j].name)->is_predefined = true;
+    }
+    tokenize(as, source);
+    push_frame(as, &as->source, false);
+
+    // jump to main, dropped again if main comes first
+    as->here = OCTO_PROG_START;
+    as->has_main_jump = true;
+    emit(as, 0x10, 0x00);
+
+    while (!at_end(as)) {
+      parse_statement(as);
+    }
+    if (as->num_control > 0) {
+      fail(as, "unterminated 'loop' or 'begin'");
+    }
+    if (as->has_main_jump) {
+      Symbol* main = find_symbol(as, "main");
+      if (main == NULL || main->kind != SymbolLabel) {
+        fail(as, "no 'main' label");
+      }
+      patch_address(as, OCTO_PROG_START, main->value);
+    }
+    resolve_fixups(as);
+    ok = true;
+  }
+
+  free_assembler(as);
+  free(as);
+  return ok;
+}
+
+bool octo_assemble_file(const char* file_name,
+                        const OctoDefine* defines,
+                        const size_t num_defines,
+                        OctoProgram* program) {
+  FILE* file = fopen(file_name, "rb");
+  if (file == NULL) {
+    memset(program, 0, sizeof(OctoProgram));
+    snprintf(program->error, OCTO_MAX_ERROR, "could not read '%s'", file_name);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  const long len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char* source = malloc(len + 1);
+  source[fread(source, 1, len, file)] = '\0';
+  fclose(file);
+
+  const bool ok = octo_assemble(source, defines, num_defines, program);
+  free(source);
+  return ok;
+}
+
+bool octo_is_source(const char* file_name) {
+  const size_t len = strlen(file_name);
+  return len > 3 && strcmp(file_name + len - 3, ".8o") == 0;
+}
@@ -0,0 +1,42 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Assembler for the subset of Octo (https://github.com/JohnEarnest/Octo) that
+// the CHIP-8 and SUPER-CHIP sources in chip8-roms/tests use: labels, :const,
+// :alias, :macro, :calc, :byte, :org, :unpack, :pointer, :stringmode,
+// if/then, if/begin/else/end, loop/while/again and the comparison
+// pseudo-instructions.
+
+#define OCTO_PROG_START 0x200
+#define OCTO_MAX_ROM_SIZE (0x1000 - OCTO_PROG_START)
+#define OCTO_MAX_ERROR 256
+
+typedef struct {
+  uint8_t rom[OCTO_MAX_ROM_SIZE];
+  size_t size;
+  char error[OCTO_MAX_ERROR];  // empty on success
+  int error_line;
+} OctoProgram;
+
+// predefines a constant as if the source started with `:const name value`,
+// a :const of the same name in the source keeps the predefined value so that
+// templates can declare their defaults
+typedef struct {
+  const char* name;
+  int value;
+} OctoDefine;
+
+bool octo_assemble(const char* source,
+                   const OctoDefine* defines,
+                   const size_t num_defines,
+                   OctoProgram* program);
+
+// reads and assembles a file, returns false and sets program->error on failure
+bool octo_assemble_file(const char* file_name,
+                        const OctoDefine* defines,
+                        const size_t num_defines,
+                        OctoProgram* program);
+
+// true for file names ending in .8o
+bool octo_is_source(const char* file_name);
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "octo.h"
+
+#define MAX_DEFINES 16
+
+// usage: octo [-D NAME=VALUE]... input.8o output.ch8
+int main(int argc, char** argv) {
+  OctoDefine defines[MAX_DEFINES];
+  size_t num_defines = 0;
+  int arg = 1;
+  for (; arg + 1 < argc && strcmp(argv[arg], "-D") == 0; arg += 2) {
+    char* value = strchr(argv[arg + 1], '=');
+    if (value == NULL || num_defines == MAX_DEFINES) {
+      fprintf(stderr, "invalid define '%s'\n", argv[arg + 1]);
+      return 1;
+    }
+    *value = '\0';
+    defines[num_defines++] =
+        (OctoDefine){.name = argv[arg + 1], .value = strtol(value + 1, NULL, 0)};
+  }
+  if (argc - arg != 2) {
+    fprintf(stderr, "usage: %s [-D NAME=VALUE]... input.8o output.ch8\n",
+            argv[0]);
+    return 1;
+  }
+
+  OctoProgram* program = malloc(sizeof(OctoProgram));
+  if (!octo_assemble_file(argv[arg], defines, num_defines, program)) {
+    fprintf(stderr, "%s:%d: %s\n", argv[arg], program->error_line,
+            program->error);
+    free(program);
+    return 1;
+  }
+
+  FILE* file = fopen(argv[arg + 1], "wb");
+  if (file == NULL) {
+    fprintf(stderr, "could not write '%s'\n", argv[arg + 1]);
+    free(program);
+    return 1;
+  }
+  fwrite(program->rom, 1, program->size, file);
+  fclose(file);
+  printf("%s: %zu bytes\n", argv[arg + 1], program->size);
+  free(program);
+  return 0;
+}
@@ -0,0 +1,138 @@
+// Packs a ROM into the .c8z container the app unpacks while loading, see
+// chip8-app/lz.h. The result is unpacked again and compared before it is
+// written.
+//
+//   make pack && ./pack ROM OUTPUT.c8z
+//
+// ROM is a binary or Octo source. The ROMs of 1 KB and more in chip8-roms pack
+// to 42-83% of their size, cavern best and chipquarium worst. Below 200 bytes
+// packing rarely pays: the header alone takes 8 bytes, and dodge grows from 56
+// to 69.
+
+#include <stdio.h>
+
+#include "../chip8-app/lz.h"
+#include "harness.h"
+
+#define MAX_ROM_SIZE 0x10000
+
+typedef struct {
+  byte* data;
+  size_t size;  // in bytes, the last one may be partial
+  uint8_t num_bits;  // used in the last byte
+} BitWriter;
+
+static void put_bits(BitWriter* writer, const uint32_t value,
+                     const uint8_t count) {
+  for (int bit = count - 1; bit >= 0; bit--) {
+    if (writer->num_bits == 0) writer->data[writer->size++] = 0;
+    writer->data[writer->size - 1] |= ((value >> bit) & 1)
+                                      << (7 - writer->num_bits);
+    writer->num_bits = (writer->num_bits + 1) % 8;
+  }
+}
+
+// the longest match for offset within the window, 0 if none reaches
+// LZ_MIN_MATCH
+static size_t find_match(const byte* rom, const size_t size,
+                         const size_t offset, size_t* distance) {
+  size_t best = 0;
+  const size_t max_length =
+      size - offset < LZ_MAX_MATCH ? size - offset : LZ_MAX_MATCH;
+  const size_t max_distance = offset < LZ_WINDOW_SIZE ? offset : LZ_WINDOW_SIZE;
+  for (size_t d = 1; d <= max_distance; d++) {
+    size_t length = 0;
+    while (length < max_length &&
+           rom[offset + length] == rom[offset - d + length]) {
+      length++;
+    }
+    if (length > best) {
+      best = length;
+      *distance = d;
+    }
+  }
+  return best >= LZ_MIN_MATCH ? best : 0;
+}
+
+// greedy, except that a match is given up for a literal if the next byte
+// starts a longer one
+static size_t pack(const byte* rom, const size_t size, byte* packed) {
+  lz_write_header(packed, size);
+  BitWriter writer = {.data = packed + LZ_HEADER_SIZE};
+  size_t offset = 0;
+  while (offset < size) {
+    size_t distance = 0, next_distance = 0;
+    const size_t length = find_match(rom, size, offset, &distance);
+    const bool is_deferred =
+        length > 0 && offset + 1 < size &&
+        find_match(rom, size, offset + 1, &next_distance) > length;
+    if (length == 0 || is_deferred) {
+      put_bits(&writer, 1, 1);
+      put_bits(&writer, rom[offset], 8);
+      offset++;
+    } else {
+      put_bits(&writer, 0, 1);
+      put_bits(&writer, distance - 1, LZ_WINDOW_BITS);
+      put_bits(&writer, length - LZ_MIN_MATCH, LZ_LENGTH_BITS);
+      offset += length;
+    }
+  }
+  return LZ_HEADER_SIZE + writer.size;
+}
+
+typedef struct {
+  const byte* rom;
+  size_t mismatches;
+} Check;
+
+static void check_byte(void* context, const size_t offset, const byte value) {
+  Check* check = context;
+  if (check->rom[offset] != value) check->mismatches++;
+}
+
+// unpacks in chunks of 7 bytes, as the app does in larger ones
+static bool unpack_equals(const byte* packed, const size_t packed_size,
+                          const byte* rom, const size_t size) {
+  uint32_t unpacked_size;
+  if (!lz_read_header(packed, &unpacked_size) || unpacked_size != size) {
+    return false;
+  }
+  LzDecoder decoder;
+  lz_decoder_init(&decoder, unpacked_size);
+  Check check = {.rom = rom};
+  for (size_t j = LZ_HEADER_SIZE; j < packed_size; j += 7) {
+    const size_t chunk = packed_size - j < 7 ? packed_size - j : 7;
+    if (!lz_decode(&decoder, packed + j, chunk, check_byte, &check)) {
+      return false;
+    }
+  }
+  return lz_is_done(&decoder) && check.mismatches == 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    printf("usage: %s ROM OUTPUT.c8z\n", argv[0]);
+    return 1;
+  }
+  static byte rom[MAX_ROM_SIZE];
+  // a literal takes 9 bits, nothing takes more
+  static byte packed[LZ_HEADER_SIZE + MAX_ROM_SIZE * 9 / 8 + 1];
+  size_t size;
+  if (!harness_read_rom(argv[1], rom, sizeof(rom), &size)) return 1;
+
+  const size_t packed_size = pack(rom, size, packed);
+  if (!unpack_equals(packed, packed_size, rom, size)) {
+    printf("'%s' does not unpack to what was packed\n", argv[1]);
+    return 1;
+  }
+
+  FILE* file = fopen(argv[2], "wb");
+  if (file == NULL || fwrite(packed, 1, packed_size, file) != packed_size) {
+    printf("could not write '%s'\n", argv[2]);
+    return 1;
+  }
+  fclose(file);
+  printf("%zu bytes packed to %zu, %.0f%%\n", size, packed_size,
+         100.0 * packed_size / size);
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Profiles a ROM by subroutine: runs it with random key presses and reports
+// the cpu ticks and sprites spent in each subroutine, with and without the
+// subroutines it calls.
+//
+//   make profile && ./profile ROM [SECONDS [FOLDED [WEIGHT]]]
+//   flamegraph.pl FOLDED > profile.svg
+//
+// FOLDED, if given, gets the call stacks in the collapsed format of
+// flamegraph.pl, `main;sub_2A4;sub_31C 1234` per line, weighted by cpu ticks
+// or, with WEIGHT sprites, by the rows DRW drew. A cpu tick is an instruction,
+// or 2 ms of an idle loop or a wait for a key.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../chip8-app/vm_i.h"
+#include "harness.h"
+
+#if !VM_PROFILE_CALLS
+#error "build with -DVM_PROFILE_CALLS=1, see the Makefile"
+#endif
+
+#define DEFAULT_SECONDS 60
+
+typedef struct {
+  word addr;
+  uint32_t calls;
+  uint64_t inclusive, exclusive; // ticks
+  uint64_t rows; // drawn, inclusive
+} Subroutine;
+
+// whether a caller of the node is the same subroutine, which already counts
+// the node's ticks as its own
+static bool is_recursive(const VM* vm, uint16_t node) {
+  const word addr = vm->profile_nodes[node].addr;
+  while (node != PROFILE_ROOT) {
+    node = vm->profile_nodes[node].parent;
+    if (node != PROFILE_ROOT && vm->profile_nodes[node].addr == addr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static Subroutine* find_subroutine(Subroutine* subroutines, size_t* count,
+                                   const word addr) {
+  for (size_t j = 0; j < *count; j++) {
+    if (subroutines[j].addr == addr) return &subroutines[j];
+  }
+  subroutines[*count] = (Subroutine){.addr = addr};
+  return &subroutines[(*count)++];
+}
+
+static int compare_inclusive(const void* a, const void* b) {
+  const Subroutine* x = a;
+  const Subroutine* y = b;
+  return (x->inclusive < y->inclusive) - (x->inclusive > y->inclusive);
+}
+
+static void print_frame(FILE* file, const VM* vm, const uint16_t node) {
+  if (node == PROFILE_ROOT) {
+    fprintf(file, "main");
+  } else {
+    fprintf(file, "sub_%03X", vm->profile_nodes[node].addr);
+  }
+}
+
+static bool save_folded(const VM* vm, const char* file_name,
+                        const bool is_sprites) {
+  FILE* file = fopen(file_name, "w");
+  if (file == NULL) return false;
+  for (uint16_t node = 0; node < vm->profile_size; node++) {
+    const ProfileNode* profile = &vm->profile_nodes[node];
+    const uint64_t weight = is_sprites ? profile->sprite_rows : profile->ticks;
+    if (weight == 0) continue;
+    uint16_t path[PROFILE_NODES];
+    size_t depth = 0;
+    for (uint16_t n = node; n != PROFILE_ROOT;
+         n = vm->profile_nodes[n].parent) {
+      path[depth++] = n;
+    }
+    print_frame(file, vm, PROFILE_ROOT);
+    while (depth > 0) {
+      fputc(';', file);
+      print_frame(file, vm, path[--depth]);
+    }
+    fprintf(file, " %llu\n", (unsigned long long)weight);
+  }
+  return fclose(file) == 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s ROM [SECONDS [FOLDED [ticks|sprites]]]\n", argv[0]);
+    return 1;
+  }
+  const uint32_t duration_ms =
+      (argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_SECONDS) * 1000;
+  const bool is_sprites = argc > 4 && strcmp(argv[4], "sprites") == 0;
+
+  VM* vm = vm_alloc();
+  memset(vm, 0, vm_get_size());
+  if (!harness_load(vm, argv[1])) return 1;
+  vm_start(vm, 0);
+  vm_set_seed(vm, 1);
+  const uint32_t error_ms = harness_run(vm, duration_ms);
+  if (error_ms != 0) {
+    printf("invalid instruction at %03X after %u ms\n", vm->pc, error_ms);
+  }
+  vm_profile_flush(vm);
+
+  // children come after their parents, so the totals add up from the end
+  static uint64_t inclusive[PROFILE_NODES], rows[PROFILE_NODES];
+  for (uint16_t node = 0; node < vm->profile_size; node++) {
+    inclusive[node] = vm->profile_nodes[node].ticks;
+    rows[node] = vm->profile_nodes[node].sprite_rows;
+  }
+  for (uint16_t node = vm->profile_size - 1; node != PROFILE_ROOT; node--) {
+    const uint16_t parent = vm->profile_nodes[node].parent;
+    inclusive[parent] += inclusive[node];
+    rows[parent] += rows[node];
+  }
+
+  static Subroutine subroutines[PROFILE_NODES];
+  size_t count = 0;
+  for (uint16_t node = 0; node < vm->profile_size; node++) {
+    const ProfileNode* profile = &vm->profile_nodes[node];
+    // main goes by 0, PROG_START can be a subroutine as well
+    const word addr = node == PROFILE_ROOT ? 0 : profile->addr;
+    Subroutine* subroutine = find_subroutine(subroutines, &count, addr);
+    subroutine->calls += profile->calls;
+    subroutine->exclusive += profile->ticks;
+    if (!is_recursive(vm, node)) {
+      subroutine->inclusive += inclusive[node];
+      subroutine->rows += rows[node];
+    }
+  }
+  qsort(subroutines, count, sizeof(Subroutine), compare_inclusive);
+
+  const double total =
+      inclusive[PROFILE_ROOT] > 0 ? inclusive[PROFILE_ROOT] : 1;
+  printf("%u call graph nodes, %llu cpu ticks\n", vm->profile_size,
+         (unsigned long long)inclusive[PROFILE_ROOT]);
+  printf("%-8s %8s %12s %7s %12s %7s %10s\n", "", "calls", "inclusive", "",
+         "exclusive", "", "rows");
+  for (size_t j = 0; j < count; j++) {
+    const Subroutine* s = &subroutines[j];
+    char name[16];
+    if (s->addr == 0) {
+      snprintf(name, sizeof(name), "main");
+    } else {
+      snprintf(name, sizeof(name), "sub_%03X", s->addr);
+    }
+    printf("%-8s %8u %12llu %6.1f%% %12llu %6.1f%% %10llu\n", name, s->calls,
+           (unsigned long long)s->inclusive, 100 * s->inclusive / total,
+           (unsigned long long)s->exclusive, 100 * s->exclusive / total,
+           (unsigned long long)s->rows);
+  }
+
+  if (argc > 3 && !save_folded(vm, argv[3], is_sprites)) {
+    printf("could not write '%s'\n", argv[3]);
+    return 1;
+  }
+  vm_free(vm);
+  return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+  FuriFlagWaitAny = 0x00000000U,
+  FuriFlagWaitAll = 0x00000001U,
+  FuriFlagNoClear = 0x00000002U,
+
+  FuriFlagError = 0x80000000U,
+  FuriFlagErrorUnknown = 0xFFFFFFFFU,
+  FuriFlagErrorTimeout = 0xFFFFFFFEU,
+  FuriFlagErrorResource = 0xFFFFFFFDU,
+  FuriFlagErrorParameter = 0xFFFFFFFCU,
+} FuriFlag;
+
+typedef enum {
+  FuriStatusOk = 0,
+  FuriStatusError = -1,
+  FuriStatusErrorTimeout = -2,
+  FuriStatusErrorResource = -3,
+  FuriStatusErrorParameter = -4,
+} FuriStatus;
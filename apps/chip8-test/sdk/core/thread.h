@@ -0,0 +1,37 @@
+#pragma once
+
+#include "base.h"
+
+typedef struct FuriThread FuriThread;
+typedef FuriThread* FuriThreadId;
+
+typedef int32_t (*FuriThreadCallback)(void* context);
+
+typedef enum {
+  FuriThreadStateStopped,
+  FuriThreadStateStarting,
+  FuriThreadStateRunning,
+} FuriThreadState;
+
+// stack_size is only recorded, host threads get the default stack
+FuriThread* furi_thread_alloc_ex(const char* name,
+                                 uint32_t stack_size,
+                                 FuriThreadCallback callback,
+                                 void* context);
+void furi_thread_free(FuriThread* thread);
+
+// a thread that has been joined can be started again
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+FuriThreadState furi_thread_get_state(FuriThread* thread);
+int32_t furi_thread_get_return_code(FuriThread* thread);
+const char* furi_thread_get_name(FuriThreadId thread_id);
+
+// threads not started through furi_thread_start get an id on first use
+FuriThreadId furi_thread_get_current_id(void);
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_clear(uint32_t flags);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "furi.h"
+
+#define MAX_RECORDS 8
+#define MAX_THREADS 32
+
+/* check and log */
+
+static FuriLogLevel log_level = FuriLogLevelInfo;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+_Noreturn void furi_host_crash(const char* file, int line, const char* message) {
+  fprintf(stderr, "furi_crash in %s at %s:%d: %s\n",
+          furi_thread_get_name(furi_thread_get_current_id()), file, line,
+          message);
+  abort();
+}
+
+void furi_log_set_level(FuriLogLevel level) {
+  log_level = level;
+}
+
+void furi_log_print_format(FuriLogLevel level, const char* tag, const char* format, ...) {
+  if (level > log_level) return;
+  static const char LEVELS[] = " EWIDT";
+  pthread_mutex_lock(&log_mutex);
+  fprintf(stderr, "%lu [%c][%s] ", (unsigned long)furi_get_tick(), LEVELS[level], tag);
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+  pthread_mutex_unlock(&log_mutex);
+}
+
+/* kernel */
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t start_us;
+
+__attribute__((constructor)) static void furi_host_init(void) {
+  start_us = now_us();
+}
+
+uint32_t furi_get_tick(void) {
+  return (now_us() - start_us) / 1000;
+}
+
+void furi_delay_us(uint32_t microseconds) {
+  struct timespec ts = {microseconds / 1000000, (microseconds % 1000000) * 1000};
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+void furi_delay_ms(uint32_t milliseconds) {
+  furi_delay_us(milliseconds * 1000);
+}
+
+// an absolute CLOCK_MONOTONIC deadline timeout ms from now
+static struct timespec deadline(uint32_t timeout) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += timeout / 1000;
+  ts.tv_nsec += (timeout % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  return ts;
+}
+
+/* records */
+
+static struct {
+  const char* name;
+  void* data;
+} records[MAX_RECORDS];
+static size_t num_records;
+
+void furi_record_create(const char* name, void* data) {
+  furi_check(num_records < MAX_RECORDS);
+  records[num_records].name = name;
+  records[num_records].data = data;
+  num_records++;
+}
+
+void* furi_record_open(const char* name) {
+  for (size_t j = 0; j < num_records; j++) {
+    if (strcmp(records[j].name, name) == 0) return records[j].data;
+  }
+  furi_crash("record not created");
+}
+
+void furi_record_close(const char* name) {
+  UNUSED(name);
+}
+
+/* threads */
+
+struct FuriThread {
+  char name[32];
+  uint32_t stack_size;
+  FuriThreadCallback callback;
+  void* context;
+  int32_t return_code;
+
+  pthread_t pthread;
+  bool is_joinable;
+  _Atomic FuriThreadState state;
+
+  pthread_mutex_t flags_mutex;
+  pthread_cond_t flags_changed;
+  uint32_t flags;
+
+  FuriHostLockStats lock_stats;
+};
+
+static _Thread_local FuriThread* current_thread;
+
+// every thread ever seen, for furi_host_for_each_thread, never freed before exit
+static FuriThread* threads[MAX_THREADS];
+static size_t num_threads;
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static FuriThread* thread_alloc(const char* name) {
+  FuriThread* thread = calloc(1, sizeof(FuriThread));
+  snprintf(thread->name, sizeof(thread->name), "%s", name);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&thread->flags_mutex, NULL);
+  pthread_cond_init(&thread->flags_changed, &attr);
+  pthread_condattr_destroy(&attr);
+
+  pthread_mutex_lock(&threads_mutex);
+  if (num_threads < MAX_THREADS) threads[num_threads++] = thread;
+  pthread_mutex_unlock(&threads_mutex);
+  return thread;
+}
+
+FuriThread* furi_thread_alloc_ex(const char* name,
+                                 uint32_t stack_size,
+                                 FuriThreadCallback callback,
+                                 void* context) {
+  FuriThread* thread = thread_alloc(name);
+  thread->stack_size = stack_size;
+  thread->callback = callback;
+  thread->context = context;
+  return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+  furi_check(furi_thread_get_state(thread) == FuriThreadStateStopped);
+  if (thread->is_joinable) furi_thread_join(thread);
+  // kept in threads[] for the statistics
+}
+
+static void* thread_body(void* argument) {
+  FuriThread* thread = argument;
+  current_thread = thread;
+  pthread_setname_np(pthread_self(), thread->name);
+  thread->state = FuriThreadStateRunning;
+  thread->return_code = thread->callback(thread->context);
+  thread->state = FuriThreadStateStopped;
+  return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+  furi_check(thread->callback != NULL);
+  if (thread->is_joinable) furi_thread_join(thread);
+  thread->state = FuriThreadStateStarting;
+  thread->flags = 0;
+  furi_check(pthread_create(&thread->pthread, NULL, thread_body, thread) == 0);
+  thread->is_joinable = true;
+}
+
+bool furi_thread_join(FuriThread* thread) {
+  if (thread->is_joinable) {
+    pthread_join(thread->pthread, NULL);
+    thread->is_joinable = false;
+  }
+  return true;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+  return thread;
+}
+
+FuriThreadState furi_thread_get_state(FuriThread* thread) {
+  return thread->state;
+}
+
+int32_t furi_thread_get_return_code(FuriThread* thread) {
+  return thread->return_code;
+}
+
+const char* furi_thread_get_name(FuriThreadId thread_id) {
+  return thread_id->name;
+}
+
+FuriThreadId furi_thread_get_current_id(void) {
+  if (current_thread == NULL) {
+    char name[16] = "host";
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    current_thread = thread_alloc(name);
+    current_thread->state = FuriThreadStateRunning;
+  }
+  return current_thread;
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+  pthread_mutex_lock(&thread_id->flags_mutex);
+  thread_id->flags |= flags;
+  const uint32_t result = thread_id->flags;
+  pthread_cond_broadcast(&thread_id->flags_changed);
+  pthread_mutex_unlock(&thread_id->flags_mutex);
+  return result;
+}
+
+uint32_t furi_thread_flags_clear(uint32_t flags) {
+  FuriThread* thread = furi_thread_get_current_id();
+  pthread_mutex_lock(&thread->flags_mutex);
+  const uint32_t result = thread->flags;
+  thread->flags &= ~flags;
+  pthread_mutex_unlock(&thread->flags_mutex);
+  return result;
+}
+
+static bool is_flags_set(const uint32_t set, const uint32_t flags, const uint32_t options) {
+  return (options & FuriFlagWaitAll) ? (set & flags) == flags : (set & flags) != 0;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+  FuriThread* thread = furi_thread_get_current_id();
+  const struct timespec until = deadline(timeout);
+  pthread_mutex_lock(&thread->flags_mutex);
+  int error = 0;
+  while (!is_flags_set(thread->flags, flags, options) && error == 0) {
+    if (timeout == FuriWaitForever) {
+      pthread_cond_wait(&thread->flags_changed, &thread->flags_mutex);
+    } else if (timeout == 0) {
+      error = ETIMEDOUT;
+    } else {
+      error = pthread_cond_timedwait(&thread->flags_changed, &thread->flags_mutex, &until);
+    }
+  }
+  uint32_t result = FuriFlagErrorTimeout;
+  if (is_flags_set(thread->flags, flags, options)) {
+    result = thread->flags;
+    if (!(options & FuriFlagNoClear)) thread->flags &= ~flags;
+  }
+  pthread_mutex_unlock(&thread->flags_mutex);
+  return result;
+}
+
+/* mutex */
+
+struct FuriMutex {
+  pthread_mutex_t mutex;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+  FuriMutex* mutex = malloc(sizeof(FuriMutex));
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  if (type == FuriMutexTypeRecursive) {
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  }
+  pthread_mutex_init(&mutex->mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+  pthread_mutex_destroy(&mutex->mutex);
+  free(mutex);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+  FuriHostLockStats* stats = &furi_thread_get_current_id()->lock_stats;
+  stats->acquired++;
+  if (pthread_mutex_trylock(&mutex->mutex) == 0) return FuriStatusOk;
+  if (timeout == 0) return FuriStatusErrorResource;
+
+  stats->contended++;
+  const uint64_t wait_start = now_us();
+  int error;
+  if (timeout == FuriWaitForever) {
+    error = pthread_mutex_lock(&mutex->mutex);
+  } else {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout / 1000;
+    until.tv_nsec += (timeout % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+    error = pthread_mutex_timedlock(&mutex->mutex, &until);
+  }
+  const uint64_t wait_us = now_us() - wait_start;
+  stats->wait_us += wait_us;
+  if (wait_us > stats->max_wait_us) stats->max_wait_us = wait_us;
+  return error == 0 ? FuriStatusOk : FuriStatusErrorTimeout;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+  return pthread_mutex_unlock(&mutex->mutex) == 0 ? FuriStatusOk : FuriStatusError;
+}
+
+void furi_host_for_each_thread(void (*callback)(const char* name,
+                                                const FuriHostLockStats* stats,
+                                                void* context),
+                               void* context) {
+  pthread_mutex_lock(&threads_mutex);
+  for (size_t j = 0; j < num_threads; j++) {
+    if (threads[j]->lock_stats.acquired > 0) {
+      callback(threads[j]->name, &threads[j]->lock_stats, context);
+    }
+  }
+  pthread_mutex_unlock(&threads_mutex);
+}
+
+/* strings */
+
+struct FuriString {
+  char* data;
+  size_t size;
+  size_t capacity;
+};
+
+static void string_reserve(FuriString* string, size_t size) {
+  if (size + 1 <= string->capacity) return;
+  string->capacity = size + 1 > 2 * string->capacity ? size + 1 : 2 * string->capacity;
+  string->data = realloc(string->data, string->capacity);
+  furi_check(string->data != NULL);
+}
+
+static void string_set(FuriString* string, const char* source, size_t size) {
+  string_reserve(string, size);
+  memmove(string->data, source, size);
+  string->data[size] = '\0';
+  string->size = size;
+}
+
+FuriString* furi_string_alloc(void) {
+  FuriString* string = calloc(1, sizeof(FuriString));
+  string_set(string, "", 0);
+  return string;
+}
+
+FuriString* furi_string_alloc_set(const FuriString* source) {
+  return furi_string_alloc_set_str(source->data);
+}
+
+FuriString* furi_string_alloc_set_str(const char* source) {
+  FuriString* string = furi_string_alloc();
+  furi_string_set_str(string, source);
+  return string;
+}
+
+static int string_vprintf(FuriString* string, size_t start, const char* format, va_list args) {
+  va_list copy;
+  va_copy(copy, args);
+  const int size = vsnprintf(NULL, 0, format, copy);
+  va_end(copy);
+  if (size < 0) return size;
+  string_reserve(string, start + size);
+  vsnprintf(string->data + start, size + 1, format, args);
+  string->size = start + size;
+  return size;
+}
+
+FuriString* furi_string_alloc_printf(const char* format, ...) {
+  FuriString* string = furi_string_alloc();
+  va_list args;
+  va_start(args, format);
+  string_vprintf(string, 0, format, args);
+  va_end(args);
+  return string;
+}
+
+void furi_string_free(FuriString* string) {
+  free(string->data);
+  free(string);
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+  return string->data;
+}
+
+size_t furi_string_size(const FuriString* string) {
+  return string->size;
+}
+
+bool furi_string_empty(const FuriString* string) {
+  return string->size == 0;
+}
+
+char furi_string_get_char(const FuriString* string, size_t index) {
+  furi_check(index < string->size);
+  return string->data[index];
+}
+
+void furi_string_reset(FuriString* string) {
+  string_set(string, "", 0);
+}
+
+void furi_string_set_str(FuriString* string, const char* source) {
+  string_set(string, source, strlen(source));
+}
+
+void furi_string_set(FuriString* string, const FuriString* source) {
+  string_set(string, source->data, source->size);
+}
+
+void furi_string_cat_str(FuriString* string, const char* tail) {
+  const size_t size = strlen(tail);
+  string_reserve(string, string->size + size);
+  memcpy(string->data + string->size, tail, size + 1);
+  string->size += size;
+}
+
+int furi_string_printf(FuriString* string, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  const int size = string_vprintf(string, 0, format, args);
+  va_end(args);
+  return size;
+}
+
+int furi_string_cat_printf(FuriString* string, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  const int size = string_vprintf(string, string->size, format, args);
+  va_end(args);
+  return size;
+}
+
+void furi_string_push_back(FuriString* string, char c) {
+  const char tail[2] = {c, '\0'};
+  furi_string_cat_str(string, tail);
+}
+
+bool furi_string_equal_str(const FuriString* string, const char* other) {
+  return strcmp(string->data, other) == 0;
+}
+
+bool furi_string_start_with_str(const FuriString* string, const char* start) {
+  return strncmp(string->data, start, strlen(start)) == 0;
+}
+
+bool furi_string_end_with_str(const FuriString* string, const char* end) {
+  const size_t size = strlen(end);
+  return size <= string->size && strcmp(string->data + string->size - size, end) == 0;
+}
+
+size_t furi_string_search_char(const FuriString* string, char c, size_t start) {
+  if (start >= string->size) return FURI_STRING_FAILURE;
+  const char* found = strchr(string->data + start, c);
+  return found != NULL ? (size_t)(found - string->data) : FURI_STRING_FAILURE;
+}
+
+void furi_string_left(FuriString* string, size_t index) {
+  if (index < string->size) string_set(string, string->data, index);
+}
+
+void furi_string_right(FuriString* string, size_t index) {
+  if (index > string->size) index = string->size;
+  string_set(string, string->data + index, string->size - index);
+}
+
+void furi_string_replace_all(FuriString* string, const char* pattern, const char* replacement) {
+  const size_t pattern_size = strlen(pattern);
+  if (pattern_size == 0) return;
+  FuriString* result = furi_string_alloc();
+  const char* rest = string->data;
+  for (const char* found; (found = strstr(rest, pattern)) != NULL;
+       rest = found + pattern_size) {
+    string_reserve(result, result->size + (found - rest));
+    memcpy(result->data + result->size, rest, found - rest);
+    result->size += found - rest;
+    result->data[result->size] = '\0';
+    furi_string_cat_str(result, replacement);
+  }
+  furi_string_cat_str(result, rest);
+  furi_string_set(string, result);
+  furi_string_free(result);
+}
+
+void furi_string_trim(FuriString* string) {
+  static const char* SPACE = " \t\r\n";
+  size_t end = string->size;
+  while (end > 0 && strchr(SPACE, string->data[end - 1]) != NULL) end--;
+  size_t start = 0;
+  while (start < end && strchr(SPACE, string->data[start]) != NULL) start++;
+  string_set(string, string->data + start, end - start);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+/* A stand-in for the parts of the Flipper SDK the app uses, so that the whole
+ * app builds and runs on Linux, see `make headless`. It follows the
+ * signatures of the firmware headers, not their implementation: threads are
+ * pthreads, the SD card is a local directory and the display a bitmap. */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/base.h"
+#include "core/thread.h"
+
+#ifndef UNUSED
+#define UNUSED(X) (void)(X)
+#endif
+
+#define EXT_PATH(path) "/ext/" path
+
+/* check and log */
+
+#define furi_crash(...) furi_host_crash(__FILE__, __LINE__, "" __VA_ARGS__)
+#define furi_check(condition, ...) \
+  ((condition) ? (void)0 : furi_host_crash(__FILE__, __LINE__, #condition))
+#define furi_assert(condition, ...) furi_check(condition)
+
+_Noreturn void furi_host_crash(const char* file, int line, const char* message);
+
+typedef enum {
+  FuriLogLevelNone = 0,
+  FuriLogLevelError,
+  FuriLogLevelWarn,
+  FuriLogLevelInfo,
+  FuriLogLevelDebug,
+  FuriLogLevelTrace,
+} FuriLogLevel;
+
+void furi_log_set_level(FuriLogLevel level);
+// no format attribute: the app formats for the 32-bit target, as the firmware does
+void furi_log_print_format(FuriLogLevel level, const char* tag, const char* format, ...);
+
+#define FURI_LOG_E(tag, format, ...) \
+  furi_log_print_format(FuriLogLevelError, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_W(tag, format, ...) \
+  furi_log_print_format(FuriLogLevelWarn, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_I(tag, format, ...) \
+  furi_log_print_format(FuriLogLevelInfo, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_D(tag, format, ...) \
+  furi_log_print_format(FuriLogLevelDebug, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_T(tag, format, ...) \
+  furi_log_print_format(FuriLogLevelTrace, tag, format, ##__VA_ARGS__)
+
+/* kernel */
+
+// milliseconds since the process started
+uint32_t furi_get_tick(void);
+void furi_delay_ms(uint32_t milliseconds);
+void furi_delay_us(uint32_t microseconds);
+
+/* records */
+
+void furi_record_create(const char* name, void* data);
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
+
+/* mutex, the host keeps per thread statistics of the time spent waiting */
+
+typedef enum {
+  FuriMutexTypeNormal,
+  FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+typedef struct {
+  uint32_t acquired;
+  uint32_t contended;  // had to wait for another thread
+  uint64_t wait_us;
+  uint32_t max_wait_us;
+} FuriHostLockStats;
+
+// calls callback for every thread that has used a FuriMutex
+void furi_host_for_each_thread(void (*callback)(const char* name,
+                                                const FuriHostLockStats* stats,
+                                                void* context),
+                               void* context);
+
+/* strings */
+
+#define FURI_STRING_FAILURE ((size_t)-1)
+
+typedef struct FuriString FuriString;
+
+FuriString* furi_string_alloc(void);
+FuriString* furi_string_alloc_set(const FuriString* source);
+FuriString* furi_string_alloc_set_str(const char* source);
+FuriString* furi_string_alloc_printf(const char* format, ...);
+void furi_string_free(FuriString* string);
+
+const char* furi_string_get_cstr(const FuriString* string);
+size_t furi_string_size(const FuriString* string);
+bool furi_string_empty(const FuriString* string);
+char furi_string_get_char(const FuriString* string, size_t index);
+
+void furi_string_reset(FuriString* string);
+void furi_string_set_str(FuriString* string, const char* source);
+void furi_string_set(FuriString* string, const FuriString* source);
+void furi_string_cat_str(FuriString* string, const char* tail);
+int furi_string_printf(FuriString* string, const char* format, ...);
+int furi_string_cat_printf(FuriString* string, const char* format, ...);
+void furi_string_push_back(FuriString* string, char c);
+
+bool furi_string_equal_str(const FuriString* string, const char* other);
+bool furi_string_start_with_str(const FuriString* string, const char* start);
+bool furi_string_end_with_str(const FuriString* string, const char* end);
+size_t furi_string_search_char(const FuriString* string, char c, size_t start);
+
+// keeps the first index characters
+void furi_string_left(FuriString* string, size_t index);
+// drops the first index characters
+void furi_string_right(FuriString* string, size_t index);
+void furi_string_replace_all(FuriString* string, const char* pattern, const char* replacement);
+// strips spaces, tabs and line ends from both ends
+void furi_string_trim(FuriString* string);
@@ -0,0 +1,85 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <time.h>
+
+#include "furi_hal.h"
+
+/* speaker */
+
+static pthread_mutex_t speaker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FuriThreadId speaker_owner;
+static bool is_speaker_on;
+static uint32_t speaker_on_since;
+static FuriHalHostSpeakerStats speaker_stats;
+
+bool furi_hal_speaker_acquire(uint32_t timeout) {
+  const uint32_t start = furi_get_tick();
+  for (;;) {
+    pthread_mutex_lock(&speaker_mutex);
+    const bool is_acquired = speaker_owner == NULL;
+    if (is_acquired) speaker_owner = furi_thread_get_current_id();
+    pthread_mutex_unlock(&speaker_mutex);
+    if (is_acquired) return true;
+    if (furi_get_tick() - start >= timeout) return false;
+    furi_delay_ms(1);
+  }
+}
+
+void furi_hal_speaker_release(void) {
+  furi_hal_speaker_stop();
+  pthread_mutex_lock(&speaker_mutex);
+  furi_check(speaker_owner == furi_thread_get_current_id());
+  speaker_owner = NULL;
+  pthread_mutex_unlock(&speaker_mutex);
+}
+
+bool furi_hal_speaker_is_mine(void) {
+  pthread_mutex_lock(&speaker_mutex);
+  const bool is_mine = speaker_owner == furi_thread_get_current_id();
+  pthread_mutex_unlock(&speaker_mutex);
+  return is_mine;
+}
+
+void furi_hal_speaker_start(float frequency, float volume) {
+  UNUSED(frequency);
+  UNUSED(volume);
+  pthread_mutex_lock(&speaker_mutex);
+  if (!is_speaker_on) {
+    is_speaker_on = true;
+    speaker_on_since = furi_get_tick();
+    speaker_stats.starts++;
+  }
+  pthread_mutex_unlock(&speaker_mutex);
+}
+
+void furi_hal_speaker_stop(void) {
+  pthread_mutex_lock(&speaker_mutex);
+  if (is_speaker_on) {
+    is_speaker_on = false;
+    speaker_stats.on_ms += furi_get_tick() - speaker_on_since;
+  }
+  pthread_mutex_unlock(&speaker_mutex);
+}
+
+void furi_hal_speaker_host_get_stats(FuriHalHostSpeakerStats* stats) {
+  pthread_mutex_lock(&speaker_mutex);
+  *stats = speaker_stats;
+  pthread_mutex_unlock(&speaker_mutex);
+}
+
+/* cycle counter */
+
+static FuriHalHostDwt dwt;
+
+FuriHalHostDwt* furi_hal_host_dwt(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  const uint64_t us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  dwt.CYCCNT = (uint32_t)(us * FURI_HAL_HOST_CYCLES_PER_US);
+  return &dwt;
+}
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void) {
+  return FURI_HAL_HOST_CYCLES_PER_US;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <furi.h>
+
+/* speaker, the host only records what would have been played */
+
+bool furi_hal_speaker_acquire(uint32_t timeout);
+void furi_hal_speaker_release(void);
+bool furi_hal_speaker_is_mine(void);
+void furi_hal_speaker_start(float frequency, float volume);
+void furi_hal_speaker_stop(void);
+
+typedef struct {
+  uint32_t starts;
+  uint32_t on_ms;
+} FuriHalHostSpeakerStats;
+
+void furi_hal_speaker_host_get_stats(FuriHalHostSpeakerStats* stats);
+
+/* the cycle counter, running at the 64 MHz of the Flipper */
+
+#define FURI_HAL_HOST_CYCLES_PER_US 64
+
+typedef struct {
+  volatile uint32_t CYCCNT;
+} FuriHalHostDwt;
+
+// fills CYCCNT from the host clock on every read of DWT->CYCCNT
+FuriHalHostDwt* furi_hal_host_dwt(void);
+#define DWT (furi_hal_host_dwt())
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void);
@@ -0,0 +1,671 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "gui/elements.h"
+#include "gui/gui.h"
+#include "gui/view.h"
+#include "gui/view_dispatcher.h"
+
+#define GLYPH_WIDTH 3
+#define GLYPH_HEIGHT 5
+#define GLYPH_ADVANCE 4
+#define FONT_HEIGHT 7
+#define MAX_VIEWS 8
+#define QUEUE_SIZE 16
+
+/* input */
+
+const char* input_get_key_name(InputKey key) {
+  static const char* NAMES[InputKeyMAX] = {
+      [InputKeyUp] = "Up",       [InputKeyDown] = "Down", [InputKeyRight] = "Right",
+      [InputKeyLeft] = "Left",   [InputKeyOk] = "OK",     [InputKeyBack] = "Back",
+  };
+  return key < InputKeyMAX ? NAMES[key] : "Unknown";
+}
+
+const char* input_get_type_name(InputType type) {
+  static const char* NAMES[InputTypeMAX] = {
+      [InputTypePress] = "Press", [InputTypeRelease] = "Release", [InputTypeShort] = "Short",
+      [InputTypeLong] = "Long",   [InputTypeRepeat] = "Repeat",
+  };
+  return type < InputTypeMAX ? NAMES[type] : "Unknown";
+}
+
+/* canvas */
+
+struct Canvas {
+  uint8_t pixels[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH];
+  Color color;
+  Font font;
+};
+
+typedef struct {
+  char c;
+  const char* rows[GLYPH_HEIGHT];
+} Glyph;
+
+// lower case is drawn as upper case, anything missing as a box
+static const Glyph GLYPHS[] = {
+    {' ', {"...", "...", "...", "...", "..."}}, {'0', {"###", "#.#", "#.#", "#.#", "###"}},
+    {'1', {".#.", "##.", ".#.", ".#.", "###"}}, {'2', {"###", "..#", "###", "#..", "###"}},
+    {'3', {"###", "..#", "###", "..#", "###"}}, {'4', {"#.#", "#.#", "###", "..#", "..#"}},
+    {'5', {"###", "#..", "###", "..#", "###"}}, {'6', {"###", "#..", "###", "#.#", "###"}},
+    {'7', {"###", "..#", "..#", "..#", "..#"}}, {'8', {"###", "#.#", "###", "#.#", "###"}},
+    {'9', {"###", "#.#", "###", "..#", "###"}}, {'A', {".#.", "#.#", "###", "#.#", "#.#"}},
+    {'B', {"##.", "#.#", "##.", "#.#", "##."}}, {'C', {".##", "#..", "#..", "#..", ".##"}},
+    {'D', {"##.", "#.#", "#.#", "#.#", "##."}}, {'E', {"###", "#..", "##.", "#..", "###"}},
+    {'F', {"###", "#..", "##.", "#..", "#.."}}, {'G', {".##", "#..", "#.#", "#.#", ".##"}},
+    {'H', {"#.#", "#.#", "###", "#.#", "#.#"}}, {'I', {"###", ".#.", ".#.", ".#.", "###"}},
+    {'J', {"..#", "..#", "..#", "#.#", ".#."}}, {'K', {"#.#", "#.#", "##.", "#.#", "#.#"}},
+    {'L', {"#..", "#..", "#..", "#..", "###"}}, {'M', {"#.#", "###", "###", "#.#", "#.#"}},
+    {'N', {"##.", "#.#", "#.#", "#.#", "#.#"}}, {'O', {".#.", "#.#", "#.#", "#.#", ".#."}},
+    {'P', {"##.", "#.#", "##.", "#..", "#.."}}, {'Q', {".#.", "#.#", "#.#", "##.", ".##"}},
+    {'R', {"##.", "#.#", "##.", "#.#", "#.#"}}, {'S', {".##", "#..", ".#.", "..#", "##."}},
+    {'T', {"###", ".#.", ".#.", ".#.", ".#."}}, {'U', {"#.#", "#.#", "#.#", "#.#", "###"}},
+    {'V', {"#.#", "#.#", "#.#", "#.#", ".#."}}, {'W', {"#.#", "#.#", "###", "###", "#.#"}},
+    {'X', {"#.#", "#.#", ".#.", "#.#", "#.#"}}, {'Y', {"#.#", "#.#", ".#.", ".#.", ".#."}},
+    {'Z', {"###", "..#", ".#.", "#..", "###"}}, {'.', {"...", "...", "...", "...", ".#."}},
+    {',', {"...", "...", "...", ".#.", "#.."}}, {':', {"...", ".#.", "...", ".#.", "..."}},
+    {'-', {"...", "...", "###", "...", "..."}}, {'+', {"...", ".#.", "###", ".#.", "..."}},
+    {'=', {"...", "###", "...", "###", "..."}}, {'_', {"...", "...", "...", "...", "###"}},
+    {'/', {"..#", "..#", ".#.", "#..", "#.."}}, {'%', {"#.#", "..#", ".#.", "#..", "#.#"}},
+    {'(', {"..#", ".#.", ".#.", ".#.", "..#"}}, {')', {"#..", ".#.", ".#.", ".#.", "#.."}},
+    {'[', {".##", ".#.", ".#.", ".#.", ".##"}}, {']', {"##.", ".#.", ".#.", ".#.", "##."}},
+    {'<', {"..#", ".#.", "#..", ".#.", "..#"}}, {'>', {"#..", ".#.", "..#", ".#.", "#.."}},
+    {'#', {"#.#", "###", "#.#", "###", "#.#"}}, {'\'', {".#.", ".#.", "...", "...", "..."}},
+    {'!', {".#.", ".#.", ".#.", "...", ".#."}}, {'?', {"##.", "..#", ".#.", "...", ".#."}},
+};
+
+static const Glyph BOX = {'\0', {"###", "#.#", "#.#", "#.#", "###"}};
+
+static const Glyph* find_glyph(char c) {
+  if (c >= 'a' && c <= 'z') c = c - 'a' + 'A';
+  for (size_t j = 0; j < sizeof(GLYPHS) / sizeof(GLYPHS[0]); j++) {
+    if (GLYPHS[j].c == c) return &GLYPHS[j];
+  }
+  return &BOX;
+}
+
+size_t canvas_width(const Canvas* canvas) {
+  UNUSED(canvas);
+  return GUI_DISPLAY_WIDTH;
+}
+
+size_t canvas_height(const Canvas* canvas) {
+  UNUSED(canvas);
+  return GUI_DISPLAY_HEIGHT;
+}
+
+uint8_t canvas_current_font_height(const Canvas* canvas) {
+  UNUSED(canvas);
+  return FONT_HEIGHT;
+}
+
+void canvas_clear(Canvas* canvas) {
+  memset(canvas->pixels, 0, sizeof(canvas->pixels));
+  canvas->color = ColorBlack;
+}
+
+void canvas_set_color(Canvas* canvas, Color color) {
+  canvas->color = color;
+}
+
+void canvas_set_font(Canvas* canvas, Font font) {
+  canvas->font = font;
+}
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y) {
+  if (x < 0 || y < 0 || x >= GUI_DISPLAY_WIDTH || y >= GUI_DISPLAY_HEIGHT) return;
+  uint8_t* pixel = &canvas->pixels[y][x];
+  switch (canvas->color) {
+    case ColorWhite:
+      *pixel = 0;
+      break;
+    case ColorBlack:
+      *pixel = 1;
+      break;
+    case ColorXOR:
+      *pixel ^= 1;
+      break;
+  }
+}
+
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+  const int32_t dx = x2 > x1 ? x2 - x1 : x1 - x2;
+  const int32_t dy = y2 > y1 ? y1 - y2 : y2 - y1;
+  const int32_t sx = x1 < x2 ? 1 : -1;
+  const int32_t sy = y1 < y2 ? 1 : -1;
+  for (int32_t error = dx + dy;;) {
+    canvas_draw_dot(canvas, x1, y1);
+    if (x1 == x2 && y1 == y2) break;
+    const int32_t e2 = 2 * error;
+    if (e2 >= dy) {
+      error += dy;
+      x1 += sx;
+    }
+    if (e2 <= dx) {
+      error += dx;
+      y1 += sy;
+    }
+  }
+}
+
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+  for (size_t row = 0; row < height; row++) {
+    for (size_t col = 0; col < width; col++) {
+      canvas_draw_dot(canvas, x + col, y + row);
+    }
+  }
+}
+
+void canvas_draw_frame(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+  if (width == 0 || height == 0) return;
+  canvas_draw_line(canvas, x, y, x + width - 1, y);
+  canvas_draw_line(canvas, x, y + height - 1, x + width - 1, y + height - 1);
+  canvas_draw_line(canvas, x, y, x, y + height - 1);
+  canvas_draw_line(canvas, x + width - 1, y, x + width - 1, y + height - 1);
+}
+
+void canvas_draw_xbm(Canvas* canvas,
+                     int32_t x,
+                     int32_t y,
+                     size_t width,
+                     size_t height,
+                     const uint8_t* bitmap) {
+  const size_t row_bytes = (width + 7) / 8;
+  for (size_t row = 0; row < height; row++) {
+    for (size_t col = 0; col < width; col++) {
+      if (bitmap[row * row_bytes + col / 8] & (1 << (col % 8))) {
+        canvas_draw_dot(canvas, x + col, y + row);
+      }
+    }
+  }
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* text) {
+  for (; *text != '\0'; text++, x += GLYPH_ADVANCE) {
+    const Glyph* glyph = find_glyph(*text);
+    for (int row = 0; row < GLYPH_HEIGHT; row++) {
+      for (int col = 0; col < GLYPH_WIDTH; col++) {
+        if (glyph->rows[row][col] == '#') {
+          canvas_draw_dot(canvas, x + col, y - GLYPH_HEIGHT + row);
+        }
+      }
+    }
+  }
+}
+
+uint16_t canvas_string_width(Canvas* canvas, const char* text) {
+  UNUSED(canvas);
+  const size_t length = strlen(text);
+  return length > 0 ? length * GLYPH_ADVANCE - 1 : 0;
+}
+
+void canvas_draw_str_aligned(Canvas* canvas,
+                             int32_t x,
+                             int32_t y,
+                             Align horizontal,
+                             Align vertical,
+                             const char* text) {
+  const int32_t width = canvas_string_width(canvas, text);
+  if (horizontal == AlignRight) x -= width;
+  if (horizontal == AlignCenter) x -= width / 2;
+  if (vertical == AlignTop) y += GLYPH_HEIGHT;
+  if (vertical == AlignCenter) y += GLYPH_HEIGHT / 2 + 1;
+  canvas_draw_str(canvas, x, y, text);
+}
+
+/* elements */
+
+void elements_multiline_text_aligned(Canvas* canvas,
+                                     int32_t x,
+                                     int32_t y,
+                                     Align horizontal,
+                                     Align vertical,
+                                     const char* text) {
+  size_t num_lines = 1;
+  for (const char* c = text; *c != '\0'; c++) num_lines += *c == '\n';
+  const int32_t height = num_lines * FONT_HEIGHT;
+  if (vertical == AlignBottom) y -= height;
+  if (vertical == AlignCenter) y -= height / 2;
+
+  FuriString* line = furi_string_alloc();
+  for (const char* start = text;; y += FONT_HEIGHT) {
+    const char* end = strchr(start, '\n');
+    const size_t length = end != NULL ? (size_t)(end - start) : strlen(start);
+    furi_string_set_str(line, start);
+    furi_string_left(line, length);
+    canvas_draw_str_aligned(canvas, x, y, horizontal, AlignTop, furi_string_get_cstr(line));
+    if (end == NULL) break;
+    start = end + 1;
+  }
+  furi_string_free(line);
+}
+
+void elements_string_fit_width(Canvas* canvas, FuriString* string, uint8_t width) {
+  if (canvas_string_width(canvas, furi_string_get_cstr(string)) <= width) return;
+  const size_t ellipsis = canvas_string_width(canvas, "...") + 1;
+  while (!furi_string_empty(string) &&
+         canvas_string_width(canvas, furi_string_get_cstr(string)) + ellipsis > width) {
+    furi_string_left(string, furi_string_size(string) - 1);
+  }
+  furi_string_cat_str(string, "...");
+}
+
+/* view */
+
+struct View {
+  ViewDrawCallback draw_callback;
+  ViewInputCallback input_callback;
+  ViewCallback enter_callback;
+  ViewCallback exit_callback;
+  ViewUpdateCallback update_callback;
+  void* update_callback_context;
+  void* context;
+
+  ViewModelType model_type;
+  void* model;
+  FuriMutex* model_mutex;
+};
+
+View* view_alloc(void) {
+  return calloc(1, sizeof(View));
+}
+
+void view_free(View* view) {
+  view_free_model(view);
+  free(view);
+}
+
+void view_set_draw_callback(View* view, ViewDrawCallback callback) {
+  view->draw_callback = callback;
+}
+
+void view_set_input_callback(View* view, ViewInputCallback callback) {
+  view->input_callback = callback;
+}
+
+void view_set_enter_callback(View* view, ViewCallback callback) {
+  view->enter_callback = callback;
+}
+
+void view_set_exit_callback(View* view, ViewCallback callback) {
+  view->exit_callback = callback;
+}
+
+void view_set_update_callback(View* view, ViewUpdateCallback callback) {
+  view->update_callback = callback;
+}
+
+void view_set_update_callback_context(View* view, void* context) {
+  view->update_callback_context = context;
+}
+
+void view_set_context(View* view, void* context) {
+  view->context = context;
+}
+
+void view_allocate_model(View* view, ViewModelType type, size_t size) {
+  furi_check(view->model_type == ViewModelTypeNone);
+  view->model_type = type;
+  view->model = calloc(1, size);
+  if (type == ViewModelTypeLocking) view->model_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+}
+
+void view_free_model(View* view) {
+  if (view->model_mutex != NULL) furi_mutex_free(view->model_mutex);
+  free(view->model);
+  view->model_type = ViewModelTypeNone;
+  view->model = NULL;
+  view->model_mutex = NULL;
+}
+
+void* view_get_model(View* view) {
+  if (view->model_type == ViewModelTypeLocking) {
+    furi_check(furi_mutex_acquire(view->model_mutex, FuriWaitForever) == FuriStatusOk);
+  }
+  return view->model;
+}
+
+static void view_unlock_model(View* view) {
+  if (view->model_type == ViewModelTypeLocking) {
+    furi_check(furi_mutex_release(view->model_mutex) == FuriStatusOk);
+  }
+}
+
+void view_commit_model(View* view, bool update) {
+  view_unlock_model(view);
+  if (update && view->update_callback != NULL) {
+    view->update_callback(view, view->update_callback_context);
+  }
+}
+
+void view_draw(View* view, Canvas* canvas) {
+  if (view->draw_callback == NULL) return;
+  void* model = view_get_model(view);
+  view->draw_callback(canvas, model);
+  view_unlock_model(view);
+}
+
+bool view_input(View* view, InputEvent* event) {
+  return view->input_callback != NULL && view->input_callback(event, view->context);
+}
+
+void view_enter(View* view) {
+  if (view->enter_callback != NULL) view->enter_callback(view->context);
+}
+
+void view_exit(View* view) {
+  if (view->exit_callback != NULL) view->exit_callback(view->context);
+}
+
+/* gui, draws on its own thread like the GUI service */
+
+struct Gui {
+  Canvas canvas;
+  FuriThread* thread;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  bool is_redraw_requested;
+  bool is_stopping;
+
+  GuiHostDrawCallback draw_callback;
+  GuiHostInputCallback input_callback;
+  void* context;
+
+  uint8_t frame[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH];
+  uint32_t frames;
+};
+
+static int32_t gui_thread_callback(void* context) {
+  Gui* gui = context;
+  pthread_mutex_lock(&gui->mutex);
+  for (;;) {
+    while (!gui->is_redraw_requested && !gui->is_stopping) {
+      pthread_cond_wait(&gui->changed, &gui->mutex);
+    }
+    if (gui->is_stopping) break;
+    gui->is_redraw_requested = false;
+    if (gui->draw_callback == NULL) continue;
+
+    // draws with the GUI unlocked, so input can arrive meanwhile
+    GuiHostDrawCallback draw_callback = gui->draw_callback;
+    void* draw_context = gui->context;
+    pthread_mutex_unlock(&gui->mutex);
+    canvas_clear(&gui->canvas);
+    canvas_set_font(&gui->canvas, FontSecondary);
+    draw_callback(&gui->canvas, draw_context);
+    pthread_mutex_lock(&gui->mutex);
+
+    memcpy(gui->frame, gui->canvas.pixels, sizeof(gui->frame));
+    gui->frames++;
+  }
+  pthread_mutex_unlock(&gui->mutex);
+  return 0;
+}
+
+Gui* gui_host_alloc(void) {
+  Gui* gui = calloc(1, sizeof(Gui));
+  pthread_mutex_init(&gui->mutex, NULL);
+  pthread_cond_init(&gui->changed, NULL);
+  gui->thread = furi_thread_alloc_ex("gui", 2048, gui_thread_callback, gui);
+  furi_thread_start(gui->thread);
+  return gui;
+}
+
+void gui_host_free(Gui* gui) {
+  pthread_mutex_lock(&gui->mutex);
+  gui->is_stopping = true;
+  pthread_cond_broadcast(&gui->changed);
+  pthread_mutex_unlock(&gui->mutex);
+  furi_thread_join(gui->thread);
+  furi_thread_free(gui->thread);
+  pthread_mutex_destroy(&gui->mutex);
+  pthread_cond_destroy(&gui->changed);
+  free(gui);
+}
+
+void gui_host_send_input(Gui* gui, const InputEvent* event) {
+  pthread_mutex_lock(&gui->mutex);
+  GuiHostInputCallback input_callback = gui->input_callback;
+  void* context = gui->context;
+  pthread_mutex_unlock(&gui->mutex);
+  InputEvent copy = *event;
+  if (input_callback != NULL) input_callback(&copy, context);
+}
+
+uint32_t gui_host_get_frame(Gui* gui, uint8_t frame[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH]) {
+  pthread_mutex_lock(&gui->mutex);
+  memcpy(frame, gui->frame, sizeof(gui->frame));
+  const uint32_t frames = gui->frames;
+  pthread_mutex_unlock(&gui->mutex);
+  return frames;
+}
+
+void gui_host_attach(Gui* gui,
+                     GuiHostDrawCallback draw_callback,
+                     GuiHostInputCallback input_callback,
+                     void* context) {
+  pthread_mutex_lock(&gui->mutex);
+  gui->draw_callback = draw_callback;
+  gui->input_callback = input_callback;
+  gui->context = context;
+  gui->is_redraw_requested = true;
+  pthread_cond_broadcast(&gui->changed);
+  pthread_mutex_unlock(&gui->mutex);
+}
+
+void gui_host_detach(Gui* gui) {
+  pthread_mutex_lock(&gui->mutex);
+  gui->draw_callback = NULL;
+  gui->input_callback = NULL;
+  gui->context = NULL;
+  pthread_mutex_unlock(&gui->mutex);
+}
+
+void gui_host_request_redraw(Gui* gui) {
+  pthread_mutex_lock(&gui->mutex);
+  gui->is_redraw_requested = true;
+  pthread_cond_broadcast(&gui->changed);
+  pthread_mutex_unlock(&gui->mutex);
+}
+
+/* view dispatcher, a queue of input and custom events run by view_dispatcher_run */
+
+typedef enum {
+  ViewDispatcherMessageInput,
+  ViewDispatcherMessageCustom,
+  ViewDispatcherMessageStop,
+} ViewDispatcherMessageType;
+
+typedef struct {
+  ViewDispatcherMessageType type;
+  InputEvent input;
+  uint32_t custom_event;
+} ViewDispatcherMessage;
+
+struct ViewDispatcher {
+  Gui* gui;
+  struct {
+    uint32_t id;
+    View* view;
+  } views[MAX_VIEWS];
+  size_t num_views;
+  _Atomic(View*) current_view;
+
+  ViewDispatcherCustomEventCallback custom_event_callback;
+  ViewDispatcherNavigationEventCallback navigation_event_callback;
+  void* event_context;
+
+  pthread_mutex_t queue_mutex;
+  pthread_cond_t queue_changed;
+  ViewDispatcherMessage queue[QUEUE_SIZE];
+  size_t queue_head, queue_size;
+};
+
+ViewDispatcher* view_dispatcher_alloc(void) {
+  ViewDispatcher* view_dispatcher = calloc(1, sizeof(ViewDispatcher));
+  pthread_mutex_init(&view_dispatcher->queue_mutex, NULL);
+  pthread_cond_init(&view_dispatcher->queue_changed, NULL);
+  return view_dispatcher;
+}
+
+void view_dispatcher_free(ViewDispatcher* view_dispatcher) {
+  if (view_dispatcher->gui != NULL) gui_host_detach(view_dispatcher->gui);
+  pthread_mutex_destroy(&view_dispatcher->queue_mutex);
+  pthread_cond_destroy(&view_dispatcher->queue_changed);
+  free(view_dispatcher);
+}
+
+void view_dispatcher_enable_queue(ViewDispatcher* view_dispatcher) {
+  UNUSED(view_dispatcher);
+}
+
+// blocks while the queue is full, as the message queue of the firmware does
+static void view_dispatcher_post(ViewDispatcher* view_dispatcher,
+                                 const ViewDispatcherMessage* message) {
+  pthread_mutex_lock(&view_dispatcher->queue_mutex);
+  while (view_dispatcher->queue_size == QUEUE_SIZE) {
+    pthread_cond_wait(&view_dispatcher->queue_changed, &view_dispatcher->queue_mutex);
+  }
+  const size_t tail = (view_dispatcher->queue_head + view_dispatcher->queue_size) % QUEUE_SIZE;
+  view_dispatcher->queue[tail] = *message;
+  view_dispatcher->queue_size++;
+  pthread_cond_broadcast(&view_dispatcher->queue_changed);
+  pthread_mutex_unlock(&view_dispatcher->queue_mutex);
+}
+
+static ViewDispatcherMessage view_dispatcher_take(ViewDispatcher* view_dispatcher) {
+  pthread_mutex_lock(&view_dispatcher->queue_mutex);
+  while (view_dispatcher->queue_size == 0) {
+    pthread_cond_wait(&view_dispatcher->queue_changed, &view_dispatcher->queue_mutex);
+  }
+  const ViewDispatcherMessage message = view_dispatcher->queue[view_dispatcher->queue_head];
+  view_dispatcher->queue_head = (view_dispatcher->queue_head + 1) % QUEUE_SIZE;
+  view_dispatcher->queue_size--;
+  pthread_cond_broadcast(&view_dispatcher->queue_changed);
+  pthread_mutex_unlock(&view_dispatcher->queue_mutex);
+  return message;
+}
+
+void view_dispatcher_send_custom_event(ViewDispatcher* view_dispatcher, uint32_t event) {
+  const ViewDispatcherMessage message = {.type = ViewDispatcherMessageCustom,
+                                         .custom_event = event};
+  view_dispatcher_post(view_dispatcher, &message);
+}
+
+void view_dispatcher_set_custom_event_callback(ViewDispatcher* view_dispatcher,
+                                               ViewDispatcherCustomEventCallback callback) {
+  view_dispatcher->custom_event_callback = callback;
+}
+
+void view_dispatcher_set_navigation_event_callback(
+    ViewDispatcher* view_dispatcher,
+    ViewDispatcherNavigationEventCallback callback) {
+  view_dispatcher->navigation_event_callback = callback;
+}
+
+void view_dispatcher_set_event_callback_context(ViewDispatcher* view_dispatcher, void* context) {
+  view_dispatcher->event_context = context;
+}
+
+void view_dispatcher_stop(ViewDispatcher* view_dispatcher) {
+  const ViewDispatcherMessage message = {.type = ViewDispatcherMessageStop};
+  view_dispatcher_post(view_dispatcher, &message);
+}
+
+// an unhandled short Back is a navigation event, which stops the dispatcher unless consumed
+static void view_dispatcher_handle_input(ViewDispatcher* view_dispatcher, InputEvent* event) {
+  View* view = view_dispatcher->current_view;
+  const bool is_consumed = view != NULL && view_input(view, event);
+  if (is_consumed || event->key != InputKeyBack || event->type != InputTypeShort) return;
+  const bool is_navigated = view_dispatcher->navigation_event_callback != NULL &&
+                            view_dispatcher->navigation_event_callback(
+                                view_dispatcher->event_context);
+  if (!is_navigated) view_dispatcher_stop(view_dispatcher);
+}
+
+void view_dispatcher_run(ViewDispatcher* view_dispatcher) {
+  for (;;) {
+    ViewDispatcherMessage message = view_dispatcher_take(view_dispatcher);
+    switch (message.type) {
+      case ViewDispatcherMessageInput:
+        view_dispatcher_handle_input(view_dispatcher, &message.input);
+        break;
+      case ViewDispatcherMessageCustom:
+        if (view_dispatcher->custom_event_callback != NULL) {
+          view_dispatcher->custom_event_callback(view_dispatcher->event_context,
+                                                 message.custom_event);
+        }
+        break;
+      case ViewDispatcherMessageStop:
+        return;
+    }
+  }
+}
+
+static void view_dispatcher_update_callback(View* view, void* context) {
+  ViewDispatcher* view_dispatcher = context;
+  if (view == view_dispatcher->current_view && view_dispatcher->gui != NULL) {
+    gui_host_request_redraw(view_dispatcher->gui);
+  }
+}
+
+void view_dispatcher_add_view(ViewDispatcher* view_dispatcher, uint32_t view_id, View* view) {
+  furi_check(view_dispatcher->num_views < MAX_VIEWS);
+  view_dispatcher->views[view_dispatcher->num_views].id = view_id;
+  view_dispatcher->views[view_dispatcher->num_views].view = view;
+  view_dispatcher->num_views++;
+  view_set_update_callback(view, view_dispatcher_update_callback);
+  view_set_update_callback_context(view, view_dispatcher);
+}
+
+void view_dispatcher_remove_view(ViewDispatcher* view_dispatcher, uint32_t view_id) {
+  for (size_t j = 0; j < view_dispatcher->num_views; j++) {
+    if (view_dispatcher->views[j].id != view_id) continue;
+    View* view = view_dispatcher->views[j].view;
+    if (view == view_dispatcher->current_view) {
+      view_exit(view);
+      view_dispatcher->current_view = NULL;
+    }
+    view_set_update_callback(view, NULL);
+    view_dispatcher->views[j] = view_dispatcher->views[--view_dispatcher->num_views];
+    return;
+  }
+}
+
+void view_dispatcher_switch_to_view(ViewDispatcher* view_dispatcher, uint32_t view_id) {
+  for (size_t j = 0; j < view_dispatcher->num_views; j++) {
+    if (view_dispatcher->views[j].id != view_id) continue;
+    View* view = view_dispatcher->views[j].view;
+    if (view_dispatcher->current_view != NULL) view_exit(view_dispatcher->current_view);
+    view_dispatcher->current_view = view;
+    view_enter(view);
+    if (view_dispatcher->gui != NULL) gui_host_request_redraw(view_dispatcher->gui);
+    return;
+  }
+  furi_crash("unknown view");
+}
+
+static void view_dispatcher_draw_callback(Canvas* canvas, void* context) {
+  ViewDispatcher* view_dispatcher = context;
+  View* view = view_dispatcher->current_view;
+  if (view != NULL) view_draw(view, canvas);
+}
+
+static void view_dispatcher_input_callback(InputEvent* event, void* context) {
+  const ViewDispatcherMessage message = {.type = ViewDispatcherMessageInput, .input = *event};
+  view_dispatcher_post(context, &message);
+}
+
+void view_dispatcher_attach_to_gui(ViewDispatcher* view_dispatcher,
+                                   Gui* gui,
+                                   ViewDispatcherType type) {
+  UNUSED(type);
+  view_dispatcher->gui = gui;
+  gui_host_attach(gui, view_dispatcher_draw_callback, view_dispatcher_input_callback,
+                  view_dispatcher);
+}
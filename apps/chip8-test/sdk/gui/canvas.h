@@ -0,0 +1,58 @@
+#pragma once
+
+#include <furi.h>
+
+typedef enum {
+  ColorWhite = 0x00,
+  ColorBlack = 0x01,
+  ColorXOR = 0x02,
+} Color;
+
+// all fonts come out as the same 3x5 glyphs on the host
+typedef enum {
+  FontPrimary,
+  FontSecondary,
+  FontKeyboard,
+  FontBigNumbers,
+  FontTotalNumber,
+} Font;
+
+typedef enum {
+  AlignLeft,
+  AlignRight,
+  AlignTop,
+  AlignBottom,
+  AlignCenter,
+} Align;
+
+typedef struct Canvas Canvas;
+
+size_t canvas_width(const Canvas* canvas);
+size_t canvas_height(const Canvas* canvas);
+uint8_t canvas_current_font_height(const Canvas* canvas);
+
+void canvas_clear(Canvas* canvas);
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_set_font(Canvas* canvas, Font font);
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y);
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_frame(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+// bitmap is an XBM: rows padded to whole bytes, the leftmost pixel is bit 0
+void canvas_draw_xbm(Canvas* canvas,
+                     int32_t x,
+                     int32_t y,
+                     size_t width,
+                     size_t height,
+                     const uint8_t* bitmap);
+
+// y is the baseline of the text
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* text);
+void canvas_draw_str_aligned(Canvas* canvas,
+                             int32_t x,
+                             int32_t y,
+                             Align horizontal,
+                             Align vertical,
+                             const char* text);
+uint16_t canvas_string_width(Canvas* canvas, const char* text);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <furi.h>
+
+#include "canvas.h"
+
+void elements_multiline_text_aligned(Canvas* canvas,
+                                     int32_t x,
+                                     int32_t y,
+                                     Align horizontal,
+                                     Align vertical,
+                                     const char* text);
+
+// shortens the string to width pixels, ending it with "..."
+void elements_string_fit_width(Canvas* canvas, FuriString* string, uint8_t width);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <furi.h>
+#include <input/input.h>
+
+#include "canvas.h"
+
+#define RECORD_GUI "gui"
+
+#define GUI_DISPLAY_WIDTH 128
+#define GUI_DISPLAY_HEIGHT 64
+
+typedef struct Gui Gui;
+
+/* The host GUI draws on a thread of its own whenever a view asks for an
+ * update, like the GUI service does, and keeps the last frame. */
+
+Gui* gui_host_alloc(void);
+void gui_host_free(Gui* gui);
+
+// delivers an input event to whatever is attached, as the input service would
+void gui_host_send_input(Gui* gui, const InputEvent* event);
+
+// copies the last frame, one byte per pixel, and returns the number of frames drawn
+uint32_t gui_host_get_frame(Gui* gui, uint8_t frame[GUI_DISPLAY_HEIGHT][GUI_DISPLAY_WIDTH]);
+
+/* what a view dispatcher attaches */
+
+typedef void (*GuiHostDrawCallback)(Canvas* canvas, void* context);
+typedef void (*GuiHostInputCallback)(InputEvent* event, void* context);
+
+void gui_host_attach(Gui* gui,
+                     GuiHostDrawCallback draw_callback,
+                     GuiHostInputCallback input_callback,
+                     void* context);
+void gui_host_detach(Gui* gui);
+void gui_host_request_redraw(Gui* gui);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <furi.h>
+#include <input/input.h>
+
+#include "canvas.h"
+
+typedef struct View View;
+
+typedef void (*ViewDrawCallback)(Canvas* canvas, void* model);
+typedef bool (*ViewInputCallback)(InputEvent* event, void* context);
+typedef void (*ViewCallback)(void* context);
+typedef void (*ViewUpdateCallback)(View* view, void* context);
+
+typedef enum {
+  ViewModelTypeNone,
+  ViewModelTypeLockFree,
+  ViewModelTypeLocking,  // guarded by a FuriMutex, as on the device
+} ViewModelType;
+
+View* view_alloc(void);
+void view_free(View* view);
+
+void view_set_draw_callback(View* view, ViewDrawCallback callback);
+void view_set_input_callback(View* view, ViewInputCallback callback);
+void view_set_enter_callback(View* view, ViewCallback callback);
+void view_set_exit_callback(View* view, ViewCallback callback);
+void view_set_update_callback(View* view, ViewUpdateCallback callback);
+void view_set_update_callback_context(View* view, void* context);
+void view_set_context(View* view, void* context);
+
+void view_allocate_model(View* view, ViewModelType type, size_t size);
+void view_free_model(View* view);
+void* view_get_model(View* view);
+// unlocks the model, update asks the GUI for a redraw
+void view_commit_model(View* view, bool update);
+
+#define with_view_model(view, type, code, update) \
+  {                                               \
+    type = view_get_model(view);                  \
+    {code};                                       \
+    view_commit_model(view, update);              \
+  }
+
+/* the calls the GUI and the view dispatcher make, not part of the app API */
+
+void view_draw(View* view, Canvas* canvas);
+bool view_input(View* view, InputEvent* event);
+void view_enter(View* view);
+void view_exit(View* view);
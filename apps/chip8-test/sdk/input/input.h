@@ -0,0 +1,33 @@
+#pragma once
+
+#include <furi.h>
+
+#define RECORD_INPUT_EVENTS "input_events"
+
+typedef enum {
+  InputKeyUp,
+  InputKeyDown,
+  InputKeyRight,
+  InputKeyLeft,
+  InputKeyOk,
+  InputKeyBack,
+  InputKeyMAX,
+} InputKey;
+
+typedef enum {
+  InputTypePress,
+  InputTypeRelease,
+  InputTypeShort,
+  InputTypeLong,
+  InputTypeRepeat,
+  InputTypeMAX,
+} InputType;
+
+typedef struct {
+  uint32_t sequence;
+  InputKey key;
+  InputType type;
+} InputEvent;
+
+const char* input_get_key_name(InputKey key);
+const char* input_get_type_name(InputType type);
@@ -0,0 +1,328 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage/storage.h"
+#include "toolbox/stream/file_stream.h"
+
+#define MAX_PATH 512
+
+struct Storage {
+  char ext_root[MAX_PATH];
+};
+
+struct File {
+  Storage* storage;
+  FILE* file;
+  DIR* dir;
+  char dir_path[MAX_PATH];
+};
+
+struct Stream {
+  File* file;
+};
+
+Storage* storage_host_alloc(const char* ext_root) {
+  Storage* storage = malloc(sizeof(Storage));
+  snprintf(storage->ext_root, sizeof(storage->ext_root), "%s", ext_root);
+  return storage;
+}
+
+void storage_host_free(Storage* storage) {
+  free(storage);
+}
+
+// /ext/... and /any/... to a path below ext_root, false for anything else
+static bool host_path(Storage* storage, const char* path, char* host, size_t size) {
+  const char* rest = NULL;
+  if (strncmp(path, "/ext", 4) == 0 && (path[4] == '/' || path[4] == '\0')) {
+    rest = path + 4;
+  } else if (strncmp(path, "/any", 4) == 0 && (path[4] == '/' || path[4] == '\0')) {
+    rest = path + 4;
+  }
+  if (rest == NULL) return false;
+  const int length = snprintf(host, size, "%s%s", storage->ext_root, rest);
+  return length >= 0 && (size_t)length < size;
+}
+
+static FS_Error error_from_errno(void) {
+  switch (errno) {
+    case 0:
+      return FSE_OK;
+    case ENOENT:
+      return FSE_NOT_EXIST;
+    case EEXIST:
+      return FSE_EXIST;
+    case EACCES:
+    case EPERM:
+      return FSE_DENIED;
+    default:
+      return FSE_INTERNAL;
+  }
+}
+
+bool file_info_is_dir(const FileInfo* file_info) {
+  return file_info->flags & FSF_DIRECTORY;
+}
+
+File* storage_file_alloc(Storage* storage) {
+  File* file = calloc(1, sizeof(File));
+  file->storage = storage;
+  return file;
+}
+
+void storage_file_free(File* file) {
+  storage_file_close(file);
+  storage_dir_close(file);
+  free(file);
+}
+
+static const char* fopen_mode(FS_AccessMode access_mode, FS_OpenMode open_mode) {
+  const bool is_write = access_mode & FSAM_WRITE;
+  const bool is_read = access_mode & FSAM_READ;
+  switch (open_mode) {
+    case FSOM_CREATE_ALWAYS:
+      return is_read ? "w+b" : "wb";
+    case FSOM_OPEN_APPEND:
+      return is_read ? "a+b" : "ab";
+    default:
+      return is_write ? "r+b" : "rb";
+  }
+}
+
+bool storage_file_open(File* file,
+                       const char* path,
+                       FS_AccessMode access_mode,
+                       FS_OpenMode open_mode) {
+  furi_check(file->file == NULL);
+  char host[MAX_PATH];
+  if (!host_path(file->storage, path, host, sizeof(host))) return false;
+
+  const bool exists = access(host, F_OK) == 0;
+  if (open_mode == FSOM_CREATE_NEW && exists) return false;
+  if ((open_mode == FSOM_OPEN_ALWAYS || open_mode == FSOM_CREATE_NEW) && !exists) {
+    FILE* created = fopen(host, "wb");
+    if (created == NULL) return false;
+    fclose(created);
+  }
+  file->file = fopen(host, fopen_mode(access_mode, open_mode));
+  return file->file != NULL;
+}
+
+bool storage_file_close(File* file) {
+  if (file->file == NULL) return false;
+  fclose(file->file);
+  file->file = NULL;
+  return true;
+}
+
+bool storage_file_is_open(File* file) {
+  return file->file != NULL;
+}
+
+size_t storage_file_read(File* file, void* buffer, size_t bytes_to_read) {
+  return file->file != NULL ? fread(buffer, 1, bytes_to_read, file->file) : 0;
+}
+
+size_t storage_file_write(File* file, const void* buffer, size_t bytes_to_write) {
+  return file->file != NULL ? fwrite(buffer, 1, bytes_to_write, file->file) : 0;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+  return file->file != NULL &&
+         fseek(file->file, offset, from_start ? SEEK_SET : SEEK_CUR) == 0;
+}
+
+uint64_t storage_file_tell(File* file) {
+  return file->file != NULL ? (uint64_t)ftell(file->file) : 0;
+}
+
+uint64_t storage_file_size(File* file) {
+  if (file->file == NULL) return 0;
+  const long position = ftell(file->file);
+  fseek(file->file, 0, SEEK_END);
+  const long size = ftell(file->file);
+  fseek(file->file, position, SEEK_SET);
+  return size;
+}
+
+// at the end as soon as the position reaches the size, not only after a short read
+bool storage_file_eof(File* file) {
+  return storage_file_tell(file) >= storage_file_size(file);
+}
+
+bool storage_dir_open(File* file, const char* path) {
+  furi_check(file->dir == NULL);
+  char host[MAX_PATH];
+  if (!host_path(file->storage, path, host, sizeof(host))) return false;
+  file->dir = opendir(host);
+  snprintf(file->dir_path, sizeof(file->dir_path), "%s", host);
+  return file->dir != NULL;
+}
+
+bool storage_dir_close(File* file) {
+  if (file->dir == NULL) return false;
+  closedir(file->dir);
+  file->dir = NULL;
+  return true;
+}
+
+static void stat_info(const char* host, FileInfo* info) {
+  struct stat st;
+  memset(info, 0, sizeof(FileInfo));
+  if (stat(host, &st) == 0) {
+    info->flags = S_ISDIR(st.st_mode) ? FSF_DIRECTORY : 0;
+    info->size = S_ISDIR(st.st_mode) ? 0 : (uint64_t)st.st_size;
+  }
+}
+
+bool storage_dir_read(File* file, FileInfo* fileinfo, char* name, uint16_t name_length) {
+  if (file->dir == NULL) return false;
+  for (struct dirent* entry; (entry = readdir(file->dir)) != NULL;) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    if (name != NULL) snprintf(name, name_length, "%s", entry->d_name);
+    if (fileinfo != NULL) {
+      char host[2 * MAX_PATH];
+      snprintf(host, sizeof(host), "%s/%s", file->dir_path, entry->d_name);
+      stat_info(host, fileinfo);
+    }
+    return true;
+  }
+  return false;
+}
+
+FS_Error storage_common_stat(Storage* storage, const char* path, FileInfo* fileinfo) {
+  char host[MAX_PATH];
+  if (!host_path(storage, path, host, sizeof(host))) return FSE_INVALID_NAME;
+  if (access(host, F_OK) != 0) return FSE_NOT_EXIST;
+  if (fileinfo != NULL) stat_info(host, fileinfo);
+  return FSE_OK;
+}
+
+FS_Error storage_common_timestamp(Storage* storage, const char* path, uint32_t* timestamp) {
+  char host[MAX_PATH];
+  if (!host_path(storage, path, host, sizeof(host))) return FSE_INVALID_NAME;
+  struct stat st;
+  if (stat(host, &st) != 0) return error_from_errno();
+  *timestamp = (uint32_t)st.st_mtime;
+  return FSE_OK;
+}
+
+FS_Error storage_common_remove(Storage* storage, const char* path) {
+  char host[MAX_PATH];
+  if (!host_path(storage, path, host, sizeof(host))) return FSE_INVALID_NAME;
+  return remove(host) == 0 ? FSE_OK : error_from_errno();
+}
+
+FS_Error storage_common_rename(Storage* storage, const char* old_path, const char* new_path) {
+  char old_host[MAX_PATH], new_host[MAX_PATH];
+  if (!host_path(storage, old_path, old_host, sizeof(old_host)) ||
+      !host_path(storage, new_path, new_host, sizeof(new_host))) {
+    return FSE_INVALID_NAME;
+  }
+  // like the firmware, never replaces an existing file
+  if (access(new_host, F_OK) == 0) return FSE_EXIST;
+  return rename(old_host, new_host) == 0 ? FSE_OK : error_from_errno();
+}
+
+FS_Error storage_common_mkdir(Storage* storage, const char* path) {
+  char host[MAX_PATH];
+  if (!host_path(storage, path, host, sizeof(host))) return FSE_INVALID_NAME;
+  return mkdir(host, 0755) == 0 ? FSE_OK : error_from_errno();
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+  const FS_Error error = storage_common_mkdir(storage, path);
+  return error == FSE_OK || error == FSE_EXIST;
+}
+
+/* file streams */
+
+Stream* file_stream_alloc(Storage* storage) {
+  Stream* stream = malloc(sizeof(Stream));
+  stream->file = storage_file_alloc(storage);
+  return stream;
+}
+
+bool file_stream_open(Stream* stream,
+                      const char* path,
+                      FS_AccessMode access_mode,
+                      FS_OpenMode open_mode) {
+  return storage_file_open(stream->file, path, access_mode, open_mode);
+}
+
+bool file_stream_close(Stream* stream) {
+  return storage_file_close(stream->file);
+}
+
+void stream_free(Stream* stream) {
+  storage_file_free(stream->file);
+  free(stream);
+}
+
+bool stream_eof(Stream* stream) {
+  return storage_file_eof(stream->file);
+}
+
+bool stream_seek(Stream* stream, int32_t offset, StreamOffset offset_type) {
+  FILE* file = stream->file->file;
+  if (file == NULL) return false;
+  static const int WHENCE[] = {
+      [StreamOffsetFromCurrent] = SEEK_CUR,
+      [StreamOffsetFromStart] = SEEK_SET,
+      [StreamOffsetFromEnd] = SEEK_END,
+  };
+  return fseek(file, offset, WHENCE[offset_type]) == 0;
+}
+
+size_t stream_tell(Stream* stream) {
+  return storage_file_tell(stream->file);
+}
+
+size_t stream_size(Stream* stream) {
+  return storage_file_size(stream->file);
+}
+
+size_t stream_read(Stream* stream, uint8_t* data, size_t size) {
+  return storage_file_read(stream->file, data, size);
+}
+
+size_t stream_write(Stream* stream, const uint8_t* data, size_t size) {
+  return storage_file_write(stream->file, data, size);
+}
+
+bool stream_read_line(Stream* stream, FuriString* string) {
+  furi_string_reset(string);
+  FILE* file = stream->file->file;
+  if (file == NULL) return false;
+  int c;
+  while ((c = fgetc(file)) != EOF) {
+    furi_string_push_back(string, c);
+    if (c == '\n') break;
+  }
+  return !furi_string_empty(string);
+}
+
+size_t stream_write_string(Stream* stream, FuriString* string) {
+  return stream_write_cstring(stream, furi_string_get_cstr(string));
+}
+
+size_t stream_write_cstring(Stream* stream, const char* string) {
+  return stream_write(stream, (const uint8_t*)string, strlen(string));
+}
+
+size_t stream_write_format(Stream* stream, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  char* text = NULL;
+  const int size = vasprintf(&text, format, args);
+  va_end(args);
+  if (size < 0) return 0;
+  const size_t written = stream_write(stream, (const uint8_t*)text, size);
+  free(text);
+  return written;
+}
@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Explores the states of a ROM the way a play-testing search would: restore a
+// random state found so far, hold a random key (or none) for STEP_MS, clone the
+// result and keep it if it is new.
+//
+//   make search && ./search ROM [CLONES [STEP_MS]]
+//
+// Reports how many distinct states were found, how fast states were cloned and
+// restored, and how much memory the clones took next to copies of the VM. The
+// copies are timed the way a search without clones would take them: into and
+// out of as many snapshots as there are states, up to MAX_SNAPSHOTS.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../chip8-app/vm_clone.h"
+#include "../chip8-app/vm_i.h"
+#include "harness.h"
+
+#if !VM_FEATURE_CLONE
+#error "build with -DVM_FEATURE_CLONE=1, see the Makefile"
+#endif
+
+#define DEFAULT_CLONES 100000
+#define DEFAULT_STEP_MS 100
+#define MAX_SNAPSHOTS 4096
+
+static uint32_t next_random(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static double seconds_since(const struct timespec* start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// the distinct states, an open addressing table of twice the capacity
+typedef struct {
+  VmClone** states;
+  size_t count, capacity;
+  VmClone** table;
+  size_t table_size;
+} StateSet;
+
+static void state_set_init(StateSet* set, size_t capacity) {
+  set->states = malloc(capacity * sizeof(VmClone*));
+  set->count = 0;
+  set->capacity = capacity;
+  set->table_size = 2 * capacity;
+  set->table = calloc(set->table_size, sizeof(VmClone*));
+}
+
+// false if an equal state is already in the set
+static bool state_set_add(StateSet* set, VmClone* clone) {
+  size_t slot = vm_clone_hash(clone) % set->table_size;
+  for (; set->table[slot]; slot = (slot + 1) % set->table_size) {
+    if (vm_clone_equals(set->table[slot], clone)) return false;
+  }
+  set->table[slot] = clone;
+  set->states[set->count++] = clone;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s ROM [CLONES [STEP_MS]]\n", argv[0]);
+    return 1;
+  }
+  const size_t clones = argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_CLONES;
+  const uint32_t step_ms =
+      argc > 3 ? strtoul(argv[3], NULL, 0) : DEFAULT_STEP_MS;
+
+  VM* vm = vm_alloc();
+  if (!harness_load(vm, argv[1])) return 1;
+  vm_start(vm, 0);
+  vm_set_seed(vm, 1);
+
+  VmClonePool* pool = vm_clone_pool_alloc();
+  StateSet set;
+  state_set_init(&set, clones + 1);
+  state_set_add(&set, vm_clone(pool, vm));
+
+  uint32_t random = 0x2545F491;
+  size_t duplicates = 0, errors = 0;
+  double clone_s = 0;
+  struct timespec start;
+  for (size_t n = 0; n < clones; n++) {
+    VmClone* state = set.states[next_random(&random) % set.count];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    vm_clone_restore(state, vm);
+    clone_s += seconds_since(&start);
+    const uint32_t key = next_random(&random) % (VM_NUM_KEYS + 1);
+    vm_set_keys(vm, key < VM_NUM_KEYS ? 1 << key : 0);
+
+    const bool is_ok = vm_update(vm, vm_timestamp_cpu(vm) + step_ms);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    VmClone* clone = vm_clone(pool, vm);
+    clone_s += seconds_since(&start);
+    if (!is_ok) {
+      errors++;
+      vm_clone_free(clone);
+    } else if (!state_set_add(&set, clone)) {
+      duplicates++;
+      vm_clone_free(clone);
+    }
+  }
+
+  // the same number of copies to and from whole snapshots
+  const size_t snapshots =
+      set.count < MAX_SNAPSHOTS ? set.count : MAX_SNAPSHOTS;
+  byte* snapshot = malloc(snapshots * vm_get_size());
+  for (size_t j = 0; j < snapshots; j++) {
+    memcpy(snapshot + j * vm_get_size(), vm, vm_get_size());
+  }
+  VM* copy = malloc(vm_get_size());
+  double copy_s = 0;
+  for (size_t n = 0; n < clones; n++) {
+    const size_t from = next_random(&random) % snapshots;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memcpy(copy, snapshot + from * vm_get_size(), vm_get_size());
+    copy->cpu_ticks += n;  // stands in for running the VM
+    memcpy(snapshot + n % snapshots * vm_get_size(), copy, vm_get_size());
+    copy_s += seconds_since(&start);
+  }
+
+  const size_t size = vm_clone_pool_get_size(pool);
+  printf("%zu distinct states, %zu duplicates, %zu stopped with an error\n",
+         set.count, duplicates, errors);
+  printf("%zu clones and restores in %.3f s, %.2f us each; copying the VM "
+         "to and from %zu snapshots instead took %.3f s, %.2f us each\n",
+         clones, clone_s, 1e6 * clone_s / clones, snapshots, copy_s,
+         1e6 * copy_s / clones);
+  printf("%zu bytes of pages in use, %.0f per state, a VM takes %zu\n", size,
+         (double)size / set.count, vm_get_size());
+
+  for (size_t j = 0; j < set.count; j++) vm_clone_free(set.states[j]);
+  vm_free(vm);
+  free(copy);
+  free(snapshot);
+  vm_clone_pool_free(pool);
+  free(set.states);
+  free(set.table);
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "terminal.h"
+
+#define MAX_WIDTH 128
+#define MAX_HEIGHT 64
+#define MAX_ROWS (MAX_HEIGHT / 2)
+#define SCREEN_ROW 2  // of the terminal, the title takes the first
+#define CELL_UNKNOWN 0xFF  // forces the character to be written
+// a cursor move, "\x1b[ROW;COLUMNH", costs more than rewriting this many
+// unchanged characters on the way
+#define MAX_SKIP_REWRITE 2
+#define MAX_GLYPH 3
+#define MAX_MOVE 10
+#define BUFFER_SIZE (MAX_ROWS * MAX_WIDTH * (MAX_MOVE + MAX_GLYPH) + 64)
+
+// indexed by the cell, bit 0 is the upper pixel and bit 1 the lower one
+static const char* const GLYPHS[] = {" ", "▀", "▄", "█"};
+
+struct Terminal {
+  byte cells[MAX_ROWS][MAX_WIDTH];  // as they are on the terminal
+  int width, height;
+  uint32_t screen_changes;
+  bool is_full;  // the next frame writes every character
+  char buffer[BUFFER_SIZE];
+  size_t size;
+};
+
+static void append(Terminal* terminal, const char* data, const size_t size) {
+  memcpy(terminal->buffer + terminal->size, data, size);
+  terminal->size += size;
+}
+
+static void append_string(Terminal* terminal, const char* string) {
+  append(terminal, string, strlen(string));
+}
+
+static void append_move(Terminal* terminal, const int row, const int column) {
+  terminal->size += snprintf(terminal->buffer + terminal->size,
+                             BUFFER_SIZE - terminal->size, "\x1b[%d;%dH",
+                             SCREEN_ROW + row, 1 + column);
+}
+
+// stdout is flushed first so nothing printed before ends up after the frame
+static void flush(Terminal* terminal) {
+  fflush(stdout);
+  const char* data = terminal->buffer;
+  size_t size = terminal->size;
+  while (size > 0) {
+    const ssize_t written = write(STDOUT_FILENO, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    data += written;
+    size -= written;
+  }
+  terminal->size = 0;
+}
+
+Terminal* terminal_alloc() {
+  Terminal* terminal = malloc(sizeof(Terminal));
+  terminal->width = 0;
+  terminal->height = 0;
+  terminal->is_full = true;
+  terminal->size = 0;
+  return terminal;
+}
+
+void terminal_free(Terminal* terminal) {
+  free(terminal);
+}
+
+void terminal_begin(Terminal* terminal, const char* title) {
+  append_string(terminal, "\x1b[2J\x1b[H\x1b[?25l");
+  append_string(terminal, title);
+  flush(terminal);
+  terminal->is_full = true;
+}
+
+size_t terminal_draw(Terminal* terminal, VM* vm) {
+  const int width = vm_get_screen_width(vm);
+  const int height = vm_get_screen_height(vm);
+  const uint32_t screen_changes = vm_get_screen_changes(vm);
+  if (!terminal->is_full && screen_changes == terminal->screen_changes) {
+    return 0;
+  }
+  if (width != terminal->width || height != terminal->height) {
+    // erases the old screen, which may have been larger
+    append_string(terminal, "\x1b[2;1H\x1b[J");
+    terminal->width = width;
+    terminal->height = height;
+    terminal->is_full = true;
+  }
+  if (terminal->is_full) {
+    memset(terminal->cells, CELL_UNKNOWN, sizeof(terminal->cells));
+    terminal->is_full = false;
+  }
+  terminal->screen_changes = screen_changes;
+
+  for (int row = 0; row < height / 2; row++) {
+    byte upper[MAX_WIDTH / 8], lower[MAX_WIDTH / 8];
+    vm_get_screen_row(vm, 2 * row, upper);
+    vm_get_screen_row(vm, 2 * row + 1, lower);
+    byte* cells = terminal->cells[row];
+    int cursor = -1;  // the column the cursor is in, if on this row
+    for (int column = 0; column < width; column++) {
+      const int shift = 7 - column % 8;
+      const byte cell = ((upper[column / 8] >> shift) & 1) |
+                        ((lower[column / 8] >> shift) & 1) << 1;
+      if (cell == cells[column]) continue;
+      if (cursor >= 0 && column - cursor <= MAX_SKIP_REWRITE) {
+        for (; cursor < column; cursor++) {
+          append_string(terminal, GLYPHS[cells[cursor]]);
+        }
+      } else {
+        append_move(terminal, row, column);
+      }
+      append_string(terminal, GLYPHS[cell]);
+      cells[column] = cell;
+      cursor = column + 1;
+    }
+  }
+
+  const size_t size = terminal->size;
+  flush(terminal);
+  return size;
+}
+
+void terminal_end(Terminal* terminal) {
+  append_move(terminal, terminal->height / 2, 0);
+  append_string(terminal, "\x1b[?25h");
+  flush(terminal);
+}
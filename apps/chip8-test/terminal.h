@@ -0,0 +1,24 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../chip8-app/vm.h"
+
+// Draws the screen into an ANSI terminal, two rows of pixels per character
+// with half blocks. Each frame writes only the characters that changed since
+// the one before, built into one buffer and sent with a single write().
+
+typedef struct Terminal Terminal;
+
+Terminal* terminal_alloc();
+
+void terminal_free(Terminal* terminal);
+
+// clears the terminal, writes the title in the first line and hides the
+// cursor, the next frame is drawn in full below the title
+void terminal_begin(Terminal* terminal, const char* title);
+
+// draws the screen if it changed, returns the bytes written
+size_t terminal_draw(Terminal* terminal, VM* vm);
+
+// moves the cursor below the screen and shows it again
+void terminal_end(Terminal* terminal);
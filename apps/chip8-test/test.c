@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <time.h>
 
-#include "../chip8/vm.h"
+#include "../chip8-app/vm.h"
+#include "harness.h"
+#include "terminal.h"
 #include "test.h"
 
 uint32_t timestamp() {
@@ -10,35 +12,22 @@ uint32_t timestamp() {
 }
 
 void read_file(VM* vm, const char* file_name) {
-  FILE* file = fopen(file_name, "r");
-
-  for (word addr = 0; !feof(file); addr++) {
-    const byte c = fgetc(file);
-    vm_write_prog_to_memory(vm, addr, c);
-  }
+  if (!harness_load(vm, file_name)) exit(1);
   printf("file '%s' successfully loaded\n", file_name);
 }
 
-void draw_screen(VM* vm) {
-  const int screen_width = vm_get_screen_width(vm);
-  const int screen_height = vm_get_screen_height(vm);
-
-  printf("\n\n\n");
-  for (uint8_t y = 0; y < screen_height; y++) {
-    for (uint8_t x = 0; x < screen_width; x++) {
-      const char* out = vm_get_pixel(vm, x, y) ? "x" : ".";
-      printf("%s", out);
-    }
-    printf("\n");
-  }
-}
-
 void run_test(const Config config) {
   VM* vm = vm_alloc();
   read_file(vm, config.name);
 
   vm_start(vm, timestamp());
 
+  Terminal* terminal = terminal_alloc();
+  char title[256];
+  snprintf(title, sizeof(title), "chip-8 program '%s'", config.name);
+  terminal_begin(terminal, title);
+  size_t drawn_bytes = 0;
+
   const uint32_t start_timestamp = timestamp();
   uint32_t last_draw_timestamp = start_timestamp;
   uint32_t last_input_timestamp = start_timestamp;
@@ -64,15 +53,18 @@ void run_test(const Config config) {
     }
     // handle output
     if ((timestamp() - last_draw_timestamp) * 60 > 1000) {
-      draw_screen(vm);
+      drawn_bytes += terminal_draw(terminal, vm);
       last_draw_timestamp = timestamp();
     }
   }
 
+  terminal_end(terminal);
+  terminal_free(terminal);
   vm_free(vm);
 
   do {
-    printf("\ndemo of chip-8 program '%s' ended\n\npress ENTER to continue ",
-           config.name);
+    printf("\ndemo of chip-8 program '%s' ended, %zu bytes drawn\n\n"
+           "press ENTER to continue ",
+           config.name, drawn_bytes);
   } while (getchar() != '\n');
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../chip8-app/trace.h"
+
+#define TRACE_EVENT_INFO(id, name, a, b) {name, a, b},
+static const struct {
+  const char* name;
+  const char* a;
+  const char* b;
+} EVENTS[] = {TRACE_EVENTS(TRACE_EVENT_INFO)};
+#undef TRACE_EVENT_INFO
+
+// usage: trace_decode chip8.trace
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    printf("usage: %s TRACE\n", argv[0]);
+    return 1;
+  }
+  FILE* file = fopen(argv[1], "rb");
+  if (file == NULL) {
+    printf("could not read '%s'\n", argv[1]);
+    return 1;
+  }
+
+  TraceHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != TRACE_VERSION ||
+      header.record_size != sizeof(TraceRecord)) {
+    printf("'%s' is not a version %d trace\n", argv[1], TRACE_VERSION);
+    fclose(file);
+    return 1;
+  }
+  printf("%u records, %u older ones overwritten\n", header.num_records,
+         header.num_overwritten);
+
+  size_t counts[TraceEventMAX] = {0};
+  TraceRecord record;
+  TraceRecord last_update = {0};
+  bool has_update = false;
+  uint32_t last_timestamp = 0;
+  for (uint32_t j = 0; j < header.num_records; j++) {
+    if (fread(&record, sizeof(record), 1, file) != 1) {
+      printf("trace ends after %u records\n", j);
+      break;
+    }
+    if (record.event >= TraceEventMAX) {
+      printf("%10u  unknown event %u\n", record.sequence, record.event);
+      continue;
+    }
+    const uint32_t delta = j > 0 ? record.timestamp - last_timestamp : 0;
+    last_timestamp = record.timestamp;
+    counts[record.event]++;
+    printf("%10u %8u ms %+6d  %-7s %s = %u, %s = %u", record.sequence,
+           record.timestamp, (int)delta, EVENTS[record.event].name,
+           EVENTS[record.event].a, record.a, EVENTS[record.event].b, record.b);
+
+    // the speeds the app used to log, derived from consecutive updates
+    if (record.event == TraceEventUpdate) {
+      const uint32_t elapsed = record.timestamp - last_update.timestamp;
+      if (has_update && elapsed > 0) {
+        printf("  (%u instructions/s)",
+               (uint32_t)((uint64_t)(record.b - last_update.b) * 1000 / elapsed));
+      }
+      last_update = record;
+      has_update = true;
+    }
+    printf("\n");
+  }
+  fclose(file);
+
+  for (size_t e = 0; e < TraceEventMAX; e++) {
+    printf("%-7s %zu\n", EVENTS[e].name, counts[e]);
+  }
+  return 0;
+}